@@ -0,0 +1,677 @@
+#include "./Enumerator.h"
+
+#include <math.h>             // for exp(), fabs(), floor(), fmax(), INFINITY
+#include <inttypes.h>         // for uint32_t, uint64_t, UINT64_MAX
+#include <string.h>           // for memcmp()
+
+#include <algorithm>          // for std::lower_bound, std::swap
+#include <string>             // for std::string
+#include <unordered_map>      // for std::unordered_map
+#include <vector>             // for std::vector
+
+#include "../src/Graph.h"     // for Graph class
+#include "../src/Runner.h"    // for Runner class
+
+namespace rakan {
+
+// Finds the representative of a piece, halving paths on the way.
+static uint32_t FindPiece(vector<uint32_t> *parent, uint32_t piece) {
+  while ((*parent)[piece] != piece) {
+    (*parent)[piece] = (*parent)[(*parent)[piece]];
+    piece = (*parent)[piece];
+  }
+  return piece;
+}
+
+// Gets the number of bits needed to hold every value up to max_value.
+static uint32_t BitsFor(uint64_t max_value) {
+  uint32_t bits = 0;
+
+  while (bits < 64 && (max_value >> bits) != 0) {
+    bits++;
+  }
+  return bits;
+}
+
+// Reads a field of at most 32 bits from a packed state, advancing the bit
+// position past it.
+static uint32_t GetBits(const uint64_t *words, uint32_t *pos,
+                        uint32_t width) {
+  uint32_t word = *pos / 64, shift = *pos % 64;
+  uint64_t value;
+
+  if (width == 0) {
+    return 0;
+  }
+  value = words[word] >> shift;
+  if (shift + width > 64) {
+    value |= words[word + 1] << (64 - shift);
+  }
+  *pos += width;
+  return value & ((1ULL << width) - 1);
+}
+
+// Writes a field of at most 32 bits into a zeroed packed state, advancing
+// the bit position past it.
+static void PutBits(uint64_t *words, uint32_t *pos, uint32_t width,
+                    uint64_t value) {
+  uint32_t word = *pos / 64, shift = *pos % 64;
+
+  if (width == 0) {
+    return;
+  }
+  words[word] |= value << shift;
+  if (shift + width > 64) {
+    words[word + 1] |= value >> (64 - shift);
+  }
+  *pos += width;
+}
+
+// Adds two counts, saturating at UINT64_MAX.
+static uint64_t SaturatingAdd(uint64_t a, uint64_t b) {
+  return a > UINT64_MAX - b ? UINT64_MAX : a + b;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// State tables
+///////////////////////////////////////////////////////////////////////////////
+
+void Enumerator::StateTable::Reset(uint32_t num_words) {
+  num_words_ = num_words;
+  states_.clear();
+  counts_.clear();
+  slots_.assign(16, 0);
+}
+
+uint64_t *Enumerator::StateTable::Insert(const uint64_t *state) {
+  uint64_t mask, i;
+  uint32_t entry;
+
+  if (2 * (counts_.size() + 1) > slots_.size()) {
+    Grow();
+  }
+  mask = slots_.size() - 1;
+  for (i = Hash(state) & mask; slots_[i] != 0; i = (i + 1) & mask) {
+    entry = slots_[i] - 1;
+    if (memcmp(&states_[(uint64_t) entry * num_words_], state,
+               num_words_ * sizeof(uint64_t)) == 0) {
+      return &counts_[entry];
+    }
+  }
+
+  slots_[i] = counts_.size() + 1;
+  states_.insert(states_.end(), state, state + num_words_);
+  counts_.push_back(0);
+  return &counts_.back();
+}
+
+const uint64_t *Enumerator::StateTable::Find(const uint64_t *state) const {
+  uint64_t mask = slots_.size() - 1, i;
+  uint32_t entry;
+
+  for (i = Hash(state) & mask; slots_[i] != 0; i = (i + 1) & mask) {
+    entry = slots_[i] - 1;
+    if (memcmp(&states_[(uint64_t) entry * num_words_], state,
+               num_words_ * sizeof(uint64_t)) == 0) {
+      return &counts_[entry];
+    }
+  }
+  return nullptr;
+}
+
+uint64_t Enumerator::StateTable::Hash(const uint64_t *state) const {
+  uint64_t hash = 0;
+  uint32_t i;
+
+  // Each word is mixed in with the splitmix64 finalizer, so that the low
+  // bits used for the slot depend on every bit of the state.
+  for (i = 0; i < num_words_; i++) {
+    hash ^= state[i];
+    hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebULL;
+    hash ^= hash >> 31;
+  }
+  return hash;
+}
+
+void Enumerator::StateTable::Grow() {
+  uint64_t mask, i, entry;
+
+  slots_.assign(2 * slots_.size(), 0);
+  mask = slots_.size() - 1;
+  for (entry = 0; entry < counts_.size(); entry++) {
+    for (i = Hash(&states_[entry * num_words_]) & mask; slots_[i] != 0;
+         i = (i + 1) & mask) {}
+    slots_[i] = entry + 1;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Constructors and destructors
+///////////////////////////////////////////////////////////////////////////////
+
+Enumerator::Enumerator(Graph *graph)
+    : graph_(graph),
+      num_nodes_(graph->num_nodes_),
+      num_districts_(0),
+      lower_(0),
+      upper_(INFINITY),
+      num_words_(1),
+      num_listed_(0),
+      max_states_(0) {}
+
+Enumerator::~Enumerator() {}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Algorithms
+///////////////////////////////////////////////////////////////////////////////
+
+uint64_t Enumerator::Count(uint32_t num_districts, double tolerance) {
+  uint32_t node, d;
+  uint64_t count = 0, i, j, *entry;
+  StateTable layer, next;
+  vector<uint64_t> states;
+  vector<uint32_t> labels;
+
+  if (num_districts == 0 || num_districts > 32 || num_nodes_ == 0) {
+    return 0;
+  }
+  Prepare(num_districts, tolerance);
+
+  // The empty state, before any node, packs to all zeros.
+  states.assign(num_words_, 0);
+  layer.Reset(num_words_);
+  *layer.Insert(states.data()) = 1;
+  for (node = 0; node < num_nodes_; node++) {
+    next.Reset(num_words_);
+    for (i = 0; i < layer.Size(); i++) {
+      Expand(layer.GetState(i), node, &states, &labels);
+      for (j = 0; j < labels.size(); j++) {
+        entry = next.Insert(&states[j * num_words_]);
+        *entry = SaturatingAdd(*entry, layer.GetCount(i));
+      }
+    }
+    std::swap(layer, next);
+    if (layer.Size() > max_states_) {
+      max_states_ = layer.Size();
+    }
+  }
+
+  for (i = 0; i < layer.Size(); i++) {
+    if (IsComplete(layer.GetState(i))) {
+      count = SaturatingAdd(count, layer.GetCount(i));
+    }
+  }
+  for (d = 2; d <= num_districts; d++) {
+    if (count > UINT64_MAX / d) {
+      return UINT64_MAX;
+    }
+    count *= d;
+  }
+  return count;
+}
+
+bool Enumerator::List(uint32_t num_districts, double tolerance,
+                      uint64_t max_plans) {
+  uint32_t node;
+  uint64_t completions, i, j;
+  const uint64_t *entry;
+  vector<uint64_t> states;
+  vector<uint32_t> labels;
+
+  num_listed_ = 0;
+  plans_.clear();
+  if (num_districts == 0 || num_districts > 32 || num_nodes_ == 0) {
+    return true;
+  }
+  Prepare(num_districts, tolerance);
+
+  // Every state reachable before each node.
+  layers_.assign(num_nodes_ + 1, StateTable());
+  for (node = 0; node <= num_nodes_; node++) {
+    layers_[node].Reset(num_words_);
+  }
+  states.assign(num_words_, 0);
+  layers_[0].Insert(states.data());
+  for (node = 0; node < num_nodes_; node++) {
+    for (i = 0; i < layers_[node].Size(); i++) {
+      Expand(layers_[node].GetState(i), node, &states, &labels);
+      for (j = 0; j < labels.size(); j++) {
+        layers_[node + 1].Insert(&states[j * num_words_]);
+      }
+    }
+    if (layers_[node + 1].Size() > max_states_) {
+      max_states_ = layers_[node + 1].Size();
+    }
+  }
+
+  // The number of completions of each state, from the last node back,
+  // saturating just past max_plans.
+  for (i = 0; i < layers_[num_nodes_].Size(); i++) {
+    layers_[num_nodes_].GetCount(i) =
+        IsComplete(layers_[num_nodes_].GetState(i)) ? 1 : 0;
+  }
+  for (node = num_nodes_; node-- > 0; ) {
+    for (i = 0; i < layers_[node].Size(); i++) {
+      Expand(layers_[node].GetState(i), node, &states, &labels);
+      completions = 0;
+      for (j = 0; j < labels.size(); j++) {
+        entry = layers_[node + 1].Find(&states[j * num_words_]);
+        completions += *entry;
+        if (completions > max_plans) {
+          completions = max_plans + 1;
+        }
+      }
+      layers_[node].GetCount(i) = completions;
+    }
+  }
+
+  completions = layers_[0].GetCount(0);
+  if (completions > max_plans) {
+    layers_.clear();
+    return false;
+  }
+
+  plans_.reserve(completions * num_nodes_);
+  current_.assign(num_nodes_, 0);
+  ListFrom(layers_[0].GetState(0), 0);
+  layers_.clear();
+  return true;
+}
+
+double Enumerator::CompareWalk(Runner *runner, uint32_t num_samples,
+                               uint32_t thinning) {
+  uint32_t v, d, p, sample;
+  uint64_t plan;
+  double max_log_weight = -INFINITY, total = 0, outside = 0, distance = 0;
+  vector<double> weights(num_listed_), visits(num_listed_, 0);
+  vector<uint32_t> cut_edges(num_districts_), sizes(num_districts_);
+  vector<uint32_t> pops(num_districts_), min_pops(num_districts_);
+  vector<uint32_t> districts(num_nodes_);
+  unordered_map<string, uint64_t> index;
+
+  // The exact target over the listed plans.
+  for (plan = 0; plan < num_listed_; plan++) {
+    const uint32_t *labels = GetPlan(plan);
+    index[Key(labels)] = plan;
+    cut_edges.assign(num_districts_, 0);
+    sizes.assign(num_districts_, 0);
+    pops.assign(num_districts_, 0);
+    min_pops.assign(num_districts_, 0);
+    for (v = 0; v < num_nodes_; v++) {
+      sizes[labels[v]]++;
+      pops[labels[v]] += graph_->pop_of_node_[v];
+      min_pops[labels[v]] += graph_->min_pop_of_node_[v];
+      for (p = graph_->adj_offsets_[v]; p < graph_->adj_offsets_[v + 1]; p++) {
+        cut_edges[labels[v]] += labels[graph_->adj_[p]] != labels[v];
+      }
+    }
+    weights[plan] = 0;
+    for (d = 0; d < num_districts_; d++) {
+      weights[plan] -= runner->GetInverseTemperature() *
+          runner->DistrictScore(cut_edges[d], sizes[d], pops[d], min_pops[d]);
+    }
+    if (weights[plan] > max_log_weight) {
+      max_log_weight = weights[plan];
+    }
+  }
+  for (plan = 0; plan < num_listed_; plan++) {
+    // Held as logs until now.
+    weights[plan] = exp(weights[plan] - max_log_weight);
+    total += weights[plan];
+  }
+
+  for (sample = 0; sample < num_samples; sample++) {
+    runner->Walk(thinning);
+    for (v = 0; v < num_nodes_; v++) {
+      districts[v] = graph_->GetDistrictOf(v);
+    }
+    auto found = index.find(Key(districts.data()));
+    if (found == index.end()) {
+      outside++;
+    } else {
+      visits[found->second]++;
+    }
+  }
+
+  for (plan = 0; plan < num_listed_; plan++) {
+    distance += fabs(visits[plan] / num_samples - weights[plan] / total);
+  }
+  return (distance + outside / num_samples) / 2;
+}
+
+void Enumerator::Prepare(uint32_t num_districts, double tolerance) {
+  uint32_t v, p, i, max_frontier = 0;
+  double ideal;
+  vector<uint32_t> last_neighbor(num_nodes_), empty;
+
+  num_districts_ = num_districts;
+  max_states_ = 0;
+  lower_ = 0;
+  upper_ = INFINITY;
+  if (tolerance > 0) {
+    ideal = ((double) graph_->state_pop_) / num_districts;
+    lower_ = ideal * (1 - tolerance);
+    upper_ = ideal * (1 + tolerance);
+  }
+
+  // A node stays on the frontier until its last neighbor is processed.
+  for (v = 0; v < num_nodes_; v++) {
+    last_neighbor[v] = v;
+    for (p = graph_->adj_offsets_[v]; p < graph_->adj_offsets_[v + 1]; p++) {
+      if (graph_->adj_[p] > last_neighbor[v]) {
+        last_neighbor[v] = graph_->adj_[p];
+      }
+    }
+  }
+  frontiers_.assign(num_nodes_, vector<uint32_t>());
+  for (v = 0; v < num_nodes_; v++) {
+    if (v > 0) {
+      for (auto &u : frontiers_[v - 1]) {
+        if (last_neighbor[u] > v) {
+          frontiers_[v].push_back(u);
+        }
+      }
+    }
+    if (last_neighbor[v] > v) {
+      frontiers_[v].push_back(v);
+    }
+    if (frontiers_[v].size() > max_frontier) {
+      max_frontier = frontiers_[v].size();
+    }
+  }
+  // Where each node's earlier neighbors lie on the frontier before it, and
+  // where each node of the frontier after it came from; the node itself
+  // comes from slot size.
+  back_slots_.assign(num_nodes_, vector<uint32_t>());
+  next_slots_.assign(num_nodes_, vector<uint32_t>());
+  kept_.assign(num_nodes_, vector<uint32_t>());
+  for (v = 0; v < num_nodes_; v++) {
+    const vector<uint32_t> &before = v > 0 ? frontiers_[v - 1] : empty;
+    kept_[v].assign(before.size() + 1, 0);
+    for (p = graph_->adj_offsets_[v]; p < graph_->adj_offsets_[v + 1]; p++) {
+      if (graph_->adj_[p] < v) {
+        back_slots_[v].push_back(
+            std::lower_bound(before.begin(), before.end(), graph_->adj_[p]) -
+            before.begin());
+      }
+    }
+    for (auto &u : frontiers_[v]) {
+      i = u == v ? before.size()
+                 : std::lower_bound(before.begin(), before.end(), u) -
+                       before.begin();
+      next_slots_[v].push_back(i);
+      kept_[v][i] = 1;
+    }
+  }
+
+  pop_from_.assign(num_nodes_ + 1, 0);
+  for (v = num_nodes_; v-- > 0; ) {
+    pop_from_[v] = pop_from_[v + 1] + graph_->pop_of_node_[v];
+  }
+
+  // A district's population never passes the upper bound, and there are
+  // no more open districts or pieces than frontier nodes.
+  max_open_ = max_frontier < num_districts ? max_frontier : num_districts;
+  count_bits_ = BitsFor(num_districts);
+  pop_bits_ = 0;
+  if (upper_ != INFINITY) {
+    pop_bits_ = BitsFor(upper_ < graph_->state_pop_
+                            ? (uint64_t) floor(upper_)
+                            : graph_->state_pop_);
+  }
+  label_bits_ = BitsFor(max_open_ > 0 ? max_open_ - 1 : 0);
+  piece_bits_ = BitsFor(max_frontier > 0 ? max_frontier - 1 : 0);
+  num_words_ = (2 * count_bits_ + max_open_ * pop_bits_ +
+                max_frontier * (label_bits_ + piece_bits_) + 63) / 64;
+  if (num_words_ == 0) {
+    num_words_ = 1;
+  }
+
+  pops_.assign(max_open_ + 1, 0);
+  new_pops_.assign(max_open_ + 1, 0);
+  closing_.assign(max_open_ + 1, 0);
+  relabeled_.assign(max_open_ + 1, 0);
+  frontier_labels_.assign(max_frontier, 0);
+  frontier_pieces_.assign(max_frontier + 1, 0);
+  parent_.assign(max_frontier + 1, 0);
+  members_.assign(max_frontier + 1, 0);
+  members_kept_.assign(max_frontier + 1, 0);
+  renumbered_.assign(max_frontier + 1, 0);
+  node_labels_.assign(max_frontier + 1, 0);
+}
+
+void Enumerator::Unpack(const uint64_t *state, uint32_t node) {
+  uint32_t pos = 0, d, i, size = node > 0 ? frontiers_[node - 1].size() : 0;
+
+  used_ = GetBits(state, &pos, count_bits_);
+  num_finished_ = GetBits(state, &pos, count_bits_);
+  num_open_ = used_ - num_finished_;
+  for (d = 0; d < num_open_; d++) {
+    pops_[d] = GetBits(state, &pos, pop_bits_);
+  }
+  for (i = 0; i < size; i++) {
+    frontier_labels_[i] = GetBits(state, &pos, label_bits_);
+    frontier_pieces_[i] = GetBits(state, &pos, piece_bits_);
+  }
+  // The node to be added starts a piece of its own.
+  frontier_pieces_[size] = size;
+}
+
+void Enumerator::Expand(const uint64_t *state, uint32_t node,
+                        vector<uint64_t> *next, vector<uint32_t> *labels) {
+  const vector<uint32_t> &back_slots = back_slots_[node];
+  const vector<uint32_t> &next_slots = next_slots_[node];
+  const vector<uint32_t> &kept = kept_[node];
+  uint32_t k = num_districts_, remaining = num_nodes_ - node - 1;
+  uint32_t size = kept.size() - 1, label, i, piece, root;
+  uint32_t district, used, num_finished, num_labels, pos;
+  uint64_t *result;
+  double needed, room;
+  bool bounded = upper_ != INFINITY, valid;
+
+  next->clear();
+  labels->clear();
+  Unpack(state, node);
+
+  // The node joins an open district, or starts district num_open_.
+  for (label = 0; label <= num_open_; label++) {
+    used = used_ + (label == num_open_);
+    if (used > k) {
+      continue;
+    }
+    // Every district not yet started needs a node of its own.
+    if (k - used > remaining) {
+      continue;
+    }
+
+    num_labels = num_open_ + (label == num_open_);
+    for (district = 0; district < num_labels; district++) {
+      new_pops_[district] = district < num_open_ ? pops_[district] : 0;
+    }
+    if (bounded) {
+      new_pops_[label] += graph_->pop_of_node_[node];
+      if (new_pops_[label] > upper_) {
+        continue;
+      }
+    }
+
+    // Pieces 0 .. size - 1 are those of the frontier; the node starts
+    // piece size and joins every neighboring piece of its district.
+    for (i = 0; i <= size; i++) {
+      parent_[i] = i;
+    }
+    for (i = 0; i < size; i++) {
+      node_labels_[i] = frontier_labels_[i];
+    }
+    node_labels_[size] = label;
+    for (auto &slot : back_slots) {
+      if (node_labels_[slot] == label) {
+        parent_[FindPiece(&parent_, frontier_pieces_[slot])] =
+            FindPiece(&parent_, size);
+      }
+    }
+
+    // Count the members of each piece, and those still on the frontier.
+    for (i = 0; i <= size; i++) {
+      members_[i] = 0;
+      members_kept_[i] = 0;
+    }
+    for (i = 0; i <= size; i++) {
+      root = FindPiece(&parent_, frontier_pieces_[i]);
+      members_[root]++;
+      members_kept_[root] += kept[i];
+    }
+
+    // A piece that leaves the frontier finishes its district, which must
+    // then have no other piece.
+    valid = true;
+    num_finished = num_finished_;
+    for (district = 0; district < num_labels; district++) {
+      closing_[district] = 0;
+    }
+    for (i = 0; i <= size; i++) {
+      root = FindPiece(&parent_, frontier_pieces_[i]);
+      if (members_[root] > 0 && members_kept_[root] == 0) {
+        closing_[node_labels_[i]]++;
+        members_[root] = 0;
+      }
+    }
+    for (district = 0; district < num_labels && valid; district++) {
+      if (closing_[district] == 0) {
+        continue;
+      }
+      if (closing_[district] > 1 || new_pops_[district] < lower_) {
+        valid = false;
+      }
+      num_finished++;
+    }
+    for (i = 0; i <= size && valid; i++) {
+      root = FindPiece(&parent_, frontier_pieces_[i]);
+      if (members_kept_[root] > 0 && closing_[node_labels_[i]] > 0) {
+        valid = false;
+      }
+    }
+    if (!valid) {
+      continue;
+    }
+
+    // The nodes left must bring every open district within the bounds,
+    // and fit in them.
+    if (bounded) {
+      needed = (k - used) * lower_;
+      room = (k - used) * upper_;
+      for (district = 0; district < num_labels; district++) {
+        if (closing_[district] == 0) {
+          needed += fmax(0, lower_ - new_pops_[district]);
+          room += upper_ - new_pops_[district];
+        }
+      }
+      if (pop_from_[node + 1] < needed || pop_from_[node + 1] > room) {
+        continue;
+      }
+    }
+
+    // The open districts are renumbered by first appearance on the new
+    // frontier, and so are the pieces.
+    for (district = 0; district < num_labels; district++) {
+      relabeled_[district] = num_labels;
+    }
+    for (i = 0; i <= size; i++) {
+      renumbered_[i] = size + 1;
+    }
+    district = 0;
+    piece = 0;
+    for (auto &i : next_slots) {
+      if (relabeled_[node_labels_[i]] == num_labels) {
+        relabeled_[node_labels_[i]] = district++;
+      }
+      root = FindPiece(&parent_, frontier_pieces_[i]);
+      if (renumbered_[root] == size + 1) {
+        renumbered_[root] = piece++;
+      }
+    }
+
+    next->resize(next->size() + num_words_, 0);
+    result = &(*next)[next->size() - num_words_];
+    pos = 0;
+    PutBits(result, &pos, count_bits_, used);
+    PutBits(result, &pos, count_bits_, num_finished);
+    for (district = 0; district < num_labels; district++) {
+      if (closing_[district] == 0) {
+        // Only open districts remain, each on the new frontier.
+        pos = 2 * count_bits_ + relabeled_[district] * pop_bits_;
+        PutBits(result, &pos, pop_bits_, new_pops_[district]);
+      }
+    }
+    pos = 2 * count_bits_ + (used - num_finished) * pop_bits_;
+    for (auto &i : next_slots) {
+      root = FindPiece(&parent_, frontier_pieces_[i]);
+      PutBits(result, &pos, label_bits_, relabeled_[node_labels_[i]]);
+      PutBits(result, &pos, piece_bits_, renumbered_[root]);
+    }
+    labels->push_back(label);
+  }
+}
+
+bool Enumerator::IsComplete(const uint64_t *state) const {
+  uint32_t pos = 0, used, num_finished;
+
+  used = GetBits(state, &pos, count_bits_);
+  num_finished = GetBits(state, &pos, count_bits_);
+  return used == num_districts_ && num_finished == num_districts_;
+}
+
+void Enumerator::ListFrom(const uint64_t *state, uint32_t node) {
+  static const vector<uint32_t> kEmpty;
+  const vector<uint32_t> &before = node > 0 ? frontiers_[node - 1] : kEmpty;
+  uint32_t i, j, num_open;
+  const uint64_t *entry;
+  vector<uint64_t> states;
+  vector<uint32_t> labels;
+
+  if (node == num_nodes_) {
+    plans_.insert(plans_.end(), current_.begin(), current_.end());
+    num_listed_++;
+    return;
+  }
+
+  // Expand leaves the state unpacked. A new district takes the next
+  // number; an open one is that of its first node on the frontier.
+  Expand(state, node, &states, &labels);
+  num_open = num_open_;
+  for (i = 0; i < labels.size(); i++) {
+    if (labels[i] == num_open) {
+      labels[i] = used_;
+    } else {
+      for (j = 0; frontier_labels_[j] != labels[i]; j++) {}
+      labels[i] = current_[before[j]];
+    }
+  }
+
+  for (i = 0; i < labels.size(); i++) {
+    entry = layers_[node + 1].Find(&states[i * num_words_]);
+    if (entry == nullptr || *entry == 0) {
+      continue;
+    }
+    current_[node] = labels[i];
+    ListFrom(&states[i * num_words_], node + 1);
+  }
+}
+
+string Enumerator::Key(const uint32_t *districts) const {
+  uint32_t v, next = 0;
+  vector<uint32_t> renumbered(num_districts_, num_districts_);
+  string key(num_nodes_, 0);
+
+  for (v = 0; v < num_nodes_; v++) {
+    if (renumbered[districts[v]] == num_districts_) {
+      renumbered[districts[v]] = next++;
+    }
+    key[v] = (char) renumbered[districts[v]];
+  }
+  return key;
+}
+
+}   // namespace rakan
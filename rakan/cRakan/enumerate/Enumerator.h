@@ -0,0 +1,279 @@
+#ifndef ENUMERATE_ENUMERATOR_H_
+#define ENUMERATE_ENUMERATOR_H_
+
+#include <inttypes.h>         // for uint32_t, uint64_t
+
+#include <string>             // for std::string
+#include <unordered_map>      // for std::unordered_map
+#include <vector>             // for std::vector
+
+#include "../src/Graph.h"     // for Graph class
+#include "../src/Runner.h"    // for Runner class
+
+using std::string;
+using std::unordered_map;
+using std::vector;
+
+namespace rakan {
+
+/*
+* An exact enumerator of the plans of a small graph: every assignment of
+* the nodes to k nonempty, contiguous districts whose populations are
+* within a tolerance, the state space a Runner walks on. Meant for tests
+* and benchmarks that check samplers against their exact target.
+*
+* Plans are counted by a dynamic program over the nodes in ID order. The
+* state after each node records, for every processed node that still has
+* an unprocessed neighbor (the frontier), its district and which of the
+* district's pieces it lies in, plus the number of districts started and
+* finished and, while the population bounds are on, the population of
+* each open district. A piece that leaves the frontier must be its
+* district's only piece, and finishes the district. Open districts are
+* numbered by first appearance on the frontier, so each partition is
+* counted once and the number of labeled plans is k! times the number of
+* states that finish. States whose remaining population cannot bring every
+* open district within the bounds, or does not fit in them, are dropped.
+* States are packed into a few 64-bit words.
+*
+* The frontier of a rows x cols grid in row-major order is cols nodes
+* wide. Without population bounds, an 8 x 8 grid takes about a second
+* for up to 4 districts. The bounds multiply the states by the populations
+* the open districts may have: with a tolerance of 0.1, a 7 x 7 grid takes
+* seconds for 3 districts and about 20 seconds for 4, and an 8 x 8 grid
+* about a minute for 3 and several minutes, with 15 million states, for 4.
+*/
+class Enumerator {
+ public:
+  /////////////////////////////////////////////////////////////////////////////
+  // Constructors and destructors
+  /////////////////////////////////////////////////////////////////////////////
+
+  /*
+  * Creates an enumerator over a graph whose flattened adjacency and
+  * population columns have been built, see Graph::BuildAdjacency.
+  *
+  * @param    graph   the graph to enumerate the plans of
+  */
+  explicit Enumerator(Graph *graph);
+
+  /*
+  * Default destructor.
+  */
+  ~Enumerator();
+
+  Enumerator(const Enumerator &other) = delete;
+  Enumerator &operator=(const Enumerator &other) = delete;
+
+  /////////////////////////////////////////////////////////////////////////////
+  // Algorithms
+  /////////////////////////////////////////////////////////////////////////////
+
+  /*
+  * Counts the plans of the graph.
+  *
+  * @param    num_districts   the number of districts, at most 32
+  * @param    tolerance       the allowed deviation from the ideal district
+  *                           population, as a fraction of the ideal; as
+  *                           in Runner, non-positive disables the bounds
+  *
+  * @return the number of plans, each labeling of the districts counted
+  *         separately; UINT64_MAX if that does not fit in 64 bits, which
+  *         k! alone does not for k > 20
+  */
+  uint64_t Count(uint32_t num_districts, double tolerance);
+
+  /*
+  * Lists the plans of the graph, one per partition, with the districts
+  * numbered in order of first appearance. Nothing is listed if there are
+  * more than max_plans partitions.
+  *
+  * @param    num_districts   the number of districts, at most 32
+  * @param    tolerance       the population tolerance, as in Count
+  * @param    max_plans       the largest number of partitions to list
+  *
+  * @return true iff every partition has been listed
+  */
+  bool List(uint32_t num_districts, double tolerance, uint64_t max_plans);
+
+  /*
+  * Walks a Runner over the same graph and measures the total variation
+  * distance between the frequencies of the plans it visits and its exact
+  * target, the listed plans weighted by exp(-inverse temperature * score)
+  * under the Runner's scoring weights. Plans are compared up to the
+  * numbering of their districts, which the target does not depend on.
+  * Visits to unlisted plans count fully towards the distance.
+  *
+  * Requires List to have listed every plan for the Runner's number of
+  * districts and tolerance, and PopulateGraphData to have been called on
+  * the Runner.
+  *
+  * @param    runner        the Runner to walk
+  * @param    num_samples   the number of plans to sample
+  * @param    thinning      the number of steps walked per sample
+  *
+  * @return the total variation distance, in [0, 1]
+  */
+  double CompareWalk(Runner *runner, uint32_t num_samples, uint32_t thinning);
+
+  /////////////////////////////////////////////////////////////////////////////
+  // Queries
+  /////////////////////////////////////////////////////////////////////////////
+
+  /*
+  * Gets the number of partitions listed by the last List.
+  *
+  * @return the number of listed partitions
+  */
+  uint64_t GetNumListed() const { return num_listed_; }
+
+  /*
+  * Gets a listed partition.
+  *
+  * @param    plan    the index of the partition
+  *
+  * @return the district of every node, indexed by node ID
+  */
+  const uint32_t *GetPlan(uint64_t plan) const {
+    return &plans_[plan * num_nodes_];
+  }
+
+  /*
+  * Gets the largest number of frontier states held at once by the last
+  * Count or List.
+  *
+  * @return the number of states
+  */
+  uint64_t GetMaxStates() const { return max_states_; }
+
+ private:
+  // An open-addressing hash table of packed dynamic-programming states,
+  // each a fixed number of 64-bit words, mapped to a count. States are kept
+  // densely in order of insertion, so they can be visited by index.
+  class StateTable {
+   public:
+    // Empties the table and sets the number of words per state.
+    void Reset(uint32_t num_words);
+
+    // Gets the count of a state, inserting it with a count of 0 if it is
+    // new. The pointer is only valid until the next insertion.
+    uint64_t *Insert(const uint64_t *state);
+
+    // Gets the count of a state, or nullptr if it is not in the table.
+    const uint64_t *Find(const uint64_t *state) const;
+
+    uint64_t Size() const { return counts_.size(); }
+    const uint64_t *GetState(uint64_t i) const {
+      return &states_[i * num_words_];
+    }
+    uint64_t &GetCount(uint64_t i) { return counts_[i]; }
+
+   private:
+    // Hashes a state.
+    uint64_t Hash(const uint64_t *state) const;
+
+    // Doubles the number of slots and reinserts every state.
+    void Grow();
+
+    uint32_t num_words_;
+    vector<uint64_t> states_;
+    vector<uint64_t> counts_;
+
+    // The index of the state in each slot plus 1, or 0 if it is empty.
+    vector<uint32_t> slots_;
+  };
+
+  // Sets the population bounds, the frontier after every node and the
+  // layout of a packed state.
+  void Prepare(uint32_t num_districts, double tolerance);
+
+  // Unpacks a state on the frontier before a node into the scratch fields
+  // below.
+  void Unpack(const uint64_t *state, uint32_t node);
+
+  // Computes the states reached from a state, on the frontier before a
+  // node, by putting the node in each district it may join. The packed
+  // states are written to next, and the ith of them is reached by putting
+  // the node in open district labels[i], or in a new district if that is
+  // the number of open districts. Leaves the state unpacked.
+  void Expand(const uint64_t *state, uint32_t node, vector<uint64_t> *next,
+              vector<uint32_t> *labels);
+
+  // Queries whether a state after the last node is a complete plan.
+  bool IsComplete(const uint64_t *state) const;
+
+  // Lists the completions of a state before a node, given the labels of
+  // the nodes before it.
+  void ListFrom(const uint64_t *state, uint32_t node);
+
+  // Keys a plan by its districts, renumbered in order of first
+  // appearance.
+  string Key(const uint32_t *districts) const;
+
+  // The graph enumerated.
+  Graph *graph_;
+  uint32_t num_nodes_;
+
+  // The settings of the last Count or List.
+  uint32_t num_districts_;
+  double lower_;
+  double upper_;
+
+  // The frontier after each node, in ascending ID order, and the
+  // population of the nodes from each node on.
+  vector<vector<uint32_t> > frontiers_;
+  vector<uint64_t> pop_from_;
+
+  // For each node, the slots of its earlier neighbors on the frontier
+  // before it, the slot each node of the frontier after it comes from,
+  // and whether each slot stays on the frontier. The node's own slot is
+  // the last.
+  vector<vector<uint32_t> > back_slots_;
+  vector<vector<uint32_t> > next_slots_;
+  vector<vector<uint32_t> > kept_;
+
+  // The layout of a packed state: its number of words, the largest number
+  // of open districts, and the widths of a district count, a population,
+  // an open district and a piece number. Populations are only kept while
+  // the bounds are on.
+  uint32_t num_words_;
+  uint32_t max_open_;
+  uint32_t count_bits_;
+  uint32_t pop_bits_;
+  uint32_t label_bits_;
+  uint32_t piece_bits_;
+
+  // An unpacked state: the number of districts started, finished and
+  // open, the population of each open district, and the open district and
+  // piece of each frontier node.
+  uint32_t used_;
+  uint32_t num_finished_;
+  uint32_t num_open_;
+  vector<uint32_t> pops_;
+  vector<uint32_t> frontier_labels_;
+  vector<uint32_t> frontier_pieces_;
+
+  // Scratch space for Expand.
+  vector<uint32_t> parent_;
+  vector<uint32_t> members_;
+  vector<uint32_t> members_kept_;
+  vector<uint32_t> renumbered_;
+  vector<uint32_t> node_labels_;
+  vector<uint32_t> closing_;
+  vector<uint32_t> relabeled_;
+  vector<uint32_t> new_pops_;
+
+  // The states of every layer kept by List, mapped to their number of
+  // completions, and the labels of the partition being listed.
+  vector<StateTable> layers_;
+  vector<uint32_t> current_;
+
+  // The listed partitions, num_nodes_ labels each.
+  uint64_t num_listed_;
+  vector<uint32_t> plans_;
+
+  uint64_t max_states_;
+};        // class Enumerator
+
+}         // namespace rakan
+
+#endif    // ENUMERATE_ENUMERATOR_H_
@@ -0,0 +1,254 @@
+#include "./BoundarySampler.h"
+
+#include <inttypes.h>         // for uint32_t, uint64_t
+
+#include <algorithm>          // for std::upper_bound
+#include <functional>         // for std::function
+
+#include "./Graph.h"          // for Graph class
+
+namespace rakan {
+
+///////////////////////////////////////////////////////////////////////////////
+// Constructors and destructors
+///////////////////////////////////////////////////////////////////////////////
+
+BoundarySampler::BoundarySampler()
+    : graph_(nullptr),
+      num_slots_(0),
+      weights_(nullptr),
+      tree_(nullptr),
+      top_bit_(0),
+      updates_(0) {}
+
+BoundarySampler::~BoundarySampler() {
+  delete[] weights_;
+  delete[] tree_;
+}
+
+void BoundarySampler::Build(Graph *graph) {
+  uint32_t i, p;
+
+  graph_ = graph;
+  num_slots_ = graph_->adj_offsets_[graph_->num_nodes_];
+
+  delete[] weights_;
+  delete[] tree_;
+  weights_ = new double[num_slots_];
+  tree_ = new double[num_slots_ + 1];
+
+  top_bit_ = 1;
+  while (top_bit_ * 2 <= num_slots_) {
+    top_bit_ *= 2;
+  }
+
+  for (i = 0; i < graph_->num_nodes_; i++) {
+    for (p = graph_->adj_offsets_[i]; p < graph_->adj_offsets_[i + 1]; p++) {
+      weights_[p] = SlotWeight(i, p, graph_->num_nodes_, 0);
+    }
+  }
+
+  RebuildTree();
+}
+
+void BoundarySampler::SetWeightFunction(
+    std::function<double(uint32_t, uint32_t)> weight) {
+  weight_ = weight;
+  if (graph_ != nullptr) {
+    Build(graph_);
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Mutators
+///////////////////////////////////////////////////////////////////////////////
+
+void BoundarySampler::UpdateMove(uint32_t node) {
+  uint32_t p;
+
+  UpdateNode(node);
+  for (p = graph_->adj_offsets_[node]; p < graph_->adj_offsets_[node + 1];
+       p++) {
+    UpdateNode(graph_->adj_[p]);
+  }
+
+  if (updates_ > num_slots_) {
+    RebuildTree();
+  }
+}
+
+void BoundarySampler::UpdateNode(uint32_t node) {
+  uint32_t p, i;
+  double weight, delta;
+
+  for (p = graph_->adj_offsets_[node]; p < graph_->adj_offsets_[node + 1];
+       p++) {
+    weight = SlotWeight(node, p, graph_->num_nodes_, 0);
+    if (weight == weights_[p]) {
+      continue;
+    }
+
+    delta = weight - weights_[p];
+    weights_[p] = weight;
+    for (i = p + 1; i <= num_slots_; i += i & (~i + 1)) {
+      tree_[i] += delta;
+    }
+    updates_++;
+  }
+}
+
+void BoundarySampler::RebuildTree() {
+  uint32_t i, parent;
+
+  tree_[0] = 0;
+  for (i = 1; i <= num_slots_; i++) {
+    tree_[i] = weights_[i - 1];
+  }
+  for (i = 1; i <= num_slots_; i++) {
+    parent = i + (i & (~i + 1));
+    if (parent <= num_slots_) {
+      tree_[parent] += tree_[i];
+    }
+  }
+
+  updates_ = 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Queries
+///////////////////////////////////////////////////////////////////////////////
+
+bool BoundarySampler::Sample(double u, uint32_t *node,
+                             uint32_t *district) const {
+  uint32_t pos = 0, step, slot;
+  double target = u * Total();
+
+  if (num_slots_ == 0 || Total() <= 0) {
+    return false;
+  }
+
+  // Descend the tree to the slot whose prefix interval contains target.
+  for (step = top_bit_; step > 0; step >>= 1) {
+    if (pos + step <= num_slots_ && tree_[pos + step] <= target) {
+      pos += step;
+      target -= tree_[pos];
+    }
+  }
+  slot = pos;
+
+  // Rounding can land on an empty slot at the ends of the interval.
+  while (slot < num_slots_ && weights_[slot] <= 0) {
+    slot++;
+  }
+  while (slot >= num_slots_ || weights_[slot] <= 0) {
+    if (slot == 0) {
+      return false;
+    }
+    slot--;
+  }
+
+  *node = std::upper_bound(graph_->adj_offsets_,
+                           graph_->adj_offsets_ + graph_->num_nodes_ + 1,
+                           slot) - graph_->adj_offsets_ - 1;
+  *district = graph_->district_of_node_[graph_->adj_[slot]];
+  return true;
+}
+
+double BoundarySampler::Total() const {
+  uint32_t i;
+  double sum = 0;
+
+  for (i = num_slots_; i > 0; i -= i & (~i + 1)) {
+    sum += tree_[i];
+  }
+
+  return sum;
+}
+
+double BoundarySampler::Weight(uint32_t node, uint32_t district) const {
+  uint32_t p;
+
+  for (p = graph_->adj_offsets_[node]; p < graph_->adj_offsets_[node + 1];
+       p++) {
+    if (weights_[p] > 0 &&
+        graph_->district_of_node_[graph_->adj_[p]] == district) {
+      return weights_[p];
+    }
+  }
+
+  return 0;
+}
+
+double BoundarySampler::Probability(uint32_t node, uint32_t district) const {
+  double total = Total();
+
+  if (total <= 0) {
+    return 0;
+  }
+  return Weight(node, district) / total;
+}
+
+double BoundarySampler::ReverseProbability(uint32_t node,
+                                           uint32_t new_district) const {
+  uint32_t p, q, neighbor;
+  uint32_t old_district = graph_->district_of_node_[node];
+  double total = Total(), weight, reverse_weight = 0;
+
+  // Only the slots of the node and its neighbors can change.
+  for (p = graph_->adj_offsets_[node]; p < graph_->adj_offsets_[node + 1];
+       p++) {
+    weight = SlotWeight(node, p, node, new_district);
+    total += weight - weights_[p];
+    if (weight > 0 &&
+        graph_->district_of_node_[graph_->adj_[p]] == old_district) {
+      reverse_weight = weight;
+    }
+
+    neighbor = graph_->adj_[p];
+    for (q = graph_->adj_offsets_[neighbor];
+         q < graph_->adj_offsets_[neighbor + 1]; q++) {
+      total += SlotWeight(neighbor, q, node, new_district) - weights_[q];
+    }
+  }
+
+  if (total <= 0) {
+    return 0;
+  }
+  return reverse_weight / total;
+}
+
+double BoundarySampler::SlotWeight(uint32_t node, uint32_t slot,
+                                   uint32_t override_node,
+                                   uint32_t override_district) const {
+  uint32_t p, district, neighbor_district;
+
+  district = DistrictOf(node, override_node, override_district);
+  neighbor_district = DistrictOf(graph_->adj_[slot],
+                                 override_node, override_district);
+  if (neighbor_district == district) {
+    return 0;
+  }
+
+  // Only the first neighbor in each foreign district carries the move.
+  for (p = graph_->adj_offsets_[node]; p < slot; p++) {
+    if (DistrictOf(graph_->adj_[p], override_node, override_district) ==
+        neighbor_district) {
+      return 0;
+    }
+  }
+
+  return weight_ ? weight_(node, neighbor_district) : 1;
+}
+
+uint32_t BoundarySampler::DistrictOf(uint32_t node,
+                                     uint32_t override_node,
+                                     uint32_t override_district) const {
+  if (node == override_node) {
+    return override_district;
+  }
+  return graph_->district_of_node_[node];
+}
+
+}   // namespace rakan
@@ -0,0 +1,170 @@
+#ifndef SRC_BOUNDARYSAMPLER_H_
+#define SRC_BOUNDARYSAMPLER_H_
+
+#include <inttypes.h>         // for uint32_t, uint64_t
+
+#include <functional>         // for std::function
+
+#include "./Graph.h"          // for Graph class
+
+namespace rakan {
+
+/*
+* A weighted sampler over the boundary moves of a graph. A boundary move is a
+* (node, target district) pair where the node borders the target district
+* but does not belong to it. Weights are kept in a Fenwick tree indexed by
+* the graph's flattened adjacency, so sampling and the update after a move
+* are both logarithmic in the number of edges.
+*
+* Each node owns one slot per neighbor. A slot is active iff the neighbor is
+* in another district and is the first neighbor of the node, in adjacency
+* order, to be in that district; every boundary move therefore has exactly
+* one active slot.
+*/
+class BoundarySampler {
+ public:
+  /////////////////////////////////////////////////////////////////////////////
+  // Constructors and destructors
+  /////////////////////////////////////////////////////////////////////////////
+
+  /*
+  * Default constructor. The sampler is empty until Build is called.
+  */
+  BoundarySampler();
+
+  /*
+  * Default destructor.
+  */
+  ~BoundarySampler();
+
+  BoundarySampler(const BoundarySampler &other) = delete;
+  BoundarySampler &operator=(const BoundarySampler &other) = delete;
+
+  /*
+  * Builds the sampler over the current districts of the given graph. The
+  * graph's flattened adjacency and districts must already be populated.
+  *
+  * @param    graph   the graph to sample boundary moves from
+  */
+  void Build(Graph *graph);
+
+  /*
+  * Sets the weight of each boundary move. The weight may depend only on the
+  * node and the target district, and must be non-negative. Rebuilds the
+  * sampler if it has already been built.
+  *
+  * @param    weight    a function from (node ID, district) to weight; an
+  *                     empty function weights all moves equally
+  */
+  void SetWeightFunction(std::function<double(uint32_t, uint32_t)> weight);
+
+  /////////////////////////////////////////////////////////////////////////////
+  // Mutators
+  /////////////////////////////////////////////////////////////////////////////
+
+  /*
+  * Updates the sampler after the given node has changed district. Only the
+  * slots of the node and its neighbors are recomputed.
+  *
+  * @param    node    the ID of the node that moved
+  */
+  void UpdateMove(uint32_t node);
+
+  /////////////////////////////////////////////////////////////////////////////
+  // Queries
+  /////////////////////////////////////////////////////////////////////////////
+
+  /*
+  * Draws a boundary move in proportion to its weight.
+  *
+  * @param    u           a uniform random number in [0, 1)
+  * @param    node        the return parameter for the node to move
+  * @param    district    the return parameter for the target district
+  *
+  * @return true iff a move was drawn; false if there are no boundary moves
+  */
+  bool Sample(double u, uint32_t *node, uint32_t *district) const;
+
+  /*
+  * Gets the total weight of all boundary moves.
+  *
+  * @return the total weight
+  */
+  double Total() const;
+
+  /*
+  * Gets the weight of the given boundary move in the current plan.
+  *
+  * @param    node        the node to move
+  * @param    district    the target district
+  *
+  * @return the weight of the move; 0 if it is not a boundary move
+  */
+  double Weight(uint32_t node, uint32_t district) const;
+
+  /*
+  * Gets the probability that Sample draws the given move.
+  *
+  * @param    node        the node to move
+  * @param    district    the target district
+  *
+  * @return the forward proposal probability of the move
+  */
+  double Probability(uint32_t node, uint32_t district) const;
+
+  /*
+  * Gets the probability that, after the given node moves into the given
+  * district, Sample draws the move that sends it back. Does not modify the
+  * sampler or the graph.
+  *
+  * @param    node            the node that would move
+  * @param    new_district    the district the node would move into
+  *
+  * @return the reverse proposal probability of the move
+  */
+  double ReverseProbability(uint32_t node, uint32_t new_district) const;
+
+ private:
+  // Computes the weight of a slot, pretending that override_node is in
+  // override_district.
+  double SlotWeight(uint32_t node, uint32_t slot,
+                    uint32_t override_node, uint32_t override_district) const;
+
+  // Gets the district of a node, pretending that override_node is in
+  // override_district.
+  uint32_t DistrictOf(uint32_t node,
+                      uint32_t override_node,
+                      uint32_t override_district) const;
+
+  // Recomputes the slots of a single node.
+  void UpdateNode(uint32_t node);
+
+  // Rebuilds the Fenwick tree from the slot weights.
+  void RebuildTree();
+
+  // The graph this sampler draws from.
+  Graph *graph_;
+
+  // The number of slots, equal to the length of the flattened adjacency.
+  uint32_t num_slots_;
+
+  // The weight of each slot.
+  double *weights_;
+
+  // The Fenwick tree over weights_, 1-indexed.
+  double *tree_;
+
+  // The largest power of two no greater than num_slots_.
+  uint32_t top_bit_;
+
+  // The number of slot updates since the tree was last rebuilt. The tree is
+  // rebuilt periodically to bound floating point drift.
+  uint64_t updates_;
+
+  // The weight of a boundary move; empty for uniform weights.
+  std::function<double(uint32_t, uint32_t)> weight_;
+};        // class BoundarySampler
+
+}         // namespace rakan
+
+#endif    // SRC_BOUNDARYSAMPLER_H_
@@ -0,0 +1,102 @@
+#include "./ContiguityChecker.h"
+
+#include <inttypes.h>         // for uint32_t
+
+#include <algorithm>          // for std::fill
+#include <vector>             // for std::vector
+
+#include "./Graph.h"          // for Graph class
+
+namespace rakan {
+
+///////////////////////////////////////////////////////////////////////////////
+// Constructors and destructors
+///////////////////////////////////////////////////////////////////////////////
+
+ContiguityChecker::ContiguityChecker()
+    : graph_(nullptr),
+      stamp_(0) {}
+
+ContiguityChecker::~ContiguityChecker() {}
+
+void ContiguityChecker::Reserve(Graph *graph) {
+  graph_ = graph;
+  queue_.resize(graph->num_nodes_);
+  visited_.assign(graph->num_nodes_, 0);
+  targets_.assign(graph->num_nodes_, 0);
+  stamp_ = 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Queries
+///////////////////////////////////////////////////////////////////////////////
+
+bool ContiguityChecker::IsSevered(uint32_t node) {
+  uint32_t district = graph_->district_of_node_[node];
+  uint32_t p, q, current, neighbor, head = 0, tail = 0;
+  uint32_t num_targets = 0, num_found = 1;
+
+  if (++stamp_ == 0) {
+    // The stamp wrapped around; forget every old visit.
+    std::fill(visited_.begin(), visited_.end(), 0);
+    std::fill(targets_.begin(), targets_.end(), 0);
+    stamp_ = 1;
+  }
+
+  // Every neighbor left in the district must still be reachable from the
+  // first one without passing the node.
+  for (p = graph_->adj_offsets_[node]; p < graph_->adj_offsets_[node + 1];
+       p++) {
+    neighbor = graph_->adj_[p];
+    if (graph_->LoadDistrict(neighbor) == district) {
+      targets_[neighbor] = stamp_;
+      if (num_targets++ == 0) {
+        queue_[tail++] = neighbor;
+        visited_[neighbor] = stamp_;
+      }
+    }
+  }
+  if (num_targets <= 1) {
+    return false;
+  }
+  visited_[node] = stamp_;
+
+  // Try the neighbors' direct connections first, as in
+  // Runner::IsDistrictSevered, then the whole district.
+  while (head < tail) {
+    current = queue_[head++];
+    for (q = graph_->adj_offsets_[current];
+         q < graph_->adj_offsets_[current + 1]; q++) {
+      neighbor = graph_->adj_[q];
+      if (targets_[neighbor] == stamp_ && visited_[neighbor] != stamp_) {
+        visited_[neighbor] = stamp_;
+        queue_[tail++] = neighbor;
+        if (++num_found == num_targets) {
+          return false;
+        }
+      }
+    }
+  }
+
+  head = 0;
+  while (head < tail) {
+    current = queue_[head++];
+    for (q = graph_->adj_offsets_[current];
+         q < graph_->adj_offsets_[current + 1]; q++) {
+      neighbor = graph_->adj_[q];
+      if (visited_[neighbor] != stamp_ &&
+          graph_->LoadDistrict(neighbor) == district) {
+        visited_[neighbor] = stamp_;
+        queue_[tail++] = neighbor;
+        if (targets_[neighbor] == stamp_ && ++num_found == num_targets) {
+          return false;
+        }
+      }
+    }
+  }
+
+  return true;
+}
+
+}   // namespace rakan
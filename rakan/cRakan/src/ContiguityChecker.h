@@ -0,0 +1,76 @@
+#ifndef SRC_CONTIGUITYCHECKER_H_
+#define SRC_CONTIGUITYCHECKER_H_
+
+#include <inttypes.h>         // for uint32_t
+
+#include <vector>             // for std::vector
+
+#include "./Graph.h"          // for Graph class
+
+using std::vector;
+
+namespace rakan {
+
+/*
+* Checks whether single-node moves would sever a district, with its own
+* traversal scratch space. Kernels that check moves on several threads at
+* once keep one checker per thread; the Runner's own checks share its
+* scratch space instead, see Runner::IsDistrictSevered.
+*/
+class ContiguityChecker {
+ public:
+  /////////////////////////////////////////////////////////////////////////////
+  // Constructors and destructors
+  /////////////////////////////////////////////////////////////////////////////
+
+  /*
+  * Default constructor. The checker must be reserved before use.
+  */
+  ContiguityChecker();
+
+  /*
+  * Default destructor.
+  */
+  ~ContiguityChecker();
+
+  /*
+  * Sizes the checker's scratch space for the given graph, so that checks on
+  * it do not allocate.
+  *
+  * @param    graph   the graph whose moves will be checked; its flattened
+  *                   adjacency must be built
+  */
+  void Reserve(Graph *graph);
+
+  /////////////////////////////////////////////////////////////////////////////
+  // Queries
+  /////////////////////////////////////////////////////////////////////////////
+
+  /*
+  * Queries whether the district of the given node would be severed once
+  * the node is removed from it. Only the node's district is traversed, so
+  * other districts may be changed concurrently as long as none of their
+  * nodes move into or out of this one.
+  *
+  * @param    node    the ID of the node that would be removed
+  *
+  * @return true iff the district would be severed
+  */
+  bool IsSevered(uint32_t node);
+
+ private:
+  // The graph that is checked.
+  Graph *graph_;
+
+  // A node has been visited by the current traversal iff its entry in
+  // visited_ equals stamp_; targets_ marks the nodes a traversal is
+  // looking for the same way.
+  vector<uint32_t> queue_;
+  vector<uint32_t> visited_;
+  vector<uint32_t> targets_;
+  uint32_t stamp_;
+};        // class ContiguityChecker
+
+}         // namespace rakan
+
+#endif    // SRC_CONTIGUITYCHECKER_H_
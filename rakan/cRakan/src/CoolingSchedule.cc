@@ -0,0 +1,90 @@
+#include "./CoolingSchedule.h"
+
+#include <inttypes.h>         // for uint64_t
+
+namespace rakan {
+
+///////////////////////////////////////////////////////////////////////////////
+// GeometricCooling
+///////////////////////////////////////////////////////////////////////////////
+
+GeometricCooling::GeometricCooling(double initial, double rate)
+    : initial_(initial),
+      rate_(rate),
+      temperature_(initial) {}
+
+void GeometricCooling::Reset() {
+  temperature_ = initial_;
+}
+
+void GeometricCooling::Update(bool) {
+  temperature_ *= rate_;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// LinearCooling
+///////////////////////////////////////////////////////////////////////////////
+
+LinearCooling::LinearCooling(double initial, double final, uint64_t num_steps)
+    : initial_(initial),
+      final_(final),
+      num_steps_(num_steps),
+      step_(0) {}
+
+void LinearCooling::Reset() {
+  step_ = 0;
+}
+
+double LinearCooling::GetTemperature() const {
+  if (step_ >= num_steps_) {
+    return final_;
+  }
+  return initial_ + (final_ - initial_) * step_ / num_steps_;
+}
+
+void LinearCooling::Update(bool) {
+  step_++;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// AdaptiveCooling
+///////////////////////////////////////////////////////////////////////////////
+
+AdaptiveCooling::AdaptiveCooling(double initial, double target_rate,
+                                 uint64_t window, double factor)
+    : initial_(initial),
+      target_rate_(target_rate),
+      window_(window),
+      factor_(factor),
+      temperature_(initial),
+      steps_in_window_(0),
+      accepted_in_window_(0) {}
+
+void AdaptiveCooling::Reset() {
+  temperature_ = initial_;
+  steps_in_window_ = 0;
+  accepted_in_window_ = 0;
+}
+
+void AdaptiveCooling::Update(bool accepted) {
+  steps_in_window_++;
+  if (accepted) {
+    accepted_in_window_++;
+  }
+
+  if (steps_in_window_ < window_) {
+    return;
+  }
+
+  if (accepted_in_window_ > target_rate_ * steps_in_window_) {
+    temperature_ *= factor_;
+  } else {
+    temperature_ /= factor_;
+  }
+  steps_in_window_ = 0;
+  accepted_in_window_ = 0;
+}
+
+}   // namespace rakan
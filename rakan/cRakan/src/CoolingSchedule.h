@@ -0,0 +1,123 @@
+#ifndef SRC_COOLINGSCHEDULE_H_
+#define SRC_COOLINGSCHEDULE_H_
+
+#include <inttypes.h>         // for uint64_t
+
+namespace rakan {
+
+/*
+* A temperature schedule for simulated annealing. The annealer reads the
+* temperature before every step and reports the outcome of the step
+* afterwards.
+*/
+class CoolingSchedule {
+ public:
+  virtual ~CoolingSchedule() {}
+
+  /*
+  * Restarts the schedule from its initial temperature.
+  */
+  virtual void Reset() = 0;
+
+  /*
+  * Gets the temperature for the next step.
+  *
+  * @return the current temperature, positive
+  */
+  virtual double GetTemperature() const = 0;
+
+  /*
+  * Advances the schedule by one step.
+  *
+  * @param    accepted    whether the step's proposal was accepted
+  */
+  virtual void Update(bool accepted) = 0;
+};        // class CoolingSchedule
+
+/*
+* Cools geometrically: the temperature is multiplied by a fixed rate after
+* every step.
+*/
+class GeometricCooling : public CoolingSchedule {
+ public:
+  /*
+  * @param    initial   the initial temperature
+  * @param    rate      the factor applied after every step, in (0, 1]
+  */
+  GeometricCooling(double initial, double rate);
+
+  void Reset() override;
+  double GetTemperature() const override { return temperature_; }
+  void Update(bool accepted) override;
+
+ private:
+  double initial_;
+  double rate_;
+  double temperature_;
+};        // class GeometricCooling
+
+/*
+* Cools linearly from an initial to a final temperature over a fixed number
+* of steps, then stays at the final temperature.
+*/
+class LinearCooling : public CoolingSchedule {
+ public:
+  /*
+  * @param    initial     the initial temperature
+  * @param    final       the final temperature, positive
+  * @param    num_steps   the number of steps to reach the final temperature
+  */
+  LinearCooling(double initial, double final, uint64_t num_steps);
+
+  void Reset() override;
+  double GetTemperature() const override;
+  void Update(bool accepted) override;
+
+ private:
+  double initial_;
+  double final_;
+  uint64_t num_steps_;
+  uint64_t step_;
+};        // class LinearCooling
+
+/*
+* Adapts the temperature to hold the acceptance rate near a target. After
+* every window of steps, the temperature is multiplied by the factor if
+* more proposals than the target were accepted in the window, and divided
+* by it otherwise. Decreasing the target over a run cools it.
+*/
+class AdaptiveCooling : public CoolingSchedule {
+ public:
+  /*
+  * @param    initial       the initial temperature
+  * @param    target_rate   the acceptance rate to hold, in (0, 1)
+  * @param    window        the number of steps between adjustments
+  * @param    factor        the factor to adjust by, in (0, 1)
+  */
+  AdaptiveCooling(double initial, double target_rate, uint64_t window,
+                  double factor);
+
+  void Reset() override;
+  double GetTemperature() const override { return temperature_; }
+  void Update(bool accepted) override;
+
+  /*
+  * Sets the acceptance rate to hold from the next window on.
+  *
+  * @param    target_rate   the acceptance rate to hold, in (0, 1)
+  */
+  void SetTargetRate(double target_rate) { target_rate_ = target_rate; }
+
+ private:
+  double initial_;
+  double target_rate_;
+  uint64_t window_;
+  double factor_;
+  double temperature_;
+  uint64_t steps_in_window_;
+  uint64_t accepted_in_window_;
+};        // class AdaptiveCooling
+
+}         // namespace rakan
+
+#endif    // SRC_COOLINGSCHEDULE_H_
@@ -0,0 +1,88 @@
+#include "./Ensemble.h"
+
+#include <inttypes.h>         // for uint32_t, uint64_t
+
+#include <vector>             // for std::vector
+
+#include "./Graph.h"          // for Graph class
+#include "./Runner.h"         // for Runner class
+
+namespace rakan {
+
+///////////////////////////////////////////////////////////////////////////////
+// Constructors and destructors
+///////////////////////////////////////////////////////////////////////////////
+
+Ensemble::Ensemble(Runner *base, uint32_t num_chains, uint32_t num_threads)
+    : pool_(num_threads) {
+  uint32_t i;
+  Graph *graph;
+  Runner *chain;
+
+  for (i = 0; i < num_chains; i++) {
+    graph = new Graph(*base->GetGraph());
+    chain = new Runner(graph);
+    chain->CopySettings(*base);
+    chain->AdoptGraphData();
+    graphs_.push_back(graph);
+    chains_.push_back(chain);
+  }
+
+  sinks_.resize(num_chains);
+  num_samples_.assign(num_chains, 0);
+
+  SetSeed(base->GetRng()->Next());
+}
+
+Ensemble::~Ensemble() {
+  uint32_t i;
+
+  for (i = 0; i < chains_.size(); i++) {
+    delete chains_[i];
+    delete graphs_[i];
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Settings
+///////////////////////////////////////////////////////////////////////////////
+
+void Ensemble::SetSeed(uint64_t seed) {
+  uint32_t i;
+
+  for (i = 0; i < chains_.size(); i++) {
+    chains_[i]->GetRng()->SeedStream(seed, i);
+  }
+}
+
+void Ensemble::SetSink(Sink sink) {
+  uint32_t i;
+
+  for (i = 0; i < sinks_.size(); i++) {
+    sinks_[i] = sink;
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Algorithms
+///////////////////////////////////////////////////////////////////////////////
+
+void Ensemble::Run(uint64_t num_samples, uint32_t steps_per_sample) {
+  auto run_chain = [this, num_samples, steps_per_sample](uint32_t chain) {
+    uint64_t s;
+
+    for (s = 0; s < num_samples; s++) {
+      chains_[chain]->Walk(steps_per_sample);
+      if (sinks_[chain]) {
+        sinks_[chain](chain, num_samples_[chain], chains_[chain]);
+      }
+      num_samples_[chain]++;
+    }
+  };
+
+  pool_.ParallelFor(chains_.size(), run_chain);
+}
+
+}   // namespace rakan
@@ -0,0 +1,138 @@
+#ifndef SRC_ENSEMBLE_H_
+#define SRC_ENSEMBLE_H_
+
+#include <inttypes.h>         // for uint32_t, uint64_t
+
+#include <functional>         // for std::function
+#include <vector>             // for std::vector
+
+#include "./Graph.h"          // for Graph class
+#include "./Runner.h"         // for Runner class
+#include "./ThreadPool.h"     // for ThreadPool class
+
+using std::vector;
+
+namespace rakan {
+
+/*
+* A driver for an ensemble of independent chains. Each chain is a Runner on
+* its own copy of the plan; the nodes, the flattened adjacency and the
+* node populations are shared with the base graph. Chains are spread over
+* a fixed-size thread pool.
+*
+* Chain i draws from stream i of the ensemble's seed and never interacts
+* with other chains, so the samples of every chain are identical for any
+* number of threads.
+*/
+class Ensemble {
+ public:
+  /*
+  * Receives a sample. Called on the thread running the chain, with the
+  * chain's index, the index of the sample within the chain, and the
+  * chain's Runner. Calls for one chain never overlap, and are made in
+  * sample order; calls for different chains may run concurrently.
+  */
+  typedef std::function<void(uint32_t, uint64_t, Runner *)> Sink;
+
+  /////////////////////////////////////////////////////////////////////////////
+  // Constructors and destructors
+  /////////////////////////////////////////////////////////////////////////////
+
+  /*
+  * Creates the chains from a Runner whose graph data has been populated.
+  * Every chain starts from the base Runner's current plan and settings.
+  *
+  * @param    base          the Runner to copy the plan and settings of
+  * @param    num_chains    the number of chains
+  * @param    num_threads   the number of threads to run chains on; 0 uses
+  *                         one per hardware thread
+  */
+  Ensemble(Runner *base, uint32_t num_chains, uint32_t num_threads);
+
+  /*
+  * Destroys all chains and their graphs.
+  */
+  ~Ensemble();
+
+  Ensemble(const Ensemble &other) = delete;
+  Ensemble &operator=(const Ensemble &other) = delete;
+
+  /////////////////////////////////////////////////////////////////////////////
+  // Settings
+  /////////////////////////////////////////////////////////////////////////////
+
+  /*
+  * Seeds chain i with stream i of the given seed.
+  *
+  * @param    seed    the seed to derive all streams from
+  */
+  void SetSeed(uint64_t seed);
+
+  /*
+  * Sets the sink of one chain.
+  *
+  * @param    chain   the chain to set the sink of
+  * @param    sink    the function to hand the chain's samples to; empty
+  *                   for none
+  */
+  void SetSink(uint32_t chain, Sink sink) { sinks_[chain] = sink; }
+
+  /*
+  * Sets the same sink for every chain.
+  *
+  * @param    sink    the function to hand every chain's samples to
+  */
+  void SetSink(Sink sink);
+
+  /////////////////////////////////////////////////////////////////////////////
+  // Algorithms
+  /////////////////////////////////////////////////////////////////////////////
+
+  /*
+  * Runs every chain for the given number of samples, handing each sample
+  * to the chain's sink. Returns once all chains have finished.
+  *
+  * @param    num_samples         the number of samples to take per chain
+  * @param    steps_per_sample    the number of steps each chain walks
+  *                               between samples
+  */
+  void Run(uint64_t num_samples, uint32_t steps_per_sample);
+
+  /////////////////////////////////////////////////////////////////////////////
+  // Queries
+  /////////////////////////////////////////////////////////////////////////////
+
+  /*
+  * Gets the Runner of the given chain.
+  *
+  * @param    chain   the chain
+  *
+  * @return the Runner of the chain
+  */
+  Runner *GetChain(uint32_t chain) { return chains_[chain]; }
+
+  /*
+  * Gets the number of chains.
+  *
+  * @return the number of chains
+  */
+  uint32_t GetNumChains() const { return chains_.size(); }
+
+ private:
+  // The chains and the graphs they walk on, indexed by chain.
+  vector<Runner *> chains_;
+  vector<Graph *> graphs_;
+
+  // The sink of each chain.
+  vector<Sink> sinks_;
+
+  // The number of samples each chain has taken so far.
+  vector<uint64_t> num_samples_;
+
+  // Runs the chains.
+  ThreadPool pool_;
+};        // class Ensemble
+
+}         // namespace rakan
+
+#endif    // SRC_ENSEMBLE_H_
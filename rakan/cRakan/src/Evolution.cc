@@ -0,0 +1,375 @@
+#include "./Evolution.h"
+
+#include <inttypes.h>         // for uint32_t, uint64_t, uint8_t
+#include <math.h>             // for HUGE_VAL
+
+#include <algorithm>          // for std::stable_sort
+#include <vector>             // for std::vector
+
+#include "./Graph.h"          // for Graph class
+#include "./ReturnCodes.h"    // for SUCCESS
+#include "./Runner.h"         // for Runner class
+
+namespace rakan {
+
+// Derives the seed of one child's generator for one generation. The first
+// population is generation 0.
+static uint64_t ChildSeed(uint64_t seed, uint32_t generation,
+                          uint32_t child) {
+  return seed ^ (generation * 0x9e3779b97f4a7c15ULL) ^
+         (child * 0xc2b2ae3d27d4eb4fULL);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Constructors and destructors
+///////////////////////////////////////////////////////////////////////////////
+
+Evolution::Evolution(Runner *base, uint32_t population_size,
+                     uint32_t num_threads)
+    : num_nodes_(base->GetGraph()->num_nodes_),
+      num_districts_(base->GetGraph()->num_districts_),
+      population_size_(population_size),
+      width_(base->GetGraph()->num_districts_ <= 256 ? 1 : 2),
+      generation_(0),
+      num_invalid_(0),
+      pool_(num_threads) {
+  uint32_t i;
+  Worker worker;
+
+  plan_bytes_ = (uint64_t) width_ * num_nodes_;
+  plans_.resize(plan_bytes_ * population_size_);
+  children_.resize(plan_bytes_ * population_size_);
+  scores_.assign(population_size_, HUGE_VAL);
+  child_scores_.assign(population_size_, HUGE_VAL);
+  parents_.resize(2 * population_size_);
+  rank_.resize(population_size_);
+  for (i = 0; i < population_size_; i++) {
+    rank_[i] = i;
+  }
+
+  start_.resize(plan_bytes_);
+  Store(base->GetGraph()->district_of_node_, start_.data());
+
+  worker.labels.resize(num_nodes_);
+  worker.piece.resize(num_nodes_);
+  worker.queue.resize(num_nodes_);
+  worker.piece_pop.reserve(num_nodes_);
+  worker.piece_order.reserve(num_nodes_);
+  worker.piece_label.reserve(num_nodes_);
+  worker.taken.resize(num_districts_);
+  for (i = 0; i < pool_.GetNumThreads(); i++) {
+    worker.graph = new Graph(*base->GetGraph());
+    worker.runner = new Runner(worker.graph);
+    worker.runner->CopySettings(*base);
+    worker.runner->AdoptGraphData();
+    worker.pool = new ThreadPool(1);
+    workers_.push_back(worker);
+  }
+
+  SetSeed(base->GetRng()->Next());
+}
+
+Evolution::~Evolution() {
+  for (auto &worker : workers_) {
+    delete worker.runner;
+    delete worker.graph;
+    delete worker.pool;
+  }
+}
+
+void Evolution::SetSeed(uint64_t seed) {
+  seed_ = seed;
+  rng_.SeedStream(seed, 0);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Algorithms
+///////////////////////////////////////////////////////////////////////////////
+
+double Evolution::Run(uint32_t num_generations, uint32_t burst_length) {
+  uint32_t i;
+
+  if (population_size_ == 0) {
+    return HUGE_VAL;
+  }
+
+  if (generation_ == 0) {
+    Populate(burst_length);
+  }
+  for (i = 0; i < num_generations; i++) {
+    generation_++;
+    Breed(burst_length);
+    Select();
+  }
+
+  return scores_[rank_[0]];
+}
+
+void Evolution::GetPlan(uint32_t rank, uint32_t *districts) const {
+  const uint8_t *plan = &plans_[rank_[rank] * plan_bytes_];
+  uint32_t v;
+
+  for (v = 0; v < num_nodes_; v++) {
+    districts[v] = Label(plan, v);
+  }
+}
+
+void Evolution::Store(const uint32_t *districts, uint8_t *plan) const {
+  uint32_t v;
+
+  for (v = 0; v < num_nodes_; v++) {
+    if (width_ == 1) {
+      plan[v] = districts[v];
+    } else {
+      plan[2 * v] = districts[v] & 0xff;
+      plan[2 * v + 1] = districts[v] >> 8;
+    }
+  }
+}
+
+void Evolution::Populate(uint32_t burst_length) {
+  uint32_t num_workers = workers_.size(), i;
+
+  auto run_block = [this, num_workers, burst_length](uint32_t block) {
+    Worker *worker = &workers_[block];
+    uint32_t plan, v;
+
+    for (plan = block; plan < population_size_; plan += num_workers) {
+      worker->runner->GetRng()->Seed(ChildSeed(seed_, 0, plan));
+      for (v = 0; v < num_nodes_; v++) {
+        worker->labels[v] = Label(start_.data(), v);
+      }
+      scores_[plan] = Finish(worker, burst_length,
+                             &plans_[plan * plan_bytes_]);
+    }
+  };
+  pool_.ParallelFor(num_workers, run_block);
+
+  for (i = 0; i < population_size_; i++) {
+    num_invalid_ += scores_[i] == HUGE_VAL;
+  }
+  std::stable_sort(rank_.begin(), rank_.end(), [this](uint32_t a, uint32_t b) {
+    return scores_[a] < scores_[b];
+  });
+}
+
+void Evolution::Breed(uint32_t burst_length) {
+  uint32_t num_workers = workers_.size(), i;
+
+  // Parents are picked serially, so that they do not depend on how the
+  // children are split among threads.
+  for (i = 0; i < 2 * population_size_; i++) {
+    parents_[i] = Tournament();
+  }
+
+  auto run_block = [this, num_workers, burst_length](uint32_t block) {
+    Worker *worker = &workers_[block];
+    const uint8_t *first, *second;
+    uint32_t child, v;
+
+    for (child = block; child < population_size_; child += num_workers) {
+      worker->runner->GetRng()->Seed(ChildSeed(seed_, generation_, child));
+      first = &plans_[parents_[2 * child] * plan_bytes_];
+      second = &plans_[parents_[2 * child + 1] * plan_bytes_];
+      if (!Cross(worker, first, second)) {
+        // Fall back to mutating the first parent alone.
+        for (v = 0; v < num_nodes_; v++) {
+          worker->labels[v] = Label(first, v);
+        }
+      }
+      child_scores_[child] = Finish(worker, burst_length,
+                                    &children_[child * plan_bytes_]);
+    }
+  };
+  pool_.ParallelFor(num_workers, run_block);
+
+  for (i = 0; i < population_size_; i++) {
+    num_invalid_ += child_scores_[i] == HUGE_VAL;
+  }
+}
+
+void Evolution::Select() {
+  uint32_t i, slot, num_free = 0;
+  vector<uint32_t> order(2 * population_size_), free_slots;
+  vector<bool> survives(population_size_, false);
+
+  // Entries below the population size are parents by rank, the rest are
+  // children, so a stable sort prefers parents and then lower indices.
+  for (i = 0; i < 2 * population_size_; i++) {
+    order[i] = i;
+  }
+  auto score = [this](uint32_t entry) {
+    return entry < population_size_
+        ? scores_[rank_[entry]]
+        : child_scores_[entry - population_size_];
+  };
+  std::stable_sort(order.begin(), order.end(),
+                   [&score](uint32_t a, uint32_t b) {
+                     return score(a) < score(b);
+                   });
+
+  for (i = 0; i < population_size_; i++) {
+    if (order[i] < population_size_) {
+      survives[rank_[order[i]]] = true;
+    }
+  }
+  for (slot = 0; slot < population_size_; slot++) {
+    if (!survives[slot]) {
+      free_slots.push_back(slot);
+    }
+  }
+
+  // Surviving children move into the slots of the parents they replace.
+  vector<uint32_t> new_rank(population_size_);
+  for (i = 0; i < population_size_; i++) {
+    if (order[i] < population_size_) {
+      new_rank[i] = rank_[order[i]];
+    } else {
+      slot = free_slots[num_free++];
+      std::copy(&children_[(order[i] - population_size_) * plan_bytes_],
+                &children_[(order[i] - population_size_ + 1) * plan_bytes_],
+                &plans_[slot * plan_bytes_]);
+      scores_[slot] = child_scores_[order[i] - population_size_];
+      new_rank[i] = slot;
+    }
+  }
+  rank_.swap(new_rank);
+}
+
+uint32_t Evolution::Tournament() {
+  uint32_t a = rng_.UniformInt(population_size_);
+  uint32_t b = rng_.UniformInt(population_size_);
+
+  return scores_[b] < scores_[a] ? b : a;
+}
+
+bool Evolution::Cross(Worker *worker, const uint8_t *first,
+                      const uint8_t *second) {
+  Graph *graph = worker->graph;
+  Rng *rng = worker->runner->GetRng();
+  uint32_t none = num_districts_, v, d, p, u, x, head, tail;
+  uint32_t num_taken = 0, num_pieces = 0, next_piece;
+  vector<uint32_t> &labels = worker->labels, &piece = worker->piece;
+  vector<uint32_t> &queue = worker->queue;
+  uint64_t pop;
+
+  if (num_districts_ < 2) {
+    return false;
+  }
+
+  // Take each district of the first parent with probability 1/2, but at
+  // least one of them and not all.
+  for (d = 0; d < num_districts_; d++) {
+    worker->taken[d] = rng->Uniform() < 0.5;
+    num_taken += worker->taken[d];
+  }
+  if (num_taken == 0) {
+    worker->taken[rng->UniformInt(num_districts_)] = true;
+    num_taken++;
+  } else if (num_taken == num_districts_) {
+    worker->taken[rng->UniformInt(num_districts_)] = false;
+    num_taken--;
+  }
+
+  for (v = 0; v < num_nodes_; v++) {
+    d = Label(first, v);
+    labels[v] = worker->taken[d] ? d : none;
+    piece[v] = num_nodes_;
+  }
+
+  // The rest of the graph splits into connected pieces of the second
+  // parent's districts.
+  worker->piece_pop.clear();
+  for (v = 0; v < num_nodes_; v++) {
+    if (labels[v] != none || piece[v] != num_nodes_) {
+      continue;
+    }
+    d = Label(second, v);
+    piece[v] = num_pieces;
+    queue[0] = v;
+    head = 0;
+    tail = 1;
+    pop = 0;
+    while (head < tail) {
+      u = queue[head++];
+      pop += graph->pop_of_node_[u];
+      for (p = graph->adj_offsets_[u]; p < graph->adj_offsets_[u + 1]; p++) {
+        x = graph->adj_[p];
+        if (labels[x] == none && piece[x] == num_nodes_ &&
+            Label(second, x) == d) {
+          piece[x] = num_pieces;
+          queue[tail++] = x;
+        }
+      }
+    }
+    worker->piece_pop.push_back(pop);
+    num_pieces++;
+  }
+  if (num_pieces < num_districts_ - num_taken) {
+    return false;
+  }
+
+  // The most populous pieces take the free labels, and the other pieces
+  // are left for the districts to grow over.
+  worker->piece_order.resize(num_pieces);
+  for (p = 0; p < num_pieces; p++) {
+    worker->piece_order[p] = p;
+  }
+  std::stable_sort(worker->piece_order.begin(), worker->piece_order.end(),
+                   [worker](uint32_t a, uint32_t b) {
+                     return worker->piece_pop[a] > worker->piece_pop[b];
+                   });
+  worker->piece_label.assign(num_pieces, none);
+  next_piece = 0;
+  for (d = 0; d < num_districts_; d++) {
+    if (!worker->taken[d]) {
+      worker->piece_label[worker->piece_order[next_piece++]] = d;
+    }
+  }
+
+  tail = 0;
+  for (v = 0; v < num_nodes_; v++) {
+    if (labels[v] == none) {
+      labels[v] = worker->piece_label[piece[v]];
+    }
+    if (labels[v] != none) {
+      queue[tail++] = v;
+    }
+  }
+
+  // Growing breadth first from every labeled node keeps each district
+  // contiguous.
+  for (head = 0; head < tail; head++) {
+    u = queue[head];
+    for (p = graph->adj_offsets_[u]; p < graph->adj_offsets_[u + 1]; p++) {
+      x = graph->adj_[p];
+      if (labels[x] == none) {
+        labels[x] = labels[u];
+        queue[tail++] = x;
+      }
+    }
+  }
+
+  return tail == num_nodes_;
+}
+
+double Evolution::Finish(Worker *worker, uint32_t burst_length,
+                         uint8_t *child) {
+  Runner *runner = worker->runner;
+  double score = HUGE_VAL;
+
+  // Reloading the whole plan, rather than moving the nodes that differ,
+  // leaves the worker in the same state whatever it bred before.
+  worker->graph->AssignDistricts(worker->labels.data(), worker->pool);
+  runner->AdoptGraphData();
+  if (runner->RepairPopulation() == SUCCESS) {
+    runner->Walk(burst_length);
+    score = runner->LogScore();
+  }
+
+  Store(worker->graph->district_of_node_, child);
+  return score;
+}
+
+}   // namespace rakan
@@ -0,0 +1,216 @@
+#ifndef SRC_EVOLUTION_H_
+#define SRC_EVOLUTION_H_
+
+#include <inttypes.h>         // for uint32_t, uint64_t, uint8_t
+
+#include <vector>             // for std::vector
+
+#include "./Graph.h"          // for Graph class
+#include "./Rng.h"            // for Rng class
+#include "./Runner.h"         // for Runner class
+#include "./ThreadPool.h"     // for ThreadPool class
+
+using std::vector;
+
+namespace rakan {
+
+/*
+* A population-based optimizer of a Runner's score. The population holds a
+* fixed number of plans. Every generation breeds one child per plan: two
+* parents are picked by tournaments of two, and the child takes a random
+* half of the first parent's districts whole and fills the rest of the
+* graph from the second parent. The second parent's districts, cut to the
+* remaining area, split into connected pieces; the most populous pieces
+* take the free district labels and the districts grow breadth first over
+* the other pieces, so every district is contiguous. The child's
+* population is then repaired, see Runner::RepairPopulation, and it is
+* mutated by a short burst of the base Runner's engine. Parents and
+* children compete, and the lowest scoring plans survive.
+*
+* Children are bred and scored concurrently, one worker Runner and graph
+* copy per thread. Child c of generation g always draws from a generator
+* seeded from a hash of the seed, g and c, and ties go to parents and then
+* to lower indices, so results do not depend on the number of threads.
+*
+* Plans are stored as one byte per node when there are at most 256
+* districts, and two bytes otherwise, so a population of thousands of
+* plans of a large graph fits in memory.
+*/
+class Evolution {
+ public:
+  /////////////////////////////////////////////////////////////////////////////
+  // Constructors and destructors
+  /////////////////////////////////////////////////////////////////////////////
+
+  /*
+  * Creates an optimizer from a Runner whose graph data has been
+  * populated. Every plan is scored and mutated with the base Runner's
+  * settings, and the first population is grown from its current plan.
+  *
+  * @param    base              the Runner to copy the plan and settings of
+  * @param    population_size   the number of plans kept; at least 1
+  * @param    num_threads       the number of threads to breed children on;
+  *                             0 uses one per hardware thread
+  */
+  Evolution(Runner *base, uint32_t population_size, uint32_t num_threads);
+
+  /*
+  * Destroys all workers and their graphs.
+  */
+  ~Evolution();
+
+  Evolution(const Evolution &other) = delete;
+  Evolution &operator=(const Evolution &other) = delete;
+
+  /*
+  * Seeds the optimizer. Selection and every child draw from generators
+  * derived from one seed.
+  *
+  * @param    seed    the seed to derive all streams from
+  */
+  void SetSeed(uint64_t seed);
+
+  /////////////////////////////////////////////////////////////////////////////
+  // Algorithms
+  /////////////////////////////////////////////////////////////////////////////
+
+  /*
+  * Runs generations. The first call first fills the population with
+  * bursts from the base Runner's plan.
+  *
+  * @param    num_generations   the number of generations to run
+  * @param    burst_length      the number of steps in each mutation burst
+  *
+  * @return the score of the best plan
+  */
+  double Run(uint32_t num_generations, uint32_t burst_length);
+
+  /////////////////////////////////////////////////////////////////////////////
+  // Queries
+  /////////////////////////////////////////////////////////////////////////////
+
+  /*
+  * Gets the number of plans kept.
+  *
+  * @return the population size
+  */
+  uint32_t GetPopulationSize() const { return population_size_; }
+
+  /*
+  * Gets the number of generations run, not counting the first population.
+  *
+  * @return the number of generations
+  */
+  uint32_t GetNumGenerations() const { return generation_; }
+
+  /*
+  * Gets the number of children whose population could not be repaired.
+  * Such children score HUGE_VAL and survive only if nothing else does.
+  *
+  * @return the number of invalid children
+  */
+  uint64_t GetNumInvalid() const { return num_invalid_; }
+
+  /*
+  * Gets the score of a plan of the population.
+  *
+  * @param    rank    the rank of the plan, 0 for the lowest score
+  *
+  * @return the plan's score
+  */
+  double GetScore(uint32_t rank) const { return scores_[rank_[rank]]; }
+
+  /*
+  * Gets a plan of the population, e.g. to load into a Runner with
+  * Runner::SetDistricts.
+  *
+  * @param    rank        the rank of the plan, 0 for the lowest score
+  * @param    districts   filled with the district of every node, indexed
+  *                       by node ID
+  */
+  void GetPlan(uint32_t rank, uint32_t *districts) const;
+
+ private:
+  // The graph copy and Runner a thread breeds children on, and its
+  // scratch space. The single-threaded pool runs Graph::AssignDistricts
+  // inline.
+  struct Worker {
+    Graph *graph;
+    Runner *runner;
+    ThreadPool *pool;
+    vector<uint32_t> labels;
+    vector<uint32_t> piece;
+    vector<uint32_t> queue;
+    vector<uint64_t> piece_pop;
+    vector<uint32_t> piece_order;
+    vector<uint32_t> piece_label;
+    vector<uint8_t> taken;
+  };
+
+  // Gets the district of a node in a stored plan.
+  uint32_t Label(const uint8_t *plan, uint32_t node) const {
+    return width_ == 1 ? plan[node]
+                       : plan[2 * node] | (plan[2 * node + 1] << 8);
+  }
+
+  // Stores the districts of every node into a plan.
+  void Store(const uint32_t *districts, uint8_t *plan) const;
+
+  // Fills the population with bursts from the starting plan.
+  void Populate(uint32_t burst_length);
+
+  // Breeds the children of one generation.
+  void Breed(uint32_t burst_length);
+
+  // Keeps the lowest scoring plans of the parents and children.
+  void Select();
+
+  // Picks a plan of the population by a tournament of two, returning its
+  // slot.
+  uint32_t Tournament();
+
+  // Crosses two stored plans into the worker's labels. Returns false if
+  // the second parent leaves too few pieces to fill every district.
+  bool Cross(Worker *worker, const uint8_t *first, const uint8_t *second);
+
+  // Loads the worker's labels, repairs, mutates and scores them, storing
+  // the result as a child. Returns the child's score.
+  double Finish(Worker *worker, uint32_t burst_length, uint8_t *child);
+
+  uint32_t num_nodes_;
+  uint32_t num_districts_;
+  uint32_t population_size_;
+
+  // The number of bytes per node and per plan.
+  uint32_t width_;
+  uint64_t plan_bytes_;
+
+  // The plans of the population and their scores, by slot, and the slots
+  // in order of score.
+  vector<uint8_t> plans_;
+  vector<double> scores_;
+  vector<uint32_t> rank_;
+
+  // The children of the current generation, their scores, and the slots
+  // of their parents.
+  vector<uint8_t> children_;
+  vector<double> child_scores_;
+  vector<uint32_t> parents_;
+
+  // The base Runner's plan, which the first population grows from.
+  vector<uint8_t> start_;
+
+  uint32_t generation_;
+  uint64_t num_invalid_;
+  uint64_t seed_;
+
+  // Draws the parents of every child.
+  Rng rng_;
+
+  vector<Worker> workers_;
+  ThreadPool pool_;
+};        // class Evolution
+
+}         // namespace rakan
+
+#endif    // SRC_EVOLUTION_H_
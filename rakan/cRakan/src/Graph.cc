@@ -2,18 +2,14 @@
 
 #include <inttypes.h>       // for uint32_t
 #include <stdio.h>          // for FILE *, stderr
-#include <string>           // for std::string
-#include <unordered_set>    // for std::unordered_set
-#include <unordered_map>    // for std::unordered_map
+
+#include <algorithm>        // for std::sort, std::copy
+#include <atomic>           // for std::atomic
 #include <vector>           // for std::vector
 
 #include "./ReturnCodes.h"     // for return status
 #include "./Node.h"           // for Node class
 
-using std::string;
-using std::unordered_set;
-using std::unordered_map;
-
 namespace rakan {
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -27,63 +23,105 @@ Graph::Graph(const uint32_t num_nodes,
       num_districts_(num_districts),
       state_pop_(state_pop) {
   nodes_ = new Node*[num_nodes_];
+  AllocatePlan();
 
-  nodes_in_district_ = new unordered_set<int>*[num_districts_];
-  for (int i = 0; i < num_districts_; i++) {
-    nodes_in_district_[i] = new unordered_set<int>;
-  }
+  adj_offsets_ = nullptr;
+  adj_ = nullptr;
+  pop_of_node_ = nullptr;
+  min_pop_of_node_ = nullptr;
+  owns_topology_ = true;
 
-  nodes_on_perim_ = new unordered_set<int>*[num_districts_];
-  for (int i = 0; i < num_districts_; i++) {
-    nodes_on_perim_[i] = new unordered_set<int>;
-  }
+  ClearDistricts();
+}
 
-  perim_nodes_to_neighbors_ =
-                new unordered_map<int, unordered_set<uint32_t> *>*[num_districts_];
-  for (int i = 0; i < num_districts_; i++) {
-    perim_nodes_to_neighbors_[i] = new unordered_map<int, unordered_set<uint32_t> *>;
-  }
+Graph::Graph(const Graph &other)
+    : num_nodes_(other.num_nodes_),
+      num_districts_(other.num_districts_),
+      state_pop_(other.state_pop_) {
+  nodes_ = other.nodes_;
+  AllocatePlan();
 
-  perim_edges_ = new vector<pair<int, int>>;
+  adj_offsets_ = other.adj_offsets_;
+  adj_ = other.adj_;
+  pop_of_node_ = other.pop_of_node_;
+  min_pop_of_node_ = other.min_pop_of_node_;
+  owns_topology_ = false;
+
+  CopyPlan(other);
+}
+
+void Graph::AllocatePlan() {
+  district_of_node_ = new uint32_t[num_nodes_];
+  next_in_district_ = new uint32_t[num_nodes_];
+  prev_in_district_ = new uint32_t[num_nodes_];
+  next_on_perim_ = new uint32_t[num_nodes_];
+  prev_on_perim_ = new uint32_t[num_nodes_];
+  foreign_neighbors_of_node_ = new uint32_t[num_nodes_];
+
+  first_in_district_ = new uint32_t[num_districts_];
+  first_on_perim_ = new uint32_t[num_districts_];
+  size_of_district_ = new uint32_t[num_districts_];
   pop_of_district_ = new uint32_t[num_districts_];
   min_pop_of_district_ = new uint32_t[num_districts_];
+  cut_edges_of_district_ = new uint32_t[num_districts_];
+}
 
-  for (int i = 0; i < num_districts_; i++) {
-    pop_of_district_[i] = 0;
-    min_pop_of_district_[i] = 0;
-  }
+void Graph::CopyPlan(const Graph &other) {
+  uint32_t n = num_nodes_, k = num_districts_;
+
+  std::copy(other.district_of_node_, other.district_of_node_ + n,
+            district_of_node_);
+  std::copy(other.next_in_district_, other.next_in_district_ + n,
+            next_in_district_);
+  std::copy(other.prev_in_district_, other.prev_in_district_ + n,
+            prev_in_district_);
+  std::copy(other.next_on_perim_, other.next_on_perim_ + n, next_on_perim_);
+  std::copy(other.prev_on_perim_, other.prev_on_perim_ + n, prev_on_perim_);
+  std::copy(other.foreign_neighbors_of_node_,
+            other.foreign_neighbors_of_node_ + n,
+            foreign_neighbors_of_node_);
+
+  std::copy(other.first_in_district_, other.first_in_district_ + k,
+            first_in_district_);
+  std::copy(other.first_on_perim_, other.first_on_perim_ + k,
+            first_on_perim_);
+  std::copy(other.size_of_district_, other.size_of_district_ + k,
+            size_of_district_);
+  std::copy(other.pop_of_district_, other.pop_of_district_ + k,
+            pop_of_district_);
+  std::copy(other.min_pop_of_district_, other.min_pop_of_district_ + k,
+            min_pop_of_district_);
+  std::copy(other.cut_edges_of_district_, other.cut_edges_of_district_ + k,
+            cut_edges_of_district_);
+  num_majority_minority_ = other.num_majority_minority_.load();
 }
 
 Graph::~Graph() {
-  uint32_t i;
-
-  delete perim_edges_;
-
   // Delete non-pointer arrays.
+  delete[] district_of_node_;
+  delete[] next_in_district_;
+  delete[] prev_in_district_;
+  delete[] next_on_perim_;
+  delete[] prev_on_perim_;
+  delete[] foreign_neighbors_of_node_;
+  delete[] first_in_district_;
+  delete[] first_on_perim_;
+  delete[] size_of_district_;
   delete[] pop_of_district_;
   delete[] min_pop_of_district_;
+  delete[] cut_edges_of_district_;
 
-  // Delete all node pointers in nodes_.
-  delete[] nodes_;
-
-  // Delete all set pointers in nodes_in_district_.
-  for (i = 0; i < num_districts_; i++) {
-    delete nodes_in_district_[i];
-  }
-  delete[] nodes_in_district_;
-
-  // Delete all set pointers in nodes_on_perim_.
-  for (i = 0; i < num_districts_; i++) {
-    delete nodes_on_perim_[i];
-  }
-  delete[] nodes_on_perim_;
-
-  // Delete all map pointers in perim_nodes_to_neighbors_.
-  for (i = 0; i < num_districts_; i++) {
-    delete perim_nodes_to_neighbors_[i];
+  // Copies leave the shared arrays to the graph they were copied from.
+  if (!owns_topology_) {
+    return;
   }
+  delete[] adj_offsets_;
+  delete[] adj_;
+  delete[] pop_of_node_;
+  delete[] min_pop_of_node_;
 
-  delete[] perim_nodes_to_neighbors_;
+  // Delete all node pointers in nodes_.
+  delete[] nodes_;
 }
 
 
@@ -116,63 +154,304 @@ void Graph::AddStatePop(uint32_t val) {
   state_pop_ += val;
 }
 
-bool Graph::AddNodeToDistrict(Node *node, int district) {
-  if (nodes_in_district_[district]->find(node->id_) !=
-      nodes_in_district_[district]->end()) {
+bool Graph::AddNodeToDistrict(Node *node, uint32_t district) {
+  uint32_t p, neighbor, id = node->id_, foreign = 0;
+  bool was_majority_minority;
+
+  if (district_of_node_[id] < num_districts_) {
     return false;
   }
-  node->district_ = district;
-  nodes_in_district_[district]->insert(node->id_);
-  pop_of_district_[district] += node->GetTotalPop();
-  min_pop_of_district_[district] += node->GetMinPop();
+
+  StoreDistrict(id, district);
+  LinkToDistrict(id, district);
+  size_of_district_[district]++;
+  was_majority_minority = IsMajorityMinority(district);
+  pop_of_district_[district] += pop_of_node_[id];
+  min_pop_of_district_[district] += min_pop_of_node_[id];
+  UpdateMajorityMinority(district, was_majority_minority);
+
+  for (p = adj_offsets_[id]; p < adj_offsets_[id + 1]; p++) {
+    neighbor = adj_[p];
+    if (LoadDistrict(neighbor) == district) {
+      // The edge to this neighbor is no longer cut.
+      cut_edges_of_district_[district]--;
+      if (--foreign_neighbors_of_node_[neighbor] == 0) {
+        UnlinkFromPerim(neighbor, district);
+      }
+    } else {
+      cut_edges_of_district_[district]++;
+      foreign++;
+    }
+  }
+
+  foreign_neighbors_of_node_[id] = foreign;
+  if (foreign > 0) {
+    LinkToPerim(id, district);
+  }
+
   return true;
 }
 
-bool Graph::RemoveNodeFromDistrict(Node *node, int district) {
-  if (nodes_in_district_[district]->find(node->id_) ==
-      nodes_in_district_[district]->end()) {
+bool Graph::RemoveNodeFromDistrict(Node *node, uint32_t district) {
+  uint32_t p, neighbor, id = node->id_;
+  bool was_majority_minority;
+
+  if (district_of_node_[id] != district) {
     return false;
   }
-  nodes_in_district_[district]->erase(node->id_);
-  pop_of_district_[district] -= node->GetTotalPop();
-  min_pop_of_district_[district] -= node->GetMinPop();
-  node->district_ = num_districts_ + 1;
+
+  if (foreign_neighbors_of_node_[id] > 0) {
+    UnlinkFromPerim(id, district);
+  }
+  UnlinkFromDistrict(id, district);
+  size_of_district_[district]--;
+  was_majority_minority = IsMajorityMinority(district);
+  pop_of_district_[district] -= pop_of_node_[id];
+  min_pop_of_district_[district] -= min_pop_of_node_[id];
+  UpdateMajorityMinority(district, was_majority_minority);
+  StoreDistrict(id, num_districts_);
+
+  for (p = adj_offsets_[id]; p < adj_offsets_[id + 1]; p++) {
+    neighbor = adj_[p];
+    if (LoadDistrict(neighbor) == district) {
+      // The edge to this neighbor is now cut.
+      cut_edges_of_district_[district]++;
+      if (foreign_neighbors_of_node_[neighbor]++ == 0) {
+        LinkToPerim(neighbor, district);
+      }
+    } else {
+      cut_edges_of_district_[district]--;
+    }
+  }
+
   return true;
 }
 
-bool Graph::AddNodeToDistrictPerim(Node *node, int district) {
-  if (nodes_on_perim_[node->district_]->find(node->id_) !=
-      nodes_on_perim_[node->district_]->end()) {
-    return false;
+void Graph::ClearDistricts() {
+  uint32_t i;
+
+  for (i = 0; i < num_nodes_; i++) {
+    district_of_node_[i] = num_districts_;
+    next_in_district_[i] = num_nodes_;
+    prev_in_district_[i] = num_nodes_;
+    next_on_perim_[i] = num_nodes_;
+    prev_on_perim_[i] = num_nodes_;
+    foreign_neighbors_of_node_[i] = 0;
   }
-  nodes_on_perim_[node->district_]->insert(node->id_);
 
-  unordered_map<int, unordered_set<uint32_t> *> *map;
-  map = perim_nodes_to_neighbors_[district];
-  if (map->find(node->id_) != map->end()) {
-    return false;
+  for (i = 0; i < num_districts_; i++) {
+    first_in_district_[i] = num_nodes_;
+    first_on_perim_[i] = num_nodes_;
+    size_of_district_[i] = 0;
+    pop_of_district_[i] = 0;
+    min_pop_of_district_[i] = 0;
+    cut_edges_of_district_[i] = 0;
   }
-  map->insert({node->id_, node->neighbors_});
-  return true;
+
+  num_majority_minority_ = 0;
 }
 
-bool Graph::RemoveNodeFromDistrictPerim(Node *node, int district) {
-  if (nodes_on_perim_[district]->find(node->id_) ==
-      nodes_on_perim_[district]->end()) {
+bool Graph::AssignDistricts(const uint32_t *districts, ThreadPool *pool) {
+  uint32_t n = num_nodes_, k = num_districts_;
+  uint32_t num_blocks = pool->GetNumThreads(), block, d;
+  uint64_t slot;
+  std::atomic<bool> valid(true);
+
+  // The ends of each block's chain of nodes per district, and its partial
+  // totals per district, at block * k + district.
+  vector<uint32_t> first(num_blocks * k, n), last(num_blocks * k, n);
+  vector<uint32_t> first_perim(num_blocks * k, n);
+  vector<uint32_t> last_perim(num_blocks * k, n);
+  vector<uint32_t> sizes(num_blocks * k, 0), pops(num_blocks * k, 0);
+  vector<uint32_t> min_pops(num_blocks * k, 0), cuts(num_blocks * k, 0);
+
+  auto label = [&](uint32_t block) {
+    uint32_t v, end = (uint64_t) (block + 1) * n / num_blocks;
+    for (v = (uint64_t) block * n / num_blocks; v < end; v++) {
+      if (districts[v] >= k) {
+        valid = false;
+      }
+      district_of_node_[v] = districts[v];
+    }
+  };
+  pool->ParallelFor(num_blocks, label);
+  if (!valid) {
+    ClearDistricts();
     return false;
   }
-  nodes_on_perim_[district]->erase(node->id_);
 
-  unordered_map<int, unordered_set<uint32_t> *> *map;
-  map = perim_nodes_to_neighbors_[district];
-  if (map->find(node->id_) == map->end()) {
-    return false;
+  auto link = [&](uint32_t block) {
+    uint32_t v, p, foreign, district;
+    uint64_t at;
+    uint32_t begin = (uint64_t) block * n / num_blocks;
+    uint32_t end = (uint64_t) (block + 1) * n / num_blocks;
+
+    for (v = end; v-- > begin; ) {
+      district = district_of_node_[v];
+      at = (uint64_t) block * k + district;
+      foreign = 0;
+      for (p = adj_offsets_[v]; p < adj_offsets_[v + 1]; p++) {
+        foreign += district_of_node_[adj_[p]] != district;
+      }
+      foreign_neighbors_of_node_[v] = foreign;
+
+      next_in_district_[v] = n;
+      prev_in_district_[v] = last[at];
+      if (last[at] == n) {
+        first[at] = v;
+      } else {
+        next_in_district_[last[at]] = v;
+      }
+      last[at] = v;
+
+      next_on_perim_[v] = n;
+      prev_on_perim_[v] = n;
+      if (foreign > 0) {
+        prev_on_perim_[v] = last_perim[at];
+        if (last_perim[at] == n) {
+          first_perim[at] = v;
+        } else {
+          next_on_perim_[last_perim[at]] = v;
+        }
+        last_perim[at] = v;
+      }
+
+      sizes[at]++;
+      pops[at] += pop_of_node_[v];
+      min_pops[at] += min_pop_of_node_[v];
+      cuts[at] += foreign;
+    }
+  };
+  pool->ParallelFor(num_blocks, link);
+
+  // Stitch the chains from the highest block down, and sum the totals.
+  num_majority_minority_ = 0;
+  for (d = 0; d < k; d++) {
+    uint32_t tail = n, tail_perim = n;
+    first_in_district_[d] = n;
+    first_on_perim_[d] = n;
+    size_of_district_[d] = 0;
+    pop_of_district_[d] = 0;
+    min_pop_of_district_[d] = 0;
+    cut_edges_of_district_[d] = 0;
+
+    for (block = num_blocks; block-- > 0; ) {
+      slot = (uint64_t) block * k + d;
+      if (first[slot] != n) {
+        if (tail == n) {
+          first_in_district_[d] = first[slot];
+        } else {
+          next_in_district_[tail] = first[slot];
+          prev_in_district_[first[slot]] = tail;
+        }
+        tail = last[slot];
+      }
+      if (first_perim[slot] != n) {
+        if (tail_perim == n) {
+          first_on_perim_[d] = first_perim[slot];
+        } else {
+          next_on_perim_[tail_perim] = first_perim[slot];
+          prev_on_perim_[first_perim[slot]] = tail_perim;
+        }
+        tail_perim = last_perim[slot];
+      }
+      size_of_district_[d] += sizes[slot];
+      pop_of_district_[d] += pops[slot];
+      min_pop_of_district_[d] += min_pops[slot];
+      cut_edges_of_district_[d] += cuts[slot];
+    }
+    num_majority_minority_ += IsMajorityMinority(d);
   }
-  map->erase(node->id_);
-  
+
   return true;
 }
 
+void Graph::BuildAdjacency() {
+  uint32_t i, pos = 0;
+
+  // A copy stops sharing once it builds an adjacency of its own.
+  if (!owns_topology_) {
+    Node **nodes = new Node*[num_nodes_];
+    std::copy(nodes_, nodes_ + num_nodes_, nodes);
+    nodes_ = nodes;
+    adj_offsets_ = nullptr;
+    adj_ = nullptr;
+    pop_of_node_ = nullptr;
+    min_pop_of_node_ = nullptr;
+    owns_topology_ = true;
+  }
+
+  delete[] adj_offsets_;
+  delete[] adj_;
+
+  adj_offsets_ = new uint32_t[num_nodes_ + 1];
+  adj_offsets_[0] = 0;
+  for (i = 0; i < num_nodes_; i++) {
+    adj_offsets_[i + 1] = adj_offsets_[i] + nodes_[i]->neighbors_->size();
+  }
+
+  adj_ = new uint32_t[adj_offsets_[num_nodes_]];
+  for (i = 0; i < num_nodes_; i++) {
+    for (auto &neighbor_id : *nodes_[i]->neighbors_) {
+      adj_[pos++] = neighbor_id;
+    }
+    std::sort(adj_ + adj_offsets_[i], adj_ + adj_offsets_[i + 1]);
+  }
+
+  delete[] pop_of_node_;
+  delete[] min_pop_of_node_;
+  pop_of_node_ = new uint32_t[num_nodes_];
+  min_pop_of_node_ = new uint32_t[num_nodes_];
+  for (i = 0; i < num_nodes_; i++) {
+    pop_of_node_[i] = nodes_[i]->GetTotalPop();
+    min_pop_of_node_[i] = nodes_[i]->GetMinPop();
+  }
+}
+
+void Graph::LinkToDistrict(uint32_t node, uint32_t district) {
+  next_in_district_[node] = first_in_district_[district];
+  prev_in_district_[node] = num_nodes_;
+  if (first_in_district_[district] != num_nodes_) {
+    prev_in_district_[first_in_district_[district]] = node;
+  }
+  first_in_district_[district] = node;
+}
+
+void Graph::UnlinkFromDistrict(uint32_t node, uint32_t district) {
+  if (prev_in_district_[node] != num_nodes_) {
+    next_in_district_[prev_in_district_[node]] = next_in_district_[node];
+  } else {
+    first_in_district_[district] = next_in_district_[node];
+  }
+  if (next_in_district_[node] != num_nodes_) {
+    prev_in_district_[next_in_district_[node]] = prev_in_district_[node];
+  }
+  next_in_district_[node] = num_nodes_;
+  prev_in_district_[node] = num_nodes_;
+}
+
+void Graph::LinkToPerim(uint32_t node, uint32_t district) {
+  next_on_perim_[node] = first_on_perim_[district];
+  prev_on_perim_[node] = num_nodes_;
+  if (first_on_perim_[district] != num_nodes_) {
+    prev_on_perim_[first_on_perim_[district]] = node;
+  }
+  first_on_perim_[district] = node;
+}
+
+void Graph::UnlinkFromPerim(uint32_t node, uint32_t district) {
+  if (prev_on_perim_[node] != num_nodes_) {
+    next_on_perim_[prev_on_perim_[node]] = next_on_perim_[node];
+  } else {
+    first_on_perim_[district] = next_on_perim_[node];
+  }
+  if (next_on_perim_[node] != num_nodes_) {
+    prev_on_perim_[next_on_perim_[node]] = prev_on_perim_[node];
+  }
+  next_on_perim_[node] = num_nodes_;
+  prev_on_perim_[node] = num_nodes_;
+}
+
 
 ///////////////////////////////////////////////////////////////////////////////
 // Queries
@@ -189,8 +468,7 @@ bool Graph::ContainsEdge(const Node& node1, const Node& node2) const {
 
 bool Graph::NodeExistsInDistrict(const Node& node,
                                  const uint32_t district) const {
-  return (nodes_in_district_[district]->find(node.id_)
-          != nodes_in_district_[district]->end());
+  return district_of_node_[node.id_] == district;
 }
 
 
@@ -221,28 +499,57 @@ uint32_t Graph::GetStatePop() const {
   return state_pop_;
 }
 
-unordered_set<int>* Graph::GetNodesInDistrict(const uint32_t district) const {
-  if (district > num_districts_ || district < 0) {
-    return nullptr;
+uint32_t Graph::GetDistrictOf(const uint32_t node) const {
+  if (node >= num_nodes_) {
+    return num_districts_;
   }
-  return nodes_in_district_[district];
+  return district_of_node_[node];
 }
 
-unordered_set<int>* Graph::GetPerimNodes(uint32_t district) const {
-  if (district > num_districts_ || district < 0) {
-    return nullptr;
+bool Graph::GetNodesInDistrict(const uint32_t district,
+                               vector<uint32_t> *nodes) const {
+  uint32_t node;
+
+  if (district >= num_districts_) {
+    return false;
+  }
+
+  nodes->clear();
+  for (node = first_in_district_[district]; node != num_nodes_;
+       node = next_in_district_[node]) {
+    nodes->push_back(node);
   }
-  return nodes_on_perim_[district];
+  return true;
 }
 
-unordered_set<uint32_t>*
-    Graph::GetPerimNodeNeighbors(const uint32_t district,
-                                 const uint32_t node) const {
-  if (district > num_districts_ || district < 0 ||
-      node > num_nodes_ || node < 0) {
-    return nullptr;
+bool Graph::GetPerimNodes(const uint32_t district,
+                          vector<uint32_t> *nodes) const {
+  uint32_t node;
+
+  if (district >= num_districts_) {
+    return false;
+  }
+
+  nodes->clear();
+  for (node = first_on_perim_[district]; node != num_nodes_;
+       node = next_on_perim_[node]) {
+    nodes->push_back(node);
+  }
+  return true;
+}
+
+uint32_t Graph::GetDistrictSize(const uint32_t district) const {
+  if (district >= num_districts_) {
+    return 0;
+  }
+  return size_of_district_[district];
+}
+
+uint32_t Graph::GetCutEdges(const uint32_t district) const {
+  if (district >= num_districts_) {
+    return 0;
   }
-  return (*perim_nodes_to_neighbors_[district]->find(node)).second;
+  return cut_edges_of_district_[district];
 }
 
 int32_t Graph::GetDistrictPop(const uint32_t district) const {
@@ -4,16 +4,12 @@
 #include <inttypes.h>       // for uint32_t
 #include <stdio.h>          // for FILE *
 
-#include <unordered_set>    // for std::unordered_set
-#include <unordered_map>    // for std::unordered_map
-#include <utility>          // for std::pair
+#include <atomic>           // for std::atomic
 #include <vector>           // for std::vector
 
 #include "./Node.h"         // for Node class
+#include "./ThreadPool.h"   // for ThreadPool class
 
-using std::pair;
-using std::unordered_set;
-using std::unordered_map;
 using std::vector;
 
 namespace rakan {
@@ -42,11 +38,25 @@ class Graph {
        const uint32_t num_districts,
        const uint32_t state_pop);
 
+  /*
+  * Copy constructor. The copy shares the other graph's nodes, flattened
+  * adjacency and node populations, which are read-only once built, and
+  * has its own copy of the current plan, so the two graphs can be
+  * redistricted independently. The other graph must outlive the copy and
+  * must not rebuild its adjacency while the copy is in use.
+  *
+  * @param    other   the graph to copy
+  */
+  Graph(const Graph &other);
+
   /*
   * Default destructor. Also destructs nodes on this graph.
   */
   ~Graph();
 
+  // Graphs are copied only through the copy constructor.
+  Graph &operator=(const Graph &other) = delete;
+
   /////////////////////////////////////////////////////////////////////////////
   // Graph mutators
   /////////////////////////////////////////////////////////////////////////////
@@ -79,22 +89,24 @@ class Graph {
   void AddStatePop(uint32_t val);
 
   /*
-  * Adds the given node to the district. Does NOT remove node from its old
-  * district. Updates the population and demographics of the district
-  * accordingly.
+  * Adds the given node to the district. Node must not belong to any
+  * district. Updates the population, demographics, cut edges and perimeter
+  * of the district and its neighbors accordingly. Requires the flattened
+  * adjacency to be built.
   * 
   * @param      node        the node to add
   * @param      district    the district to add the node to
   * 
-  * @return true iff node does not already belong in district and addition
+  * @return true iff node does not already belong to a district and addition
   *         successful, false otherwise
   */
-  bool AddNodeToDistrict(Node *node, int district);
+  bool AddNodeToDistrict(Node *node, uint32_t district);
 
   /*
   * Removes the given node from the given district. Node must exist in district
-  * before removal. Updates the population and demographics of the district
-  * accordingly. Node will belong to a non-existent district afterwards.
+  * before removal. Updates the population, demographics, cut edges and
+  * perimeter of the district and its neighbors accordingly. Node will belong
+  * to a non-existent district afterwards.
   * 
   * @param      node        the node to remove
   * @param      district    the district to remove node from
@@ -102,31 +114,49 @@ class Graph {
   * @return true iff node exists in district and removal successful, false
   *         otherwise
   */
-  bool RemoveNodeFromDistrict(Node *node, int district);
+  bool RemoveNodeFromDistrict(Node *node, uint32_t district);
 
   /*
-  * Adds the given node to the given district's set of perim nodes. Node must
-  * exist in the district before addition.
-  * 
-  * @param      node        the perimeter node to add
-  * @param      district    the district to add the perimeter node to
-  * 
-  * @return true iff node exists in district and addition to perim nodes list
-  *         successful, false otherwise
+  * Removes every node from its district and resets all district totals.
+  * The district each Node object stores is left untouched.
   */
-  bool AddNodeToDistrictPerim(Node *node, int district);
+  void ClearDistricts();
 
   /*
-  * Removes the given node from the given district's set of perim nodes. Node
-  * must be on the perimeter of the district before removal.
-  * 
-  * @param      node        the perimeter node to remove
-  * @param      district    the district to remove the perimeter node from
-  * 
-  * @return true iff node is a perimeter node in given district and removal
-  *         successful, false otherwise
+  * Replaces the plan with the given districts in a single pass over the
+  * flattened adjacency, which must be built. The nodes are split into
+  * one contiguous ID range per thread of the pool; each range counts its
+  * nodes' foreign neighbors and builds its own district and perimeter
+  * chains and partial district totals, which are then stitched and summed
+  * in O(threads * districts). Each cut edge is seen from both endpoints,
+  * once for each of its districts, so no edge needs an owner and no range
+  * writes outside its own nodes. The lists come out as AddNodeToDistrict
+  * would leave the district lists, in descending ID order.
+  *
+  * @param    districts   the district of every node, indexed by node ID
+  * @param    pool        the pool to run on
+  *
+  * @return true iff every district is in range; the plan is cleared
+  *         otherwise
   */
-  bool RemoveNodeFromDistrictPerim(Node *node, int district);
+  bool AssignDistricts(const uint32_t *districts, ThreadPool *pool);
+
+  /*
+  * Copies the plan of another graph over the same nodes, i.e. one created
+  * as a copy of this graph or of the same original. Runs in O(V + D)
+  * without allocating.
+  *
+  * @param    other   the graph to copy the plan of
+  */
+  void CopyPlan(const Graph &other);
+
+  /*
+  * Builds the flattened adjacency arrays from the neighbor sets of the
+  * nodes on this graph, and caches each node's population. Neighbors of
+  * each node are stored in ascending ID order. Must be called again if
+  * edges or populations change afterwards.
+  */
+  void BuildAdjacency();
 
 
   /////////////////////////////////////////////////////////////////////////////
@@ -208,37 +238,60 @@ class Graph {
   uint32_t GetStatePop() const;
 
   /*
-  * Gets the set of nodes in the given district.
+  * Gets the district the given node currently belongs to. This is the live
+  * plan; the district stored on the Node is only read when the graph's
+  * districts are populated.
+  * 
+  * @param    node    the ID of the node
+  * 
+  * @return the district of the node; GetNumDistricts() if the node is
+  *         unassigned or does not exist
+  */
+  uint32_t GetDistrictOf(const uint32_t node) const;
+
+  /*
+  * Gets the nodes in the given district.
   * 
   * @param    district      the district to get the nodes from
+  * @param    nodes         the return parameter to be filled with the IDs of
+  *                         the nodes in the district
   * 
-  * @return a pointer to the set of nodes in the district; nullptr if the
-  *         district does not exist
+  * @return true iff the district exists, false otherwise
   */
-  unordered_set<int>* GetNodesInDistrict(const uint32_t district) const;
+  bool GetNodesInDistrict(const uint32_t district,
+                          vector<uint32_t> *nodes) const;
 
   /*
-  * Gets the set of nodes on the given district's perimeter.
+  * Gets the nodes on the given district's perimeter, i.e. the nodes in the
+  * district with at least one neighbor outside of it.
   * 
   * @param   district    the district to get the nodes on the perimeter from
+  * @param   nodes       the return parameter to be filled with the IDs of
+  *                      the nodes on the district perimeter
   * 
-  * @return a pointer to the set of nodes on the district perimeter; nullptr
-  *         if the district does not exist
+  * @return true iff the district exists, false otherwise
   */
-  unordered_set<int>* GetPerimNodes(const uint32_t district) const;
+  bool GetPerimNodes(const uint32_t district, vector<uint32_t> *nodes) const;
 
   /*
-  * Gets the set of neighbors of the node. Assumes the node is on the
-  * perimeter of the given district.
+  * Gets the number of nodes in the given district.
   * 
-  * @param    district    the district that the perim_node resides in
-  * @param    node        the node to get the neighbors of
+  * @param    district    the district to get the size of
   * 
-  * @return a pointer to the set of neighbor nodes of perim_node; nullptr
-  *         if either the district or node does not exist
+  * @return the number of nodes in the district; 0 if the district does not
+  *         exist
   */
-  unordered_set<uint32_t>* GetPerimNodeNeighbors(const uint32_t district,
-                                                 const uint32_t node) const;
+  uint32_t GetDistrictSize(const uint32_t district) const;
+
+  /*
+  * Gets the number of edges with exactly one endpoint in the given district.
+  * 
+  * @param    district    the district to get the cut edges of
+  * 
+  * @return the number of cut edges of the district; 0 if the district does
+  *         not exist
+  */
+  uint32_t GetCutEdges(const uint32_t district) const;
 
   /*
   * Gets the total population of the given district.
@@ -260,6 +313,15 @@ class Graph {
   */
   int32_t GetMinorityPop(const uint32_t district) const;
 
+  /*
+  * Gets the number of majority-minority districts, i.e. districts in
+  * which the minority population is more than half the total. Maintained
+  * as nodes move, so runs in O(1).
+  *
+  * @return the number of majority-minority districts
+  */
+  uint32_t GetNumMajorityMinority() const { return num_majority_minority_; }
+
  private:
   // The number of nodes on this graph.
   uint32_t num_nodes_;
@@ -274,24 +336,32 @@ class Graph {
   // the node ID.
   Node **nodes_;
 
-  // An array of pointers to sets. The index of the array
-  // is the district ID, and the pointer at the index points
-  // to a set of nodes in that district.
-  unordered_set<int> **nodes_in_district_;
-
-  // An array of pointers to sets. The index of the array
-  // is the district ID, and the pointer at the index points
-  // to a set of nodes on the perimeter of that district.
-  unordered_set<int> **nodes_on_perim_;
-
-  vector<pair<int, int>> *perim_edges_;
-
-  // An array of maps. The index of the map is the district
-  // ID. Each district map stores node IDs as keys, and each
-  // node must be on the perimeter of the district. Corresponding
-  // to each key contains a set of node IDs that are neighbors
-  // to the perimeter node.
-  unordered_map<int, unordered_set<uint32_t> *> **perim_nodes_to_neighbors_;
+  // An array of districts. The index of the array is the node ID. The
+  // value at that index is the district the node currently belongs to, or
+  // num_districts_ if it is unassigned.
+  uint32_t *district_of_node_;
+
+  // Intrusive doubly-linked lists of the nodes in each district.
+  // first_in_district_ is indexed by district ID; next_in_district_ and
+  // prev_in_district_ are indexed by node ID. num_nodes_ ends a list.
+  uint32_t *first_in_district_;
+  uint32_t *next_in_district_;
+  uint32_t *prev_in_district_;
+
+  // An array of district sizes. The index of the array is the district ID.
+  uint32_t *size_of_district_;
+
+  // Intrusive doubly-linked lists of the nodes on each district's
+  // perimeter, laid out like the district lists above.
+  uint32_t *first_on_perim_;
+  uint32_t *next_on_perim_;
+  uint32_t *prev_on_perim_;
+
+  // An array of neighbor counts. The index of the array is the node ID.
+  // The value at that index is the number of neighbors of the node that
+  // are not in its district. A node is on its district's perimeter iff
+  // this is positive.
+  uint32_t *foreign_neighbors_of_node_;
 
   // An array of populations. The index of the array is the district
   // ID. The value at that index corresponds to the population in
@@ -303,8 +373,81 @@ class Graph {
   // minority population in that district.
   uint32_t *min_pop_of_district_;
 
+  // An array of cut edge counts. The index of the array is the district
+  // ID. The value at that index corresponds to the number of edges with
+  // exactly one endpoint in that district.
+  uint32_t *cut_edges_of_district_;
+
+  // The number of districts whose minority population is more than half
+  // of their total population. Atomic so that moves in disjoint districts
+  // can be made concurrently; it only changes when a district's status
+  // does.
+  std::atomic<uint32_t> num_majority_minority_;
+
+  // The flattened adjacency of this graph. The neighbors of node i are
+  // adj_[adj_offsets_[i]] through adj_[adj_offsets_[i + 1] - 1]. Built by
+  // BuildAdjacency; nullptr until then.
+  uint32_t *adj_offsets_;
+  uint32_t *adj_;
+
+  // Arrays of the total and minority population of each node, indexed by
+  // node ID. Cached by BuildAdjacency.
+  uint32_t *pop_of_node_;
+  uint32_t *min_pop_of_node_;
+
+  // Whether this graph owns nodes_, the flattened adjacency and the node
+  // populations. False for copies, which share them with the original.
+  bool owns_topology_;
+
+  // Allocates the arrays that hold the plan, sized for this graph.
+  void AllocatePlan();
+
+  // Returns 1 if the district is majority-minority and 0 otherwise.
+  uint32_t IsMajorityMinority(uint32_t district) const {
+    return 2 * (uint64_t) min_pop_of_district_[district] >
+           pop_of_district_[district];
+  }
+
+  // Updates the majority-minority count after a district's population has
+  // changed, given whether it was majority-minority before.
+  void UpdateMajorityMinority(uint32_t district, bool was_majority_minority) {
+    if (IsMajorityMinority(district) != was_majority_minority) {
+      if (was_majority_minority) {
+        num_majority_minority_--;
+      } else {
+        num_majority_minority_++;
+      }
+    }
+  }
+
+  // Gets and sets the district of a node with relaxed atomic accesses.
+  // ParallelFlip moves nodes of disjoint districts on several threads at
+  // once, and each thread reads the districts of nodes across its border
+  // while their own threads may be moving them.
+  uint32_t LoadDistrict(uint32_t node) const {
+    return __atomic_load_n(&district_of_node_[node], __ATOMIC_RELAXED);
+  }
+  void StoreDistrict(uint32_t node, uint32_t district) {
+    __atomic_store_n(&district_of_node_[node], district, __ATOMIC_RELAXED);
+  }
+
+  // Helpers that link and unlink a node from the intrusive lists.
+  void LinkToDistrict(uint32_t node, uint32_t district);
+  void UnlinkFromDistrict(uint32_t node, uint32_t district);
+  void LinkToPerim(uint32_t node, uint32_t district);
+  void UnlinkFromPerim(uint32_t node, uint32_t district);
+
   // Needed for populating data structures in graph from file.
   friend class Runner;
+  friend class BoundarySampler;
+  friend class SpanningTree;
+  friend class SMC;
+  friend class MultipleTry;
+  friend class ContiguityChecker;
+  friend class ParallelFlip;
+  friend class Multilevel;
+  friend class Enumerator;
+  friend class Evolution;
 };        // class Graph
 
 }         // namespace rakan
@@ -0,0 +1,457 @@
+#include "./Multilevel.h"
+
+#include <inttypes.h>         // for uint16_t, uint32_t, uint64_t
+
+#include <algorithm>          // for std::swap
+#include <vector>             // for std::vector
+
+#include "./Graph.h"          // for Graph class
+#include "./ReturnCodes.h"    // for SUCCESS, SEED_FAILED
+
+namespace rakan {
+
+// Coarsening stops once a level has at most this many nodes per district,
+// and coarse nodes are kept below 1 / kCoarseNodesPerDistrict of the ideal
+// district population so the coarsest split is fine enough to balance.
+static const uint32_t kCoarseNodesPerDistrict = 20;
+
+// Coarsening stops once a level is no smaller than this fraction of the
+// level below it.
+static const double kMinShrink = 0.9;
+
+// The most refinement passes made on one level.
+static const uint32_t kMaxPasses = 16;
+
+// The tolerance refinement works towards when the caller's is disabled.
+static const double kDefaultTolerance = 0.01;
+
+///////////////////////////////////////////////////////////////////////////////
+// Constructors and destructors
+///////////////////////////////////////////////////////////////////////////////
+
+Multilevel::Multilevel(Graph *graph)
+    : graph_(graph), num_districts_(0), lower_(0), upper_(0), stamp_(0) {}
+
+Multilevel::~Multilevel() {}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Algorithms
+///////////////////////////////////////////////////////////////////////////////
+
+uint16_t Multilevel::Partition(uint32_t num_districts, double tolerance) {
+  uint32_t num_nodes = graph_->num_nodes_, v, p, head = 0;
+  uint64_t total_pop = 0;
+  double ideal;
+  int32_t level;
+
+  num_districts_ = num_districts;
+  levels_.clear();
+  labels_.clear();
+  if (num_districts == 0 || num_districts > num_nodes ||
+      graph_->adj_offsets_ == nullptr) {
+    return SEED_FAILED;
+  }
+
+  // The finest level is the graph itself, with unit edge weights.
+  levels_.resize(1);
+  levels_[0].num_nodes = num_nodes;
+  levels_[0].offsets.assign(graph_->adj_offsets_,
+                            graph_->adj_offsets_ + num_nodes + 1);
+  levels_[0].adj.assign(graph_->adj_,
+                        graph_->adj_ + graph_->adj_offsets_[num_nodes]);
+  levels_[0].edge_weights.assign(levels_[0].adj.size(), 1);
+  levels_[0].pops.resize(num_nodes);
+  for (v = 0; v < num_nodes; v++) {
+    levels_[0].pops[v] = graph_->pop_of_node_[v];
+    total_pop += graph_->pop_of_node_[v];
+  }
+
+  queue_.resize(num_nodes);
+  visited_.assign(num_nodes, 0);
+  targets_.assign(num_nodes, 0);
+  stamp_ = 0;
+
+  // Every level is contiguous only if the graph is.
+  stamp_++;
+  queue_[0] = 0;
+  visited_[0] = stamp_;
+  for (v = 1; head < v; ) {
+    uint32_t node = queue_[head++];
+    for (p = levels_[0].offsets[node]; p < levels_[0].offsets[node + 1];
+         p++) {
+      if (visited_[levels_[0].adj[p]] != stamp_) {
+        visited_[levels_[0].adj[p]] = stamp_;
+        queue_[v++] = levels_[0].adj[p];
+      }
+    }
+  }
+  if (v < num_nodes) {
+    levels_.clear();
+    return SEED_FAILED;
+  }
+
+  ideal = ((double) total_pop) / num_districts;
+  if (tolerance <= 0) {
+    tolerance = kDefaultTolerance;
+  }
+  lower_ = ideal * (1 - tolerance);
+  upper_ = ideal * (1 + tolerance);
+
+  while (levels_.back().num_nodes > kCoarseNodesPerDistrict * num_districts &&
+         Coarsen((uint64_t) (ideal / kCoarseNodesPerDistrict) + 1)) {}
+
+  if (!Grow(levels_.back())) {
+    levels_.clear();
+    labels_.clear();
+    return SEED_FAILED;
+  }
+  Refine(levels_.back());
+
+  // Project the plan down one level at a time, refining as it goes.
+  for (level = levels_.size() - 2; level >= 0; level--) {
+    const Level &fine = levels_[level];
+    vector<uint32_t> projected(fine.num_nodes);
+    for (v = 0; v < fine.num_nodes; v++) {
+      projected[v] = labels_[fine.coarse_of[v]];
+    }
+    labels_.swap(projected);
+    Refine(fine);
+  }
+
+  CountDistricts(levels_[0]);
+  for (v = 0; v < num_districts; v++) {
+    if (district_sizes_[v] == 0 || district_pops_[v] < lower_ ||
+        district_pops_[v] > upper_) {
+      return SEED_FAILED;
+    }
+  }
+
+  return SUCCESS;
+}
+
+bool Multilevel::Coarsen(uint64_t max_pop) {
+  const Level &fine = levels_.back();
+  uint32_t n = fine.num_nodes, num_coarse = 0, i, u, v, best, p, c, m;
+  uint32_t best_weight;
+  vector<uint32_t> order(n), match(n, n), coarse_of(n, n);
+  vector<uint32_t> position(n, 0), last(n, n);
+  Level coarse;
+
+  // Heavy-edge matching, visiting the nodes in random order.
+  for (i = 0; i < n; i++) {
+    order[i] = i;
+  }
+  for (i = n; i > 1; i--) {
+    std::swap(order[i - 1], order[rng_.UniformInt(i)]);
+  }
+  for (i = 0; i < n; i++) {
+    u = order[i];
+    if (match[u] != n) {
+      continue;
+    }
+    best = u;
+    best_weight = 0;
+    for (p = fine.offsets[u]; p < fine.offsets[u + 1]; p++) {
+      v = fine.adj[p];
+      if (v == u || match[v] != n || fine.pops[u] + fine.pops[v] > max_pop) {
+        continue;
+      }
+      if (fine.edge_weights[p] > best_weight ||
+          (fine.edge_weights[p] == best_weight &&
+           fine.pops[v] < fine.pops[best])) {
+        best = v;
+        best_weight = fine.edge_weights[p];
+      }
+    }
+    match[u] = best;
+    match[best] = u;
+  }
+
+  for (u = 0; u < n; u++) {
+    if (coarse_of[u] == n) {
+      coarse_of[u] = num_coarse;
+      coarse_of[match[u]] = num_coarse;
+      num_coarse++;
+    }
+  }
+  if (num_coarse > kMinShrink * n) {
+    return false;
+  }
+
+  // Merge the adjacency of each pair, summing the weights of parallel
+  // edges. last[d] is the coarse node whose list last took in d, at
+  // position[d].
+  coarse.num_nodes = num_coarse;
+  coarse.offsets.reserve(num_coarse + 1);
+  coarse.offsets.push_back(0);
+  coarse.pops.assign(num_coarse, 0);
+  for (u = 0; u < n; u++) {
+    c = coarse_of[u];
+    if (c + 1 != coarse.offsets.size()) {
+      continue;
+    }
+    for (m = 0; m < 2; m++) {
+      v = m == 0 ? u : match[u];
+      if (m == 1 && v == u) {
+        break;
+      }
+      coarse.pops[c] += fine.pops[v];
+      for (p = fine.offsets[v]; p < fine.offsets[v + 1]; p++) {
+        uint32_t d = coarse_of[fine.adj[p]];
+        if (d == c) {
+          continue;
+        }
+        if (last[d] == c) {
+          coarse.edge_weights[position[d]] += fine.edge_weights[p];
+        } else {
+          last[d] = c;
+          position[d] = coarse.adj.size();
+          coarse.adj.push_back(d);
+          coarse.edge_weights.push_back(fine.edge_weights[p]);
+        }
+      }
+    }
+    coarse.offsets.push_back(coarse.adj.size());
+  }
+
+  levels_.back().coarse_of.swap(coarse_of);
+  levels_.push_back(coarse);
+  return true;
+}
+
+bool Multilevel::Grow(const Level &level) {
+  uint32_t n = level.num_nodes, d, v, w, p, head, tail, seed, best;
+  uint32_t unassigned = num_districts_;
+  uint64_t remaining = 0, pop, best_pop;
+  double target;
+  vector<uint32_t> component(n);
+  vector<uint64_t> component_pops;
+
+  labels_.assign(n, unassigned);
+  for (v = 0; v < n; v++) {
+    remaining += level.pops[v];
+  }
+
+  for (d = 0; d + 1 < num_districts_; d++) {
+    target = ((double) remaining) / (num_districts_ - d);
+
+    // Start from the unassigned node farthest from the lowest unassigned
+    // node, so the rest of the region is left in one piece.
+    for (seed = 0; seed < n && labels_[seed] != unassigned; seed++) {}
+    if (seed == n) {
+      return false;
+    }
+    stamp_++;
+    queue_[0] = seed;
+    visited_[seed] = stamp_;
+    for (head = 0, tail = 1; head < tail; head++) {
+      v = queue_[head];
+      for (p = level.offsets[v]; p < level.offsets[v + 1]; p++) {
+        w = level.adj[p];
+        if (labels_[w] == unassigned && visited_[w] != stamp_) {
+          visited_[w] = stamp_;
+          queue_[tail++] = w;
+        }
+      }
+    }
+    seed = queue_[tail - 1];
+
+    // Grow breadth-first, skipping nodes that would overshoot the target
+    // by more than they fall short.
+    stamp_++;
+    queue_[0] = seed;
+    visited_[seed] = stamp_;
+    pop = 0;
+    for (head = 0, tail = 1; head < tail && pop < target; head++) {
+      v = queue_[head];
+      if (pop > 0 && pop + level.pops[v] - target > target - pop) {
+        continue;
+      }
+      labels_[v] = d;
+      pop += level.pops[v];
+      for (p = level.offsets[v]; p < level.offsets[v + 1]; p++) {
+        w = level.adj[p];
+        if (labels_[w] == unassigned && visited_[w] != stamp_) {
+          visited_[w] = stamp_;
+          queue_[tail++] = w;
+        }
+      }
+    }
+
+    // Keep the most populous piece of what is left; the district absorbs
+    // the rest, which only it can border.
+    stamp_++;
+    component_pops.clear();
+    for (v = 0; v < n; v++) {
+      if (labels_[v] != unassigned || visited_[v] == stamp_) {
+        continue;
+      }
+      component_pops.push_back(0);
+      queue_[0] = v;
+      visited_[v] = stamp_;
+      for (head = 0, tail = 1; head < tail; head++) {
+        w = queue_[head];
+        component[w] = component_pops.size() - 1;
+        component_pops.back() += level.pops[w];
+        for (p = level.offsets[w]; p < level.offsets[w + 1]; p++) {
+          if (labels_[level.adj[p]] == unassigned &&
+              visited_[level.adj[p]] != stamp_) {
+            visited_[level.adj[p]] = stamp_;
+            queue_[tail++] = level.adj[p];
+          }
+        }
+      }
+    }
+    if (component_pops.empty()) {
+      return false;
+    }
+    best = 0;
+    best_pop = component_pops[0];
+    for (v = 1; v < component_pops.size(); v++) {
+      if (component_pops[v] > best_pop) {
+        best = v;
+        best_pop = component_pops[v];
+      }
+    }
+    for (v = 0; v < n; v++) {
+      if (labels_[v] == unassigned && component[v] != best) {
+        labels_[v] = d;
+      }
+    }
+    remaining = best_pop;
+  }
+
+  for (v = 0; v < n; v++) {
+    if (labels_[v] == unassigned) {
+      labels_[v] = num_districts_ - 1;
+    }
+  }
+  return true;
+}
+
+void Multilevel::Refine(const Level &level) {
+  uint32_t pass, u, p, a, b, best, moved;
+  int64_t gain, best_gain;
+  bool fixes, best_fixes, allowed;
+  uint64_t pop;
+  vector<uint64_t> connection(num_districts_, 0);
+  vector<uint32_t> touched;
+
+  CountDistricts(level);
+
+  for (pass = 0; pass < kMaxPasses; pass++) {
+    moved = 0;
+    for (u = 0; u < level.num_nodes; u++) {
+      a = labels_[u];
+      pop = level.pops[u];
+
+      touched.clear();
+      for (p = level.offsets[u]; p < level.offsets[u + 1]; p++) {
+        b = labels_[level.adj[p]];
+        if (connection[b] == 0) {
+          touched.push_back(b);
+        }
+        connection[b] += level.edge_weights[p];
+      }
+
+      // Moves that bring a district back towards the bounds come first,
+      // then moves that shorten the boundary, then moves that even out
+      // the populations along an equally long boundary.
+      best = num_districts_;
+      best_gain = 0;
+      best_fixes = false;
+      for (auto &district : touched) {
+        b = district;
+        if (b == a) {
+          continue;
+        }
+        gain = (int64_t) connection[b] - (int64_t) connection[a];
+        fixes = (district_pops_[a] > upper_ || district_pops_[b] < lower_) &&
+                district_pops_[b] + pop < district_pops_[a];
+        allowed = district_pops_[b] + pop <= upper_ &&
+                  district_pops_[a] - pop >= lower_;
+        if (!fixes && !(allowed && (gain > 0 || (gain == 0 &&
+            district_pops_[b] + pop < district_pops_[a])))) {
+          continue;
+        }
+        if (best == num_districts_ || (fixes && !best_fixes) ||
+            (fixes == best_fixes && gain > best_gain)) {
+          best = b;
+          best_gain = gain;
+          best_fixes = fixes;
+        }
+      }
+      for (auto &district : touched) {
+        connection[district] = 0;
+      }
+
+      if (best == num_districts_ || district_sizes_[a] == 1 ||
+          IsSevered(level, u)) {
+        continue;
+      }
+      labels_[u] = best;
+      district_pops_[a] -= pop;
+      district_pops_[best] += pop;
+      district_sizes_[a]--;
+      district_sizes_[best]++;
+      moved++;
+    }
+    if (moved == 0) {
+      break;
+    }
+  }
+}
+
+bool Multilevel::IsSevered(const Level &level, uint32_t node) {
+  uint32_t district = labels_[node], p, v, w, head, tail, start = node;
+  uint32_t remaining = 0;
+
+  // Mark the node's neighbors in its district; the district stays whole
+  // iff they are all reached from one of them without the node.
+  stamp_++;
+  for (p = level.offsets[node]; p < level.offsets[node + 1]; p++) {
+    v = level.adj[p];
+    if (labels_[v] == district && v != node && targets_[v] != stamp_) {
+      targets_[v] = stamp_;
+      start = v;
+      remaining++;
+    }
+  }
+  if (remaining <= 1) {
+    return false;
+  }
+
+  visited_[node] = stamp_;
+  visited_[start] = stamp_;
+  queue_[0] = start;
+  remaining--;
+  for (head = 0, tail = 1; head < tail; head++) {
+    v = queue_[head];
+    for (p = level.offsets[v]; p < level.offsets[v + 1]; p++) {
+      w = level.adj[p];
+      if (labels_[w] != district || visited_[w] == stamp_) {
+        continue;
+      }
+      visited_[w] = stamp_;
+      if (targets_[w] == stamp_ && --remaining == 0) {
+        return false;
+      }
+      queue_[tail++] = w;
+    }
+  }
+  return true;
+}
+
+void Multilevel::CountDistricts(const Level &level) {
+  uint32_t v;
+
+  district_pops_.assign(num_districts_, 0);
+  district_sizes_.assign(num_districts_, 0);
+  for (v = 0; v < level.num_nodes; v++) {
+    district_pops_[labels_[v]] += level.pops[v];
+    district_sizes_[labels_[v]]++;
+  }
+}
+
+}   // namespace rakan
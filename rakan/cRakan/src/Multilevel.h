@@ -0,0 +1,154 @@
+#ifndef SRC_MULTILEVEL_H_
+#define SRC_MULTILEVEL_H_
+
+#include <inttypes.h>         // for uint32_t, uint64_t
+
+#include <vector>             // for std::vector
+
+#include "./Graph.h"          // for Graph class
+#include "./Rng.h"            // for Rng class
+
+using std::vector;
+
+namespace rakan {
+
+/*
+* A multilevel partitioner for building starting plans on very large
+* graphs, in the style of METIS. The graph is coarsened repeatedly by
+* heavy-edge matching, summing the populations of matched nodes and the
+* weights of merged edges. The coarsest graph is split into districts by
+* growing each district breadth-first from a peripheral node, and the
+* split is projected back level by level, with boundary refinement at
+* each level that restores the population balance and then shortens the
+* boundaries.
+*
+* Matched nodes are always adjacent, so every coarse node stands for a
+* connected set of nodes, and refinement never severs a district; the
+* plan is contiguous at every level, the finest included.
+*/
+class Multilevel {
+ public:
+  /////////////////////////////////////////////////////////////////////////////
+  // Constructors and destructors
+  /////////////////////////////////////////////////////////////////////////////
+
+  /*
+  * Creates a partitioner for a graph whose flattened adjacency and
+  * population columns have been built, see Graph::BuildAdjacency.
+  *
+  * @param    graph   the graph to partition
+  */
+  explicit Multilevel(Graph *graph);
+
+  /*
+  * Default destructor.
+  */
+  ~Multilevel();
+
+  Multilevel(const Multilevel &other) = delete;
+  Multilevel &operator=(const Multilevel &other) = delete;
+
+  /*
+  * Seeds the random matching order.
+  *
+  * @param    seed    the seed
+  */
+  void SetSeed(uint64_t seed) { rng_.Seed(seed); }
+
+  /////////////////////////////////////////////////////////////////////////////
+  // Algorithms
+  /////////////////////////////////////////////////////////////////////////////
+
+  /*
+  * Partitions the graph into contiguous districts of balanced population.
+  * A plan is made even if it misses the tolerance.
+  *
+  * @param    num_districts   the number of districts
+  * @param    tolerance       the allowed deviation from the ideal district
+  *                           population, as a fraction of the ideal;
+  *                           non-positive balances to within 1% where
+  *                           possible, but accepts any plan
+  *
+  * @return SUCCESS iff every district is within the tolerance;
+  *         SEED_FAILED if not, if the graph is disconnected, or if there
+  *         are more districts than nodes
+  */
+  uint16_t Partition(uint32_t num_districts, double tolerance);
+
+  /////////////////////////////////////////////////////////////////////////////
+  // Queries
+  /////////////////////////////////////////////////////////////////////////////
+
+  /*
+  * Gets the district of a node in the last plan made by Partition.
+  *
+  * @param    node    the ID of the node
+  *
+  * @return the district of the node
+  */
+  uint32_t GetDistrict(uint32_t node) const { return labels_[node]; }
+
+  /*
+  * Gets the number of levels of the last Partition, the graph included.
+  *
+  * @return the number of levels; 0 if no plan was made
+  */
+  uint32_t GetNumLevels() const { return levels_.size(); }
+
+ private:
+  // One level of the hierarchy, in the same flattened layout as the
+  // Graph's adjacency, with a weight per edge and a population per node.
+  // coarse_of maps each node to its node on the next coarser level.
+  struct Level {
+    uint32_t num_nodes;
+    vector<uint32_t> offsets;
+    vector<uint32_t> adj;
+    vector<uint32_t> edge_weights;
+    vector<uint64_t> pops;
+    vector<uint32_t> coarse_of;
+  };
+
+  // Builds the next coarser level from the last one. Returns false if it
+  // would not be much smaller.
+  bool Coarsen(uint64_t max_pop);
+
+  // Splits the coarsest level into districts. Returns false if some
+  // district ends up empty.
+  bool Grow(const Level &level);
+
+  // Refines the plan of a level in a few greedy passes over its nodes.
+  void Refine(const Level &level);
+
+  // Queries whether moving the node out of its district would sever the
+  // district on the given level.
+  bool IsSevered(const Level &level, uint32_t node);
+
+  // Recomputes the population and size of every district from labels_.
+  void CountDistricts(const Level &level);
+
+  // The graph that is partitioned, and its levels, finest first.
+  Graph *graph_;
+  vector<Level> levels_;
+
+  // The plan on the level being worked on, and its district totals.
+  uint32_t num_districts_;
+  vector<uint32_t> labels_;
+  vector<uint64_t> district_pops_;
+  vector<uint32_t> district_sizes_;
+
+  // The population bounds refinement works towards.
+  double lower_;
+  double upper_;
+
+  // Traversal scratch space, stamped like the Runner's.
+  vector<uint32_t> queue_;
+  vector<uint32_t> visited_;
+  vector<uint32_t> targets_;
+  uint32_t stamp_;
+
+  Rng rng_;
+};        // class Multilevel
+
+}         // namespace rakan
+
+#endif    // SRC_MULTILEVEL_H_
@@ -0,0 +1,188 @@
+#include "./MultipleTry.h"
+
+#include <math.h>             // for exp(), log(), INFINITY
+#include <inttypes.h>         // for uint32_t
+
+#include <vector>             // for std::vector
+
+#include "./BoundarySampler.h"  // for BoundarySampler class
+#include "./ContiguityChecker.h"  // for ContiguityChecker class
+#include "./Graph.h"          // for Graph class
+#include "./Runner.h"         // for Runner class, kAcceptanceFilter
+
+namespace rakan {
+
+///////////////////////////////////////////////////////////////////////////////
+// Constructors and destructors
+///////////////////////////////////////////////////////////////////////////////
+
+MultipleTry::MultipleTry(Runner *runner, uint32_t num_tries,
+                         uint32_t num_threads)
+    : runner_(runner),
+      graph_(runner->GetGraph()),
+      num_tries_(num_tries > 0 ? num_tries : 1),
+      pool_(num_threads) {
+  uint32_t i;
+
+  candidates_.reserve(num_tries_);
+  checkers_.resize(pool_.GetNumThreads());
+  for (i = 0; i < checkers_.size(); i++) {
+    checkers_[i].Reserve(graph_);
+  }
+}
+
+MultipleTry::~MultipleTry() {}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Algorithms
+///////////////////////////////////////////////////////////////////////////////
+
+double MultipleTry::Step() {
+  double old_score, max_log_weight, forward, backward, u;
+  double inverse_temp = runner_->inverse_temp_;
+  uint32_t i, node, new_district, old_district;
+  Candidate chosen;
+
+  runner_->num_steps_++;
+  old_score = runner_->LogScore();
+
+  if (!Draw(num_tries_)) {
+    return 0;
+  }
+  EvaluateAll(num_tries_);
+
+  // Pick a candidate in proportion to its weight.
+  max_log_weight = -INFINITY;
+  for (i = 0; i < num_tries_; i++) {
+    if (candidates_[i].log_weight > max_log_weight) {
+      max_log_weight = candidates_[i].log_weight;
+    }
+  }
+  if (max_log_weight == -INFINITY) {
+    runner_->rejections_[kAcceptanceFilter]++;
+    return 0;
+  }
+
+  forward = 0;
+  for (i = 0; i < num_tries_; i++) {
+    forward += exp(candidates_[i].log_weight - max_log_weight);
+  }
+  u = runner_->rng_.Uniform() * forward;
+  for (i = 0; i + 1 < num_tries_; i++) {
+    u -= exp(candidates_[i].log_weight - max_log_weight);
+    if (u < 0) {
+      break;
+    }
+  }
+  while (candidates_[i].log_weight == -INFINITY) {
+    i--;
+  }
+  chosen = candidates_[i];
+
+  node = chosen.node;
+  new_district = chosen.district;
+  old_district = graph_->district_of_node_[node];
+  Move(node, new_district);
+
+  // The reference set is drawn from the moved plan, and always includes
+  // the move back to the current plan. Its weights are rescaled to be
+  // relative to the current plan, like the forward weights.
+  backward = exp(-log(runner_->sampler_.Probability(node, old_district)) -
+                 max_log_weight);
+  if (num_tries_ > 1) {
+    Draw(num_tries_ - 1);
+    EvaluateAll(num_tries_ - 1);
+    for (i = 0; i + 1 < num_tries_; i++) {
+      backward += exp(candidates_[i].log_weight -
+                      inverse_temp * chosen.delta - max_log_weight);
+    }
+  }
+
+  if (runner_->rng_.Uniform() * backward > forward) {
+    Move(node, old_district);
+    runner_->rejections_[kAcceptanceFilter]++;
+    return 0;
+  }
+
+  runner_->RecordChange(node);
+  runner_->Journal(node, old_district);
+  runner_->num_accepted_++;
+  runner_->score_ = runner_->LogScore();
+
+  return old_score - runner_->score_;
+}
+
+double MultipleTry::Walk(int num_steps) {
+  double sum = 0;
+
+  runner_->ClearChanges();
+  for (int i = 0; i < num_steps; i++) {
+    sum += Step();
+  }
+
+  return sum;
+}
+
+bool MultipleTry::Draw(uint32_t count) {
+  uint32_t i;
+  BoundarySampler *sampler = &runner_->sampler_;
+
+  candidates_.resize(count);
+  for (i = 0; i < count; i++) {
+    if (!sampler->Sample(runner_->rng_.Uniform(), &candidates_[i].node,
+                         &candidates_[i].district)) {
+      return false;
+    }
+    candidates_[i].log_prob = log(sampler->Probability(
+        candidates_[i].node, candidates_[i].district));
+  }
+
+  return true;
+}
+
+void MultipleTry::EvaluateAll(uint32_t count) {
+  uint32_t num_blocks = checkers_.size();
+
+  auto evaluate_block = [this, count, num_blocks](uint32_t block) {
+    uint32_t begin = (uint64_t) block * count / num_blocks;
+    uint32_t end = (uint64_t) (block + 1) * count / num_blocks;
+    for (uint32_t i = begin; i < end; i++) {
+      Evaluate(&candidates_[i], &checkers_[block]);
+    }
+  };
+
+  pool_.ParallelFor(num_blocks, evaluate_block);
+}
+
+void MultipleTry::Evaluate(Candidate *candidate,
+                           ContiguityChecker *checker) {
+  uint32_t node = candidate->node, district = candidate->district;
+  uint32_t old_district = graph_->district_of_node_[node];
+  Node *graph_node = graph_->nodes_[node];
+
+  // The same checks as the Runner's filter pipeline, cheapest first.
+  candidate->log_weight = -INFINITY;
+  if (old_district == district ||
+      runner_->IsEmptyDistrict(old_district) ||
+      !runner_->IsWithinPopulationTolerance(graph_node, district)) {
+    return;
+  }
+
+  candidate->delta = runner_->ScoreDelta(graph_node, district);
+  if (checker->IsSevered(node)) {
+    return;
+  }
+
+  candidate->log_weight = -runner_->inverse_temp_ * candidate->delta -
+                          candidate->log_prob;
+}
+
+void MultipleTry::Move(uint32_t node, uint32_t district) {
+  graph_->RemoveNodeFromDistrict(graph_->nodes_[node],
+                                 graph_->district_of_node_[node]);
+  graph_->AddNodeToDistrict(graph_->nodes_[node], district);
+  runner_->sampler_.UpdateMove(node);
+}
+
+}   // namespace rakan
@@ -0,0 +1,135 @@
+#ifndef SRC_MULTIPLETRY_H_
+#define SRC_MULTIPLETRY_H_
+
+#include <inttypes.h>         // for uint32_t
+
+#include <vector>             // for std::vector
+
+#include "./ContiguityChecker.h"  // for ContiguityChecker class
+#include "./Graph.h"          // for Graph class
+#include "./Runner.h"         // for Runner class
+#include "./ThreadPool.h"     // for ThreadPool class
+
+using std::vector;
+
+namespace rakan {
+
+/*
+* A multiple-try Metropolis kernel over the boundary moves of a Runner's
+* plan. Each step draws several boundary moves from the Runner's sampler,
+* checks and scores them concurrently, picks one in proportion to its
+* weight, and accepts it against a reference set drawn from the moved plan
+* (Liu, Liang and Wong, 2000).
+*
+* A move y proposed from plan x with probability T(x, y) is weighted by
+* exp(-inverse temperature * score(y)) / T(x, y), so the chain keeps
+* exp(-inverse temperature * LogScore()) invariant over valid plans. Moves
+* that fail the Runner's empty, population or contiguity checks weigh 0.
+*
+* The Runner's random number generator draws every proposal and decision,
+* and candidates are split into fixed blocks, so a walk does not depend on
+* the number of threads.
+*/
+class MultipleTry {
+ public:
+  /////////////////////////////////////////////////////////////////////////////
+  // Constructors and destructors
+  /////////////////////////////////////////////////////////////////////////////
+
+  /*
+  * Creates a kernel that walks the plan of a Runner whose graph data has
+  * been populated. The Runner supplies the sampler, scoring weights,
+  * inverse temperature and population tolerance, and must outlive the
+  * kernel.
+  *
+  * @param    runner        the Runner to walk
+  * @param    num_tries     the number of proposals per step; at least 1
+  * @param    num_threads   the number of threads to run on; 0 uses one per
+  *                         hardware thread
+  */
+  MultipleTry(Runner *runner, uint32_t num_tries, uint32_t num_threads);
+
+  /*
+  * Default destructor.
+  */
+  ~MultipleTry();
+
+  MultipleTry(const MultipleTry &other) = delete;
+  MultipleTry &operator=(const MultipleTry &other) = delete;
+
+  /////////////////////////////////////////////////////////////////////////////
+  // Algorithms
+  /////////////////////////////////////////////////////////////////////////////
+
+  /*
+  * Takes one multiple-try step. Accepted moves are recorded by the Runner
+  * as if made by MetropolisHastings; rejections are counted under
+  * kAcceptanceFilter.
+  *
+  * @return the decrease in score made by this step; 0 if rejected
+  */
+  double Step();
+
+  /*
+  * Takes a given number of multiple-try steps.
+  *
+  * @param    num_steps   the number of steps to take
+  *
+  * @return a sum of the decreases in score made by the steps
+  */
+  double Walk(int num_steps);
+
+  /////////////////////////////////////////////////////////////////////////////
+  // Queries
+  /////////////////////////////////////////////////////////////////////////////
+
+  /*
+  * Gets the number of proposals drawn per step.
+  *
+  * @return the number of tries
+  */
+  uint32_t GetNumTries() const { return num_tries_; }
+
+ private:
+  // A proposed boundary move, the log of its proposal probability, and,
+  // once evaluated, the change in score it makes and its log weight.
+  struct Candidate {
+    uint32_t node;
+    uint32_t district;
+    double log_prob;
+    double delta;
+    double log_weight;
+  };
+
+  // Draws count candidates from the sampler into the front of candidates_.
+  // Returns false if the plan has no boundary moves.
+  bool Draw(uint32_t count);
+
+  // Computes the log weight of the first count candidates across the pool,
+  // relative to the current plan.
+  void EvaluateAll(uint32_t count);
+
+  // Computes the log weight of one candidate relative to the current plan.
+  void Evaluate(Candidate *candidate, ContiguityChecker *checker);
+
+  // Moves a node into a district, keeping the sampler up to date.
+  void Move(uint32_t node, uint32_t district);
+
+  // The Runner walked and its graph.
+  Runner *runner_;
+  Graph *graph_;
+
+  // The number of proposals per step, and the candidates of the current
+  // step.
+  uint32_t num_tries_;
+  vector<Candidate> candidates_;
+
+  // One contiguity checker per block of candidates.
+  vector<ContiguityChecker> checkers_;
+
+  ThreadPool pool_;
+};        // class MultipleTry
+
+}         // namespace rakan
+
+#endif    // SRC_MULTIPLETRY_H_
@@ -51,7 +51,9 @@ class Node {
   // Accessors
   /////////////////////////////////////////////////////////////////////////////
 
-  // Returns the district this node resides in.
+  // Returns the district this node is assigned when the graph's districts
+  // are populated. The live plan is kept by the Graph; see
+  // Graph::GetDistrictOf.
   uint32_t GetDistrict() { return district_; }
 
   uint32_t GetID() { return id_; }
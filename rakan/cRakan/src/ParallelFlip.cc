@@ -0,0 +1,224 @@
+#include "./ParallelFlip.h"
+
+#include <math.h>             // for exp(), fmin()
+#include <inttypes.h>         // for uint32_t, uint64_t
+
+#include <algorithm>          // for std::swap
+#include <vector>             // for std::vector
+
+#include "./Graph.h"          // for Graph class
+#include "./Runner.h"         // for Runner class
+
+namespace rakan {
+
+///////////////////////////////////////////////////////////////////////////////
+// Constructors and destructors
+///////////////////////////////////////////////////////////////////////////////
+
+ParallelFlip::ParallelFlip(Runner *runner, uint32_t num_threads)
+    : runner_(runner),
+      graph_(runner->GetGraph()),
+      num_pairs_(0),
+      pool_(num_threads) {
+  uint32_t i;
+
+  districts_.resize(graph_->num_districts_);
+  for (i = 0; i < districts_.size(); i++) {
+    districts_[i] = i;
+  }
+
+  pairs_.resize(graph_->num_districts_ / 2);
+  for (i = 0; i < pairs_.size(); i++) {
+    pairs_[i].nodes.reserve(graph_->num_nodes_);
+  }
+
+  checkers_.resize(pool_.GetNumThreads());
+  for (i = 0; i < checkers_.size(); i++) {
+    checkers_[i].Reserve(graph_);
+  }
+
+  SetSeed(runner->GetRng()->Next());
+}
+
+ParallelFlip::~ParallelFlip() {}
+
+void ParallelFlip::SetSeed(uint64_t seed) {
+  uint32_t i;
+
+  for (i = 0; i < pairs_.size(); i++) {
+    pairs_[i].rng.SeedStream(seed, i + 1);
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Algorithms
+///////////////////////////////////////////////////////////////////////////////
+
+double ParallelFlip::Walk(uint32_t num_epochs, uint32_t steps_per_pair) {
+  uint32_t epoch, num_blocks = checkers_.size();
+  double old_score;
+
+  auto run_block = [this, steps_per_pair, num_blocks](uint32_t block) {
+    uint32_t begin = (uint64_t) block * num_pairs_ / num_blocks;
+    uint32_t end = (uint64_t) (block + 1) * num_pairs_ / num_blocks;
+    for (uint32_t i = begin; i < end; i++) {
+      RunPair(&pairs_[i], steps_per_pair, &checkers_[block]);
+    }
+  };
+
+  runner_->ClearChanges();
+  old_score = runner_->LogScore();
+
+  for (epoch = 0; epoch < num_epochs; epoch++) {
+    Regroup();
+    pool_.ParallelFor(num_blocks, run_block);
+    Commit();
+    runner_->num_steps_ += (uint64_t) num_pairs_ * steps_per_pair;
+  }
+
+  runner_->score_ = runner_->LogScore();
+  return old_score - runner_->score_;
+}
+
+void ParallelFlip::Regroup() {
+  uint32_t i, j;
+  Rng *rng = runner_->GetRng();
+
+  // Any permutation shuffles to a uniform one, so the last epoch's order
+  // is reused.
+  for (i = districts_.size(); i > 1; i--) {
+    j = rng->UniformInt(i);
+    std::swap(districts_[i - 1], districts_[j]);
+  }
+
+  num_pairs_ = pairs_.size();
+  for (i = 0; i < num_pairs_; i++) {
+    pairs_[i].district_a = districts_[2 * i];
+    pairs_[i].district_b = districts_[2 * i + 1];
+  }
+}
+
+bool ParallelFlip::Borders(uint32_t a, uint32_t b) const {
+  uint32_t node, p, none = graph_->num_nodes_;
+
+  // Moves of other pairs never change which nodes of a are on its
+  // perimeter, since their nodes stay foreign to a.
+  for (node = graph_->first_on_perim_[a]; node != none;
+       node = graph_->next_on_perim_[node]) {
+    for (p = graph_->adj_offsets_[node]; p < graph_->adj_offsets_[node + 1];
+         p++) {
+      if (graph_->LoadDistrict(graph_->adj_[p]) == b) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+void ParallelFlip::RunPair(Pair *pair, uint32_t num_steps,
+                           ContiguityChecker *checker) {
+  uint32_t step, node, p, old_district, new_district, none = graph_->num_nodes_;
+  uint32_t a = pair->district_a, b = pair->district_b;
+  double inverse_temp = runner_->inverse_temp_;
+  bool borders;
+  Node *graph_node;
+
+  pair->moved.clear();
+  pair->moved_from.clear();
+  pair->num_accepted = 0;
+  for (p = 0; p < kNumFilterStages; p++) {
+    pair->rejections[p] = 0;
+  }
+
+  // Every proposal of a pair that does not border would fail the label
+  // filter, and none of them can make the pair border.
+  if (!Borders(a, b)) {
+    pair->rejections[kLabelFilter] = num_steps;
+    return;
+  }
+
+  // The pair's nodes stay the same throughout the epoch.
+  pair->nodes.clear();
+  for (node = graph_->first_in_district_[a]; node != none;
+       node = graph_->next_in_district_[node]) {
+    pair->nodes.push_back(node);
+  }
+  for (node = graph_->first_in_district_[b]; node != none;
+       node = graph_->next_in_district_[node]) {
+    pair->nodes.push_back(node);
+  }
+
+  for (step = 0; step < num_steps; step++) {
+    node = pair->nodes[pair->rng.UniformInt(pair->nodes.size())];
+    graph_node = graph_->nodes_[node];
+    old_district = graph_->district_of_node_[node];
+    new_district = old_district == a ? b : a;
+
+    borders = false;
+    for (p = graph_->adj_offsets_[node]; p < graph_->adj_offsets_[node + 1];
+         p++) {
+      if (graph_->LoadDistrict(graph_->adj_[p]) == new_district) {
+        borders = true;
+        break;
+      }
+    }
+    if (!borders) {
+      pair->rejections[kLabelFilter]++;
+      continue;
+    }
+
+    if (runner_->IsEmptyDistrict(old_district)) {
+      pair->rejections[kEmptyFilter]++;
+      continue;
+    }
+
+    if (!runner_->IsWithinPopulationTolerance(graph_node, new_district)) {
+      pair->rejections[kPopulationFilter]++;
+      continue;
+    }
+
+    // The acceptance test does not depend on contiguity, so it is drawn
+    // first to skip the traversal for moves that would be rejected anyway.
+    if (pair->rng.Uniform() >
+        fmin(1, exp(-inverse_temp *
+                    runner_->ScoreDelta(graph_node, new_district)))) {
+      pair->rejections[kAcceptanceFilter]++;
+      continue;
+    }
+
+    if (checker->IsSevered(node)) {
+      pair->rejections[kContiguityFilter]++;
+      continue;
+    }
+
+    graph_->RemoveNodeFromDistrict(graph_node, old_district);
+    graph_->AddNodeToDistrict(graph_node, new_district);
+    pair->moved.push_back(node);
+    pair->moved_from.push_back(old_district);
+    pair->num_accepted++;
+  }
+}
+
+void ParallelFlip::Commit() {
+  uint32_t i, j, stage;
+  Pair *pair;
+
+  // The graph already holds every move of the epoch, so they are journaled
+  // as one batch; see Runner::TrimJournal.
+  for (i = 0; i < num_pairs_; i++) {
+    pair = &pairs_[i];
+    for (j = 0; j < pair->moved.size(); j++) {
+      runner_->sampler_.UpdateMove(pair->moved[j]);
+      runner_->RecordChange(pair->moved[j]);
+      runner_->AppendToJournal(pair->moved[j], pair->moved_from[j]);
+    }
+    runner_->num_accepted_ += pair->num_accepted;
+    for (stage = 0; stage < kNumFilterStages; stage++) {
+      runner_->rejections_[stage] += pair->rejections[stage];
+    }
+  }
+  runner_->TrimJournal();
+}
+
+}   // namespace rakan
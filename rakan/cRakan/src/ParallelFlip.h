@@ -0,0 +1,157 @@
+#ifndef SRC_PARALLELFLIP_H_
+#define SRC_PARALLELFLIP_H_
+
+#include <inttypes.h>         // for uint32_t, uint64_t
+
+#include <vector>             // for std::vector
+
+#include "./ContiguityChecker.h"  // for ContiguityChecker class
+#include "./Graph.h"          // for Graph class
+#include "./Rng.h"            // for Rng class
+#include "./Runner.h"         // for Runner class, kNumFilterStages
+#include "./ThreadPool.h"     // for ThreadPool class
+
+using std::vector;
+
+namespace rakan {
+
+/*
+* A domain-decomposed flip kernel that walks one chain on several threads.
+* Each epoch, the districts are matched into disjoint pairs, and every pair
+* takes its own single-node flips between its two districts concurrently
+* with the others. A flip only changes the totals of the two districts it
+* moves between, so pairs never write the same data. They do read the
+* districts of nodes across their border, which other pairs may be moving,
+* so every label a move reads or writes goes through a relaxed atomic
+* access; such labels are only compared with the pair's own two districts,
+* which those nodes never enter, so any value read will do. The epoch ends
+* with a barrier, where the Runner's sampler, change record and best-plan
+* journal catch up with the moves made.
+*
+* A flip picks a uniformly random node of the pair and proposes moving it
+* into the other district of the pair; since the pair's nodes stay the
+* same, the proposal is symmetric and the move is accepted with
+* probability min(1, exp(-inverse temperature * score change)). Moves that
+* would leave the other district unreachable, empty a district, break the
+* population tolerance or sever a district are rejected, as in
+* MetropolisHastings. Every epoch therefore keeps the Runner's target
+* distribution invariant.
+*
+* The matching must not depend on the current plan for that to hold, so
+* each epoch pairs up a uniformly random shuffle of all the districts.
+* Every pair of districts is therefore matched now and then, and the chain
+* can reach plans where any two districts touch. A pair whose districts do
+* not border each other can make no moves, so it is skipped; only its own
+* moves could make them border.
+*
+* Every pair slot draws from its own stream, and the matching is drawn by
+* the Runner's generator, so a walk does not depend on the number of
+* threads.
+*/
+class ParallelFlip {
+ public:
+  /////////////////////////////////////////////////////////////////////////////
+  // Constructors and destructors
+  /////////////////////////////////////////////////////////////////////////////
+
+  /*
+  * Creates a kernel that walks the plan of a Runner whose graph data has
+  * been populated. The Runner supplies the scoring weights, inverse
+  * temperature and population tolerance, and must outlive the kernel.
+  *
+  * @param    runner        the Runner to walk
+  * @param    num_threads   the number of threads to run on; 0 uses one per
+  *                         hardware thread
+  */
+  ParallelFlip(Runner *runner, uint32_t num_threads);
+
+  /*
+  * Default destructor.
+  */
+  ~ParallelFlip();
+
+  ParallelFlip(const ParallelFlip &other) = delete;
+  ParallelFlip &operator=(const ParallelFlip &other) = delete;
+
+  /*
+  * Seeds every pair slot from independent streams of one seed.
+  *
+  * @param    seed    the seed
+  */
+  void SetSeed(uint64_t seed);
+
+  /////////////////////////////////////////////////////////////////////////////
+  // Algorithms
+  /////////////////////////////////////////////////////////////////////////////
+
+  /*
+  * Walks for a number of epochs. Each epoch draws a new matching and takes
+  * the given number of flip proposals in every pair. Accepted and rejected
+  * proposals are counted by the Runner as if made by MetropolisHastings;
+  * proposals of nodes that do not border the other district of their pair
+  * are counted under kLabelFilter.
+  *
+  * @param    num_epochs        the number of epochs
+  * @param    steps_per_pair    the number of proposals per pair per epoch
+  *
+  * @return the decrease in score made by the walk
+  */
+  double Walk(uint32_t num_epochs, uint32_t steps_per_pair);
+
+  /////////////////////////////////////////////////////////////////////////////
+  // Queries
+  /////////////////////////////////////////////////////////////////////////////
+
+  /*
+  * Gets the number of pairs matched by the last epoch, including pairs
+  * that were skipped because their districts do not border.
+  *
+  * @return the number of pairs
+  */
+  uint32_t GetNumPairs() const { return num_pairs_; }
+
+ private:
+  // A pair of districts walked by one task, and what it did this epoch.
+  struct Pair {
+    uint32_t district_a;
+    uint32_t district_b;
+    Rng rng;
+    vector<uint32_t> nodes;
+    vector<uint32_t> moved;
+    vector<uint32_t> moved_from;
+    uint64_t num_accepted;
+    uint64_t rejections[kNumFilterStages];
+  };
+
+  // Draws a random matching of all the districts into pairs.
+  void Regroup();
+
+  // Returns whether any node of district a borders district b.
+  bool Borders(uint32_t a, uint32_t b) const;
+
+  // Takes flip proposals within one pair.
+  void RunPair(Pair *pair, uint32_t num_steps, ContiguityChecker *checker);
+
+  // Hands the moves and counts of every pair to the Runner.
+  void Commit();
+
+  // The Runner walked and its graph.
+  Runner *runner_;
+  Graph *graph_;
+
+  // Scratch space for shuffling the districts into pairs.
+  vector<uint32_t> districts_;
+
+  // One slot per possible pair; the first num_pairs_ are matched.
+  vector<Pair> pairs_;
+  uint32_t num_pairs_;
+
+  // One contiguity checker per block of pairs.
+  vector<ContiguityChecker> checkers_;
+
+  ThreadPool pool_;
+};        // class ParallelFlip
+
+}         // namespace rakan
+
+#endif    // SRC_PARALLELFLIP_H_
@@ -0,0 +1,186 @@
+#include "./ParallelTempering.h"
+
+#include <math.h>             // for exp(), log(), pow(), fmin()
+#include <inttypes.h>         // for uint32_t, uint64_t
+
+#include <functional>         // for std::function
+#include <vector>             // for std::vector
+
+#include "./Graph.h"          // for Graph class
+#include "./Runner.h"         // for Runner class
+
+namespace rakan {
+
+///////////////////////////////////////////////////////////////////////////////
+// Constructors and destructors
+///////////////////////////////////////////////////////////////////////////////
+
+ParallelTempering::ParallelTempering(Runner *base, uint32_t num_replicas,
+                                     uint32_t num_threads)
+    : adapt_(false),
+      target_rate_(0.25),
+      adapt_steps_(0),
+      num_rounds_(0),
+      pool_(num_threads) {
+  uint32_t i;
+  Graph *graph;
+  Runner *replica;
+
+  for (i = 0; i < num_replicas; i++) {
+    graph = new Graph(*base->GetGraph());
+    replica = new Runner(graph);
+    replica->CopySettings(*base);
+    replica->AdoptGraphData();
+    graphs_.push_back(graph);
+    replicas_.push_back(replica);
+    replica_at_.push_back(i);
+  }
+
+  swaps_proposed_.assign(num_replicas, 0);
+  swaps_accepted_.assign(num_replicas, 0);
+
+  SetGeometricLadder(0.1);
+  SetSeed(base->GetRng()->Next());
+}
+
+ParallelTempering::~ParallelTempering() {
+  uint32_t i;
+
+  for (i = 0; i < replicas_.size(); i++) {
+    delete replicas_[i];
+    delete graphs_[i];
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Settings
+///////////////////////////////////////////////////////////////////////////////
+
+void ParallelTempering::SetSeed(uint64_t seed) {
+  uint32_t i;
+
+  rng_.SeedStream(seed, 0);
+  for (i = 0; i < replicas_.size(); i++) {
+    replicas_[i]->GetRng()->SeedStream(seed, i + 1);
+  }
+}
+
+bool ParallelTempering::SetLadder(const vector<double> &ladder) {
+  uint32_t i;
+
+  if (ladder.size() != replicas_.size() || ladder[0] != 1) {
+    return false;
+  }
+  for (i = 1; i < ladder.size(); i++) {
+    if (ladder[i] <= 0 || ladder[i] >= ladder[i - 1]) {
+      return false;
+    }
+  }
+
+  ladder_ = ladder;
+  ApplyLadder();
+  return true;
+}
+
+void ParallelTempering::SetGeometricLadder(double hottest) {
+  uint32_t i, n = replicas_.size();
+
+  ladder_.assign(n, 1);
+  for (i = 1; i < n; i++) {
+    ladder_[i] = pow(hottest, ((double) i) / (n - 1));
+  }
+  ApplyLadder();
+}
+
+void ParallelTempering::SetAdaptation(bool enabled, double target_rate) {
+  adapt_ = enabled;
+  target_rate_ = target_rate;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Algorithms
+///////////////////////////////////////////////////////////////////////////////
+
+void ParallelTempering::Run(uint32_t num_rounds, uint32_t steps_per_round) {
+  uint32_t round, rung;
+  vector<Runner *> &replicas = replicas_;
+
+  for (round = 0; round < num_rounds; round++) {
+    pool_.ParallelFor(replicas.size(),
+                      [&replicas, steps_per_round](uint32_t i) {
+                        replicas[i]->Walk(steps_per_round);
+                      });
+
+    for (rung = num_rounds_ % 2; rung + 1 < replicas_.size(); rung += 2) {
+      ProposeSwap(rung);
+    }
+    if (adapt_) {
+      adapt_steps_++;
+      for (rung = 1; rung < ladder_.size(); rung++) {
+        ladder_[rung] = ladder_[rung - 1] * exp(-log_gaps_[rung - 1]);
+      }
+      ApplyLadder();
+    }
+    num_rounds_++;
+
+    if (callback_) {
+      callback_(GetColdReplica());
+    }
+  }
+}
+
+void ParallelTempering::ProposeSwap(uint32_t rung) {
+  uint32_t cold = replica_at_[rung], hot = replica_at_[rung + 1];
+  double cold_score, hot_score, acceptance, step;
+
+  cold_score = replicas_[cold]->LogScore();
+  hot_score = replicas_[hot]->LogScore();
+  acceptance = fmin(1, exp((ladder_[rung] - ladder_[rung + 1]) *
+                           (cold_score - hot_score)));
+
+  swaps_proposed_[rung]++;
+  if (rng_.Uniform() < acceptance) {
+    swaps_accepted_[rung]++;
+    replica_at_[rung] = hot;
+    replica_at_[rung + 1] = cold;
+    replicas_[hot]->SetInverseTemperature(ladder_[rung]);
+    replicas_[cold]->SetInverseTemperature(ladder_[rung + 1]);
+  }
+
+  if (adapt_) {
+    // Robbins-Monro step on the log gap between the two rungs, using the
+    // acceptance probability rather than the outcome to reduce noise. The
+    // step is multiplicative, so gaps stay positive and the ladder stays
+    // decreasing.
+    step = 1 / pow(1 + adapt_steps_, 0.6);
+    log_gaps_[rung] *= exp(step * (acceptance - target_rate_));
+  }
+}
+
+void ParallelTempering::ApplyLadder() {
+  uint32_t rung;
+
+  log_gaps_.resize(ladder_.size());
+  for (rung = 0; rung + 1 < ladder_.size(); rung++) {
+    log_gaps_[rung] = log(ladder_[rung]) - log(ladder_[rung + 1]);
+  }
+  for (rung = 0; rung < replicas_.size(); rung++) {
+    replicas_[replica_at_[rung]]->SetInverseTemperature(ladder_[rung]);
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Queries
+///////////////////////////////////////////////////////////////////////////////
+
+double ParallelTempering::GetSwapRate(uint32_t rung) const {
+  if (swaps_proposed_[rung] == 0) {
+    return 0;
+  }
+  return ((double) swaps_accepted_[rung]) / swaps_proposed_[rung];
+}
+
+}   // namespace rakan
@@ -0,0 +1,216 @@
+#ifndef SRC_PARALLELTEMPERING_H_
+#define SRC_PARALLELTEMPERING_H_
+
+#include <inttypes.h>         // for uint32_t, uint64_t
+
+#include <functional>         // for std::function
+#include <vector>             // for std::vector
+
+#include "./Graph.h"          // for Graph class
+#include "./Rng.h"            // for Rng class
+#include "./Runner.h"         // for Runner class
+#include "./ThreadPool.h"     // for ThreadPool class
+
+using std::vector;
+
+namespace rakan {
+
+/*
+* A replica-exchange driver. Runs one Runner per rung of a ladder of inverse
+* temperatures, each on its own copy of the plan, and walks them in
+* parallel. Between walks, replicas on neighboring rungs propose to swap
+* temperatures. A swap only exchanges the rung assignments, so it is O(1)
+* regardless of the size of the plans.
+*
+* Rung 0 is the cold chain at inverse temperature 1; only its states are
+* samples of the target distribution.
+*/
+class ParallelTempering {
+ public:
+  /////////////////////////////////////////////////////////////////////////////
+  // Constructors and destructors
+  /////////////////////////////////////////////////////////////////////////////
+
+  /*
+  * Creates the replicas from a Runner whose graph data has been populated.
+  * Every replica starts from the base Runner's current plan and settings.
+  * The default ladder is geometric from 1 down to 0.1.
+  *
+  * @param    base            the Runner to copy the plan and settings of
+  * @param    num_replicas    the number of replicas, at least 1
+  * @param    num_threads     the number of threads to walk with; 0 uses
+  *                           one per hardware thread
+  */
+  ParallelTempering(Runner *base, uint32_t num_replicas, uint32_t num_threads);
+
+  /*
+  * Destroys all replicas and their graphs.
+  */
+  ~ParallelTempering();
+
+  ParallelTempering(const ParallelTempering &other) = delete;
+  ParallelTempering &operator=(const ParallelTempering &other) = delete;
+
+  /////////////////////////////////////////////////////////////////////////////
+  // Settings
+  /////////////////////////////////////////////////////////////////////////////
+
+  /*
+  * Seeds every replica and the swap decisions from independent streams of
+  * one seed.
+  *
+  * @param    seed    the seed to derive all streams from
+  */
+  void SetSeed(uint64_t seed);
+
+  /*
+  * Sets the inverse temperatures of the rungs.
+  *
+  * @param    ladder    one inverse temperature per replica, starting at 1
+  *                     and strictly decreasing
+  *
+  * @return true iff the ladder is valid and has been applied
+  */
+  bool SetLadder(const vector<double> &ladder);
+
+  /*
+  * Sets the ladder to a geometric sequence from 1 down to the given
+  * inverse temperature.
+  *
+  * @param    hottest   the inverse temperature of the hottest rung, in
+  *                     (0, 1)
+  */
+  void SetGeometricLadder(double hottest);
+
+  /*
+  * Enables or disables adapting the ladder from the observed swap rates.
+  * While enabled, the gap between each pair of rungs is widened when
+  * their swaps succeed more often than the target rate and narrowed when
+  * they succeed less often, with a step that shrinks over time. Meant for
+  * burn-in; disable it before collecting samples.
+  *
+  * @param    enabled       true to adapt the ladder
+  * @param    target_rate   the swap rate to aim for between each pair of
+  *                         neighboring rungs
+  */
+  void SetAdaptation(bool enabled, double target_rate);
+
+  /*
+  * Sets a function to call with the cold chain after every round.
+  *
+  * @param    callback    the function to call; empty for none
+  */
+  void SetSampleCallback(std::function<void(Runner *)> callback) {
+    callback_ = callback;
+  }
+
+  /////////////////////////////////////////////////////////////////////////////
+  // Algorithms
+  /////////////////////////////////////////////////////////////////////////////
+
+  /*
+  * Runs rounds of replica exchange. Each round walks every replica for
+  * the given number of steps in parallel, proposes swaps between
+  * neighboring rungs, and hands the cold chain to the sample callback.
+  * Rounds alternate between swapping even and odd pairs of rungs.
+  *
+  * @param    num_rounds        the number of rounds to run
+  * @param    steps_per_round   the number of steps each replica walks
+  *                             between swap proposals
+  */
+  void Run(uint32_t num_rounds, uint32_t steps_per_round);
+
+  /////////////////////////////////////////////////////////////////////////////
+  // Queries
+  /////////////////////////////////////////////////////////////////////////////
+
+  /*
+  * Gets the replica currently on the given rung.
+  *
+  * @param    rung    the rung, 0 being the cold chain
+  *
+  * @return the Runner on that rung
+  */
+  Runner *GetReplica(uint32_t rung) { return replicas_[replica_at_[rung]]; }
+
+  /*
+  * Gets the replica currently at inverse temperature 1.
+  *
+  * @return the cold chain
+  */
+  Runner *GetColdReplica() { return GetReplica(0); }
+
+  /*
+  * Gets the inverse temperature of the given rung.
+  *
+  * @param    rung    the rung
+  *
+  * @return the inverse temperature of the rung
+  */
+  double GetInverseTemperature(uint32_t rung) const { return ladder_[rung]; }
+
+  /*
+  * Gets the fraction of proposed swaps between the given rung and the
+  * next hotter one that were accepted.
+  *
+  * @param    rung    the colder rung of the pair
+  *
+  * @return the swap rate of the pair; 0 if no swap has been proposed
+  */
+  double GetSwapRate(uint32_t rung) const;
+
+  /*
+  * Gets the number of replicas.
+  *
+  * @return the number of replicas
+  */
+  uint32_t GetNumReplicas() const { return replicas_.size(); }
+
+ private:
+  // Proposes a swap between the replicas on the given rung and the next.
+  void ProposeSwap(uint32_t rung);
+
+  // Moves every replica to the inverse temperature of its rung, and
+  // records the gaps between rungs for adaptation.
+  void ApplyLadder();
+
+  // The replicas and the graphs they walk on, indexed by replica.
+  vector<Runner *> replicas_;
+  vector<Graph *> graphs_;
+
+  // The replica on each rung, indexed by rung.
+  vector<uint32_t> replica_at_;
+
+  // The inverse temperature of each rung, indexed by rung.
+  vector<double> ladder_;
+
+  // The gap in log inverse temperature between each rung and the next,
+  // indexed by the colder rung. Adaptation works on these gaps.
+  vector<double> log_gaps_;
+
+  // The number of proposed and accepted swaps between each rung and the
+  // next, indexed by the colder rung.
+  vector<uint64_t> swaps_proposed_;
+  vector<uint64_t> swaps_accepted_;
+
+  // Ladder adaptation settings and the number of adaptation steps taken.
+  bool adapt_;
+  double target_rate_;
+  uint64_t adapt_steps_;
+
+  // The number of rounds run, used to alternate even and odd swaps.
+  uint64_t num_rounds_;
+
+  // The random number generator for swap decisions.
+  Rng rng_;
+
+  // Runs the replicas' walks.
+  ThreadPool pool_;
+
+  // Called with the cold chain after every round.
+  std::function<void(Runner *)> callback_;
+};        // class ParallelTempering
+
+}         // namespace rakan
+
+#endif    // SRC_PARALLELTEMPERING_H_
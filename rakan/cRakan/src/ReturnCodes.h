@@ -10,5 +10,7 @@
 #define SEED_FAILED 6
 #define POPULATE_FAILED 7
 #define WALK_FAILED 8
+#define SAMPLE_FAILED 9
+#define REPAIR_FAILED 10
 
 #endif    // ERROR_CODES_H_
@@ -0,0 +1,105 @@
+#include "./Rng.h"
+
+#include <inttypes.h>         // for uint64_t, uint32_t
+
+namespace rakan {
+
+// The seed used by default-constructed generators.
+static const uint64_t kDefaultSeed = 0x853c49e6748fea9bULL;
+
+///////////////////////////////////////////////////////////////////////////////
+// Constructors
+///////////////////////////////////////////////////////////////////////////////
+
+Rng::Rng() {
+  Seed(kDefaultSeed);
+}
+
+Rng::Rng(uint64_t seed) {
+  Seed(seed);
+}
+
+void Rng::Seed(uint64_t seed) {
+  uint64_t z;
+  int i;
+
+  // Expand the seed with splitmix64, as recommended by the xoshiro authors.
+  for (i = 0; i < 4; i++) {
+    seed += 0x9e3779b97f4a7c15ULL;
+    z = seed;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    state_[i] = z ^ (z >> 31);
+  }
+
+  buffer_pos_ = kBufferSize;
+}
+
+void Rng::Jump() {
+  static const uint64_t kJump[] = {
+    0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+    0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL
+  };
+  uint64_t s[4] = {0, 0, 0, 0};
+  int i, b, j;
+
+  for (i = 0; i < 4; i++) {
+    for (b = 0; b < 64; b++) {
+      if (kJump[i] & (1ULL << b)) {
+        for (j = 0; j < 4; j++) {
+          s[j] ^= state_[j];
+        }
+      }
+      Next();
+    }
+  }
+
+  for (j = 0; j < 4; j++) {
+    state_[j] = s[j];
+  }
+  buffer_pos_ = kBufferSize;
+}
+
+void Rng::SeedStream(uint64_t seed, uint32_t stream) {
+  uint32_t i;
+
+  Seed(seed);
+  for (i = 0; i < stream; i++) {
+    Jump();
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Draws
+///////////////////////////////////////////////////////////////////////////////
+
+uint32_t Rng::UniformInt(uint32_t bound) {
+  uint64_t product;
+  uint32_t low, threshold;
+
+  // Lemire's multiply-and-reject method.
+  product = (Next() >> 32) * bound;
+  low = (uint32_t) product;
+  if (low < bound) {
+    threshold = (0u - bound) % bound;
+    while (low < threshold) {
+      product = (Next() >> 32) * bound;
+      low = (uint32_t) product;
+    }
+  }
+
+  return product >> 32;
+}
+
+void Rng::Refill() {
+  int i;
+
+  // The top 53 bits fill the mantissa of a double in [0, 1).
+  for (i = 0; i < kBufferSize; i++) {
+    buffer_[i] = (Next() >> 11) * (1.0 / 9007199254740992.0);
+  }
+  buffer_pos_ = 0;
+}
+
+}   // namespace rakan
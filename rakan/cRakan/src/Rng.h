@@ -0,0 +1,127 @@
+#ifndef SRC_RNG_H_
+#define SRC_RNG_H_
+
+#include <inttypes.h>         // for uint64_t, uint32_t
+
+namespace rakan {
+
+/*
+* A seedable xoshiro256** pseudo-random number generator. The state is
+* expanded from a 64-bit seed with splitmix64, so every seed yields a
+* well-mixed, non-zero state.
+*
+* Independent streams for parallel chains are made by copying a generator
+* and calling Jump on the copy; each jump advances the state by 2^128
+* draws, so streams cannot overlap in practice.
+*
+* Uniform doubles are generated in blocks into an internal buffer, which
+* keeps the generator's state in registers across the block.
+*/
+class Rng {
+ public:
+  /////////////////////////////////////////////////////////////////////////////
+  // Constructors
+  /////////////////////////////////////////////////////////////////////////////
+
+  /*
+  * Constructs a generator with the default seed.
+  */
+  Rng();
+
+  /*
+  * Constructs a generator with the given seed.
+  *
+  * @param    seed    the seed to expand into the generator's state
+  */
+  explicit Rng(uint64_t seed);
+
+  /*
+  * Reseeds the generator, discarding any buffered uniforms.
+  *
+  * @param    seed    the seed to expand into the generator's state
+  */
+  void Seed(uint64_t seed);
+
+  /*
+  * Advances the generator by 2^128 draws, discarding any buffered
+  * uniforms. Calling Jump n times on copies of one generator gives n
+  * non-overlapping streams.
+  */
+  void Jump();
+
+  /*
+  * Seeds the generator and selects one of its independent streams. The
+  * same seed and stream always yield the same sequence.
+  *
+  * @param    seed      the seed shared by all streams
+  * @param    stream    the index of the stream to select
+  */
+  void SeedStream(uint64_t seed, uint32_t stream);
+
+  /////////////////////////////////////////////////////////////////////////////
+  // Draws
+  /////////////////////////////////////////////////////////////////////////////
+
+  /*
+  * Draws the next 64 random bits.
+  *
+  * @return a uniformly distributed 64-bit integer
+  */
+  uint64_t Next() {
+    uint64_t result = Rotl(state_[1] * 5, 7) * 9;
+    uint64_t t = state_[1] << 17;
+
+    state_[2] ^= state_[0];
+    state_[3] ^= state_[1];
+    state_[1] ^= state_[2];
+    state_[0] ^= state_[3];
+    state_[2] ^= t;
+    state_[3] = Rotl(state_[3], 45);
+
+    return result;
+  }
+
+  /*
+  * Draws a uniform double from the block buffer.
+  *
+  * @return a uniformly distributed double in [0, 1)
+  */
+  double Uniform() {
+    if (buffer_pos_ == kBufferSize) {
+      Refill();
+    }
+    return buffer_[buffer_pos_++];
+  }
+
+  /*
+  * Draws a uniform integer below the given bound, without modulo bias.
+  *
+  * @param    bound   the exclusive upper bound; must be positive
+  *
+  * @return a uniformly distributed integer in [0, bound)
+  */
+  uint32_t UniformInt(uint32_t bound);
+
+ private:
+  // The number of uniforms generated per refill of the buffer.
+  static const int kBufferSize = 64;
+
+  // Rotates x left by k bits.
+  static uint64_t Rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+  }
+
+  // Refills the uniform buffer from the generator.
+  void Refill();
+
+  // The xoshiro256** state. Never all zero.
+  uint64_t state_[4];
+
+  // Buffered uniforms; the next one to hand out is at buffer_pos_.
+  double buffer_[kBufferSize];
+  int buffer_pos_;
+};        // class Rng
+
+}         // namespace rakan
+
+#endif    // SRC_RNG_H_
@@ -1,33 +1,57 @@
 #include "./Runner.h"
 
-#include <math.h>               // for pow(), log(), fmin()
+#include <math.h>               // for pow(), exp(), fmin(), fabs()
 #include <inttypes.h>           // for uint32_t, etc.
-#include <stdlib.h>             // for rand()
+#include <time.h>               // for clock_gettime()
 
-#include <algorithm>            // for find()
-#include <chrono>               // for system_clock:now()
+#include <algorithm>            // for find(), fill()
+#include <chrono>               // for steady_clock
 #include <queue>                // for queue
-#include <random>               // for uniform_real_distribution()
 #include <unordered_set>        // for std::unordered_set
-#include <utility>              // for std::pair
 #include <vector>               // for std::vector
 
 #include "./ReturnCodes.h"      // for SUCCESS, READ_FAIL, SEEK_FAIL, etc.
 #include "./Graph.h"            // for class Graph
+#include "./Multilevel.h"       // for class Multilevel
 #include "./Node.h"             // for class Node
+#include "./ThreadPool.h"       // for class ThreadPool
 
 using std::queue;
-using std::uniform_real_distribution;
 using std::unordered_map;
 using std::unordered_set;
 using std::vector;
 
 namespace rakan {
 
+// Mixture steps time one step of each kernel in this many, since reading
+// the clock every step would cost about as much as a flip step.
+static const uint64_t kKernelTimingInterval = 16;
+
+// Kernel weights adapt once every this many mixture steps of burn-in.
+static const uint64_t kKernelAdaptInterval = 1024;
+
+// The share of the total kernel weight that adaptation spreads evenly over
+// the weighted kernels, so that none stops being measured.
+static const double kMinKernelShare = 0.1;
+
+// Returns the CPU time used by the calling thread, in seconds. Chains of an
+// ensemble share the machine, so wall time would charge a kernel for the
+// time its thread spent descheduled.
+static double ThreadSeconds() {
+  struct timespec now;
+
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+  return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
 //////////////////////////////////////////////////////////////////////////////
 // Construction / Initialization
 //////////////////////////////////////////////////////////////////////////////
 
+Runner::~Runner() {
+  delete tabu_pool_;
+}
+
 uint16_t Runner::SetDistricts(unordered_map<uint32_t, uint32_t> *map) {
   for (int i = 0; i < graph_->num_nodes_; i++) {
     graph_->nodes_[i]->district_ = (*map)[graph_->nodes_[i]->id_];
@@ -36,107 +60,494 @@ uint16_t Runner::SetDistricts(unordered_map<uint32_t, uint32_t> *map) {
   return SUCCESS;
 }
 
-uint16_t Runner::SeedDistricts() {
-  uint32_t i;
-  int32_t prev_random_index, random_index;
-  vector<uint32_t> random_indexes;
-  unordered_set<Node *> unused, seed_nodes;
-  unordered_map<int, Node *> last_found;
-  Node *found_node, *seed_node;
+uint16_t Runner::SetDistricts(const uint32_t *districts) {
+  uint32_t node, old_district;
 
-  for (i = 0; i < graph_->num_nodes_; i++) {
-    unused.insert(graph_->nodes_[i]);
+  // AdoptGraphData sizes the scratch space once the graph is populated.
+  if (graph_->adj_offsets_ == nullptr ||
+      queue_.size() != graph_->num_nodes_) {
+    return POPULATE_FAILED;
+  }
+  for (node = 0; node < graph_->num_nodes_; node++) {
+    if (districts[node] >= graph_->num_districts_) {
+      return LOAD_FAILED;
+    }
   }
 
-  for (i = 0; i < graph_->num_districts_; i++) {
-    random_index = rand() % graph_->num_nodes_;
-    if (std::find(random_indexes.begin(),
-                  random_indexes.end(),
-                  random_index) == random_indexes.end()) {
-      seed_node = graph_->nodes_[random_index];
-      seed_node->SetDistrict(i);
-      seed_nodes.insert(seed_node);
-      random_indexes.push_back(random_index);
-      changes_->insert({seed_node->id_, i});
-    } else {
-      i--;
+  ClearChanges();
+  moved_.clear();
+  for (node = 0; node < graph_->num_nodes_; node++) {
+    old_district = graph_->district_of_node_[node];
+    if (districts[node] == old_district) {
+      continue;
     }
+    graph_->RemoveNodeFromDistrict(graph_->nodes_[node], old_district);
+    graph_->AddNodeToDistrict(graph_->nodes_[node], districts[node]);
+    RecordChange(node);
+    Journal(node, old_district);
+    moved_.push_back(node);
   }
 
-  for (auto &node : seed_nodes) {
-    unused.erase(node);
-    last_found[node->district_] = node;
+  // The sampler is only consistent once every node has moved.
+  for (auto &id : moved_) {
+    sampler_.UpdateMove(id);
   }
 
-  while (unused.size() > 0) {
-    uint32_t check = unused.size();
-    for (int i = 0; i < graph_->num_districts_; i++) {
-      found_node = BFS(last_found[i], &unused);
-      if (found_node != nullptr) {
-        found_node->SetDistrict(i);
-        unused.erase(found_node);
-        last_found[i] = found_node;
-        changes_->insert({found_node->id_, i});
+  LogScore();
+  return SUCCESS;
+}
+
+uint16_t Runner::SeedDistricts() {
+  uint32_t node;
+  vector<uint32_t> labels;
+
+  if (graph_->num_districts_ == 0 ||
+      graph_->num_districts_ > graph_->num_nodes_) {
+    return SEED_FAILED;
+  }
+
+  graph_->BuildAdjacency();
+
+  if (!GrowPlan(&rng_, &labels, nullptr, 0)) {
+    return SEED_FAILED;
+  }
+
+  for (node = 0; node < graph_->num_nodes_; node++) {
+    graph_->nodes_[node]->SetDistrict(labels[node]);
+    RecordChange(node);
+  }
+
+  return SUCCESS;
+}
+
+uint16_t Runner::SeedBalancedDistricts(uint32_t max_attempts,
+                                       uint32_t num_threads) {
+  return SeedAttempts(kSplitSeeds, max_attempts, num_threads, nullptr,
+                      nullptr);
+}
+
+uint16_t Runner::SeedAttempts(
+    SeedMethod method, uint32_t num_attempts, uint32_t num_threads,
+    const std::function<double(const vector<uint32_t> &)> &score,
+    SeedStats *stats) {
+  uint32_t num_nodes = graph_->num_nodes_, block, node, p, head = 0;
+  uint32_t winner;
+  uint64_t seed = rng_.Next();
+  std::atomic<uint32_t> first_accepted(num_attempts);
+  std::atomic<uint32_t> num_started(0), num_accepted(0), num_rejected(0);
+  auto start = std::chrono::steady_clock::now();
+  vector<uint32_t> queue;
+  vector<bool> seen(num_nodes, false);
+  SeedStats unused;
+
+  if (stats == nullptr) {
+    stats = &unused;
+  }
+  stats->num_started = 0;
+  stats->num_accepted = 0;
+  stats->num_rejected = 0;
+  stats->num_cancelled = num_attempts;
+  stats->winner = num_attempts;
+  stats->score = 0;
+  stats->seconds = 0;
+
+  if (graph_->num_districts_ == 0 || graph_->num_districts_ > num_nodes) {
+    return SEED_FAILED;
+  }
+
+  graph_->BuildAdjacency();
+
+  // No attempt can cover a disconnected graph, and spanning trees do not
+  // exist on one.
+  queue.push_back(0);
+  seen[0] = true;
+  while (head < queue.size()) {
+    node = queue[head++];
+    for (p = graph_->adj_offsets_[node]; p < graph_->adj_offsets_[node + 1];
+         p++) {
+      if (!seen[graph_->adj_[p]]) {
+        seen[graph_->adj_[p]] = true;
+        queue.push_back(graph_->adj_[p]);
+      }
+    }
+  }
+  if (queue.size() < num_nodes) {
+    return SEED_FAILED;
+  }
+
+  // Attempts are dealt to a fixed block per thread in increasing order, so
+  // each block's first acceptable attempt is its lowest.
+  ThreadPool pool(num_threads);
+  uint32_t num_blocks = pool.GetNumThreads();
+  vector<SpanningTree> trees(num_blocks);
+  vector<vector<uint32_t> > labels(num_blocks), kept(num_blocks);
+  vector<uint32_t> kept_attempt(num_blocks, num_attempts);
+  vector<double> kept_score(num_blocks, 0);
+  const std::atomic<uint32_t> *cancel = score ? nullptr : &first_accepted;
+
+  auto run_block = [&](uint32_t block) {
+    uint32_t attempt, current;
+    double value;
+    bool accepted;
+    Rng rng;
+
+    for (attempt = block; attempt < num_attempts; attempt += num_blocks) {
+      if (cancel != nullptr && *cancel < attempt) {
+        break;
+      }
+      num_started++;
+      rng.SeedStream(seed, attempt);
+      if (method == kGrowSeeds) {
+        accepted = GrowPlan(&rng, &labels[block], cancel, attempt) &&
+                   IsBalanced(labels[block]);
+      } else {
+        accepted = SplitPlan(&rng, &trees[block], &labels[block], cancel,
+                             attempt);
+      }
+      if (!accepted) {
+        if (cancel == nullptr || *cancel > attempt) {
+          num_rejected++;
+        }
+        continue;
+      }
+      num_accepted++;
+
+      if (!score) {
+        kept[block].swap(labels[block]);
+        kept_attempt[block] = attempt;
+        current = first_accepted;
+        while (attempt < current &&
+               !first_accepted.compare_exchange_weak(current, attempt)) {}
+        break;
+      }
+      value = score(labels[block]);
+      if (kept_attempt[block] == num_attempts || value < kept_score[block]) {
+        kept[block].swap(labels[block]);
+        kept_attempt[block] = attempt;
+        kept_score[block] = value;
       }
     }
-    if (unused.size() == check) {
-      return SEED_FAILED;
+  };
+  pool.ParallelFor(num_blocks, run_block);
+
+  // The lowest acceptable attempt, or the lowest of the best scoring.
+  winner = num_blocks;
+  for (block = 0; block < num_blocks; block++) {
+    if (kept_attempt[block] == num_attempts) {
+      continue;
     }
+    if (winner == num_blocks ||
+        (score && kept_score[block] < kept_score[winner]) ||
+        ((!score || kept_score[block] == kept_score[winner]) &&
+         kept_attempt[block] < kept_attempt[winner])) {
+      winner = block;
+    }
+  }
+
+  stats->num_started = num_started;
+  stats->num_accepted = num_accepted;
+  stats->num_rejected = num_rejected;
+  stats->num_cancelled = num_attempts - num_accepted - num_rejected;
+  stats->seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+  if (winner == num_blocks) {
+    return SEED_FAILED;
+  }
+  stats->winner = kept_attempt[winner];
+  stats->score = kept_score[winner];
+
+  for (node = 0; node < num_nodes; node++) {
+    graph_->nodes_[node]->SetDistrict(kept[winner][node]);
+    RecordChange(node);
   }
 
   return SUCCESS;
 }
 
+uint16_t Runner::SeedMultilevelDistricts() {
+  uint32_t node, num_nodes = graph_->num_nodes_;
+  uint16_t result;
+
+  if (graph_->num_districts_ == 0 || graph_->num_districts_ > num_nodes) {
+    return SEED_FAILED;
+  }
+
+  graph_->BuildAdjacency();
+
+  Multilevel partitioner(graph_);
+  partitioner.SetSeed(rng_.Next());
+  result = partitioner.Partition(graph_->num_districts_, pop_tolerance_);
+  if (partitioner.GetNumLevels() == 0) {
+    return result;
+  }
+
+  for (node = 0; node < num_nodes; node++) {
+    graph_->nodes_[node]->SetDistrict(partitioner.GetDistrict(node));
+    RecordChange(node);
+  }
+
+  return result;
+}
+
 uint16_t Runner::PopulateGraphData() {
-  unordered_map<int, unordered_set<uint32_t> *> *map;
-  Node *current_node, *neighbor_node;
-  uint32_t i, current_district;
+  return PopulateGraphData(1);
+}
+
+uint16_t Runner::PopulateGraphData(uint32_t num_threads) {
+  uint32_t i;
+  vector<uint32_t> districts(graph_->num_nodes_);
+  ThreadPool pool(num_threads);
+
+  graph_->BuildAdjacency();
 
   for (i = 0; i < graph_->num_nodes_; i++) {
-    current_node = graph_->nodes_[i];
-    current_district = current_node->district_;
-    graph_->AddNodeToDistrict(current_node, current_district);
-
-    for (auto &neighbor_id : *current_node->neighbors_) {
-      neighbor_node = graph_->nodes_[neighbor_id];
-      if (neighbor_node->district_ != current_district) {
-        if (std::find(graph_->perim_edges_->begin(),
-                      graph_->perim_edges_->end(),
-                      std::make_pair<int, int>(neighbor_id, i))
-                      == graph_->perim_edges_->end()) {
-          graph_->perim_edges_->push_back({i, neighbor_id});
-        }
-        graph_->nodes_on_perim_[current_district]->insert(i);
+    districts[i] = graph_->nodes_[i]->district_;
+  }
+  if (!graph_->AssignDistricts(districts.data(), &pool)) {
+    return POPULATE_FAILED;
+  }
+
+  if (AdoptGraphData() != SUCCESS) {
+    return POPULATE_FAILED;
+  }
+  LogScore();
+  return SUCCESS;
+}
+
+uint16_t Runner::AdoptGraphData() {
+  if (graph_->adj_offsets_ == nullptr) {
+    return POPULATE_FAILED;
+  }
+
+  // Size all scratch space up front so that walking never allocates.
+  queue_.resize(graph_->num_nodes_);
+  visited_.assign(graph_->num_nodes_, 0);
+  targets_.assign(graph_->num_nodes_, 0);
+  visit_stamp_ = 0;
+  changes_.reserve(graph_->num_nodes_);
+  is_changed_.resize(graph_->num_nodes_, false);
+  tree_.Reserve(graph_);
+  region_.reserve(graph_->num_nodes_);
+  subtree_.reserve(graph_->num_nodes_);
+  moved_.reserve(graph_->num_nodes_);
+  block_.reserve(graph_->num_nodes_);
+  ball_.reserve(graph_->num_nodes_);
+  in_block_.assign(graph_->num_nodes_, false);
+  tabu_moves_.reserve(graph_->adj_offsets_[graph_->num_nodes_]);
+  tabu_order_.reserve(graph_->adj_offsets_[graph_->num_nodes_]);
+  tabu_until_.assign(graph_->num_nodes_, 0);
+  tabu_iteration_ = 0;
+  tabu_best_score_ = HUGE_VAL;
+  journal_nodes_.reserve(graph_->num_nodes_);
+  journal_districts_.reserve(graph_->num_nodes_);
+  best_plan_.resize(graph_->num_nodes_);
+  lower_grows_.assign(graph_->num_districts_ * graph_->num_districts_, true);
+
+  sampler_.Build(graph_);
+
+  return SUCCESS;
+}
+
+uint16_t Runner::RepairPopulation() {
+  uint32_t k = graph_->num_districts_, none = graph_->num_nodes_;
+  uint32_t round, stalls = 0, i, d, node, p, target, worst, head;
+  double ideal_pop, lower, upper, violation, last_violation, excess, amount;
+  vector<uint32_t> parent(k), order, path;
+  vector<bool> blocked(k, false);
+
+  if (pop_tolerance_ <= 0) {
+    return SUCCESS;
+  }
+  ideal_pop = ((double) graph_->state_pop_) / k;
+  lower = ideal_pop * (1 - pop_tolerance_);
+  upper = ideal_pop * (1 + pop_tolerance_);
+  order.reserve(k);
+  path.reserve(k);
+  ClearChanges();
+
+  // Every round that makes no progress blocks the district it served, so
+  // the loop ends after at most k rounds in a row without progress. Every
+  // other round strictly lowers the total violation, which takes one of
+  // finitely many values.
+  last_violation = HUGE_VAL;
+  for (round = 0; stalls < k; round++) {
+    violation = 0;
+    worst = k;
+    for (d = 0; d < k; d++) {
+      excess = fmax(graph_->pop_of_district_[d] - upper,
+                    lower - graph_->pop_of_district_[d]);
+      if (excess <= 0) {
+        continue;
+      }
+      violation += excess;
+      if (!blocked[d] && (worst == k || excess > fmax(
+              graph_->pop_of_district_[worst] - upper,
+              lower - graph_->pop_of_district_[worst]))) {
+        worst = d;
+      }
+    }
+    if (violation == 0) {
+      break;
+    }
+    if (violation < last_violation) {
+      stalls = 0;
+      std::fill(blocked.begin(), blocked.end(), false);
+    } else if (round > 0) {
+      stalls++;
+    }
+    last_violation = violation;
+    if (worst == k) {
+      break;
+    }
 
-        map = graph_->perim_nodes_to_neighbors_[current_district];
-        if (map->find(i) == map->end()) {
-          (*map)[i] = new unordered_set<uint32_t>;
+    // Breadth-first search over the district adjacency graph for the
+    // nearest district on the other side of the ideal.
+    order.clear();
+    order.push_back(worst);
+    std::fill(parent.begin(), parent.end(), k);
+    parent[worst] = worst;
+    target = k;
+    for (head = 0; head < order.size() && target == k; head++) {
+      d = order[head];
+      for (node = graph_->first_on_perim_[d]; node != none && target == k;
+           node = graph_->next_on_perim_[node]) {
+        for (p = graph_->adj_offsets_[node];
+             p < graph_->adj_offsets_[node + 1] && target == k; p++) {
+          i = graph_->district_of_node_[graph_->adj_[p]];
+          if (parent[i] != k) {
+            continue;
+          }
+          parent[i] = d;
+          order.push_back(i);
+          if (graph_->pop_of_district_[worst] > upper
+                  ? graph_->pop_of_district_[i] < ideal_pop
+                  : graph_->pop_of_district_[i] > ideal_pop) {
+            target = i;
+          }
         }
-        (*map)[i]->insert(neighbor_id);
       }
     }
+    if (target == k) {
+      blocked[worst] = true;
+      continue;
+    }
+
+    // Relay population along the path, so that surplus passes through
+    // districts already at the ideal. Each hop passes on what arrived,
+    // and the far end is kept within the tolerance.
+    path.clear();
+    for (d = target; d != worst; d = parent[d]) {
+      path.push_back(d);
+    }
+    path.push_back(worst);
+    if (graph_->pop_of_district_[worst] > upper) {
+      std::reverse(path.begin(), path.end());
+      amount = fmin(graph_->pop_of_district_[worst] - ideal_pop,
+                    upper - graph_->pop_of_district_[target]);
+    } else {
+      amount = fmin(ideal_pop - graph_->pop_of_district_[worst],
+                    graph_->pop_of_district_[target] - lower);
+    }
+    for (i = 0; i + 1 < path.size() && amount > 0; i++) {
+      amount = TransferPopulation(path[i], path[i + 1], amount);
+    }
+    if (amount <= 0) {
+      blocked[worst] = true;
+    }
+  }
+
+  LogScore();
+  for (d = 0; d < k; d++) {
+    if (graph_->pop_of_district_[d] < lower ||
+        graph_->pop_of_district_[d] > upper) {
+      return REPAIR_FAILED;
+    }
   }
 
   return SUCCESS;
 }
 
+double Runner::TransferPopulation(uint32_t from, uint32_t to, double amount) {
+  uint32_t node, p, neighbor, pop, head;
+  double moved = 0;
+
+  // Peel the district from its border with the other, using subtree_ as
+  // the queue and in_block_ to mark queued nodes.
+  subtree_.clear();
+  for (node = graph_->first_on_perim_[from]; node != graph_->num_nodes_;
+       node = graph_->next_on_perim_[node]) {
+    for (p = graph_->adj_offsets_[node]; p < graph_->adj_offsets_[node + 1];
+         p++) {
+      if (graph_->district_of_node_[graph_->adj_[p]] == to) {
+        subtree_.push_back(node);
+        in_block_[node] = true;
+        break;
+      }
+    }
+  }
+
+  for (head = 0; head < subtree_.size() && moved < amount; head++) {
+    node = subtree_[head];
+    pop = graph_->pop_of_node_[node];
+
+    // Skip nodes that would overshoot by more than they close.
+    if (moved + pop - amount >= amount - moved || IsEmptyDistrict(from) ||
+        IsDistrictSevered(graph_->nodes_[node])) {
+      continue;
+    }
+
+    Relabel(node, to);
+    RecordChange(node);
+    Journal(node, from);
+    moved += pop;
+
+    for (p = graph_->adj_offsets_[node]; p < graph_->adj_offsets_[node + 1];
+         p++) {
+      neighbor = graph_->adj_[p];
+      if (!in_block_[neighbor] &&
+          graph_->district_of_node_[neighbor] == from) {
+        subtree_.push_back(neighbor);
+        in_block_[neighbor] = true;
+      }
+    }
+  }
+
+  for (auto &id : subtree_) {
+    in_block_[id] = false;
+  }
+  return moved;
+}
+
+void Runner::CopySettings(const Runner &other) {
+  engine_ = other.engine_;
+  alpha_ = other.alpha_;
+  beta_ = other.beta_;
+  gamma_ = other.gamma_;
+  eta_ = other.eta_;
+  inverse_temp_ = other.inverse_temp_;
+  pop_tolerance_ = other.pop_tolerance_;
+  pre_draw_ = other.pre_draw_;
+  max_block_size_ = other.max_block_size_;
+  tabu_tenure_ = other.tabu_tenure_;
+  std::copy(other.kernel_weights_, other.kernel_weights_ + kNumEngines,
+            kernel_weights_);
+  burn_in_ = other.burn_in_;
+}
+
 
 //////////////////////////////////////////////////////////////////////////////
 // Scoring
 //////////////////////////////////////////////////////////////////////////////
 
 double Runner::ScoreCompactness() {
-  unordered_map<int, unordered_set<int>> perim_nodes_to_neighbors;
-  uint32_t i, num_foreign_neighbors = 0;
-  double current_score = 0, sum = 0;
+  uint32_t i, size;
+  double sum = 0;
 
   for (i = 0; i < graph_->num_districts_; i++) {
-    for (auto &pair : *graph_->perim_nodes_to_neighbors_[i]) {
-      num_foreign_neighbors += pair.second->size();
+    size = graph_->size_of_district_[i];
+    if (size > 0) {
+      sum += pow(graph_->cut_edges_of_district_[i], 2) / size;
     }
-    current_score = pow(num_foreign_neighbors, 2) /
-                    graph_->nodes_in_district_[i]->size();
-    sum += current_score;
   }
 
   compactness_score_ = sum;
@@ -151,7 +562,7 @@ double Runner::ScorePopulationDistribution() {
   avg_pop = total_pop / graph_->num_districts_;
 
   for (i = 0; i < graph_->num_districts_; i++) {
-    sum += pow((graph_->pop_of_district_[i] - avg_pop), 1);
+    sum += fabs((double) graph_->pop_of_district_[i] - avg_pop);
   }
 
   distribution_score_ = sum / graph_->num_districts_;
@@ -168,6 +579,9 @@ double Runner::ScoreVRA() {
   double sum = 0, min_pop_percentage;
 
   for (i = 0; i < graph_->num_districts_; i++) {
+    if (graph_->GetDistrictPop(i) <= 0) {
+      continue;
+    }
     min_pop_percentage = ((double) graph_->GetMinorityPop(i)) /
                           ((double)graph_->GetDistrictPop(i));
     if ((0.5 - min_pop_percentage) > 0) {
@@ -187,163 +601,744 @@ double Runner::LogScore() {
   return score_;
 }
 
+double Runner::ScoreProposal(Node *node, uint32_t new_district) {
+  return LogScore() + ScoreDelta(node, new_district);
+}
+
+double Runner::ScoreDelta(Node *node, uint32_t new_district) {
+  uint32_t id = node->id_, old_district = graph_->district_of_node_[id];
+  int64_t old_cut, new_cut;
+  uint32_t p, old_size, new_size, pop, min_pop, neighbor_district;
+  double score = 0;
+
+  if (new_district == old_district) {
+    return score;
+  }
+
+  old_cut = graph_->cut_edges_of_district_[old_district];
+  new_cut = graph_->cut_edges_of_district_[new_district];
+  for (p = graph_->adj_offsets_[id]; p < graph_->adj_offsets_[id + 1]; p++) {
+    neighbor_district = graph_->LoadDistrict(graph_->adj_[p]);
+    if (neighbor_district == old_district) {
+      old_cut++;
+      new_cut++;
+    } else if (neighbor_district == new_district) {
+      old_cut--;
+      new_cut--;
+    } else {
+      old_cut--;
+      new_cut++;
+    }
+  }
+
+  old_size = graph_->size_of_district_[old_district];
+  new_size = graph_->size_of_district_[new_district];
+  pop = graph_->pop_of_node_[id];
+  min_pop = graph_->min_pop_of_node_[id];
+
+  score -= DistrictScore(graph_->cut_edges_of_district_[old_district],
+                         old_size,
+                         graph_->pop_of_district_[old_district],
+                         graph_->min_pop_of_district_[old_district]);
+  score -= DistrictScore(graph_->cut_edges_of_district_[new_district],
+                         new_size,
+                         graph_->pop_of_district_[new_district],
+                         graph_->min_pop_of_district_[new_district]);
+  score += DistrictScore(old_cut, old_size - 1,
+                         graph_->pop_of_district_[old_district] - pop,
+                         graph_->min_pop_of_district_[old_district] - min_pop);
+  score += DistrictScore(new_cut, new_size + 1,
+                         graph_->pop_of_district_[new_district] + pop,
+                         graph_->min_pop_of_district_[new_district] + min_pop);
+
+  return score;
+}
+
+double Runner::DistrictScore(uint32_t cut_edges, uint32_t size,
+                             uint32_t pop, uint32_t min_pop) {
+  double compactness = 0, distribution, vra = 0, min_pop_percentage;
+  uint32_t avg_pop = graph_->state_pop_ / graph_->num_districts_;
+
+  if (size > 0) {
+    compactness = pow(cut_edges, 2) / size;
+  }
+
+  distribution = fabs((double) pop - avg_pop) / graph_->num_districts_;
+
+  if (pop > 0) {
+    min_pop_percentage = ((double) min_pop) / ((double) pop);
+    if ((0.5 - min_pop_percentage) > 0) {
+      vra = min_pop_percentage;
+    }
+  }
+
+  return alpha_ * compactness + beta_ * distribution + eta_ * vra;
+}
+
+double Runner::AcceptanceProbability(double old_score, double new_score,
+                                     double forward_prob,
+                                     double reverse_prob) {
+  if (forward_prob <= 0) {
+    return 0;
+  }
+  return fmin(1, exp(inverse_temp_ * (old_score - new_score)) *
+                 reverse_prob / forward_prob);
+}
+
 
 //////////////////////////////////////////////////////////////////////////////
 // Algorithms
 //////////////////////////////////////////////////////////////////////////////
 
 double Runner::MetropolisHastings() {
-  double old_score, new_score, ratio;
-  uint32_t random_index, random_number, old_district, new_district;
-  std::pair<int, int> edge;
+  double old_score, new_score, acceptance;
+  uint32_t old_district, new_district, node_id;
   Node *node;
-  bool is_valid = false, accepted = false;
-
-  // random number generators initialization
-  unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
-  std::default_random_engine generator(seed);
-  uniform_real_distribution<double> index(0, graph_->perim_edges_->size());
-  uniform_real_distribution<double> number(0, graph_->perim_edges_->size());
-  uniform_real_distribution<double> decimal_number(0, 1);
-
-  while (!is_valid) {
-    random_index = floor(index(generator));
-    edge.first = (*graph_->perim_edges_)[random_index].first;
-    edge.second = (*graph_->perim_edges_)[random_index].second;
-
-    random_number = floor(number(generator));
-    if (random_number > graph_->perim_edges_->size() / 2) {
-      node = graph_->nodes_[edge.first];
-      new_district = graph_->nodes_[edge.second]->district_;
-    } else {
-      node = graph_->nodes_[edge.second];
-      new_district = graph_->nodes_[edge.first]->district_;
+
+  num_steps_++;
+  old_score = LogScore();
+
+  if (!sampler_.Sample(rng_.Uniform(), &node_id, &new_district)) {
+    return 0;
+  }
+  node = graph_->nodes_[node_id];
+  old_district = graph_->district_of_node_[node_id];
+
+  // Filter pipeline, cheapest stage first. Every stage rejects the step
+  // rather than redrawing, so the kernel stays a proper Metropolis-Hastings
+  // kernel over valid plans.
+  if (old_district == new_district) {
+    rejections_[kLabelFilter]++;
+    return 0;
+  }
+
+  if (IsEmptyDistrict(old_district)) {
+    rejections_[kEmptyFilter]++;
+    return 0;
+  }
+
+  if (!IsWithinPopulationTolerance(node, new_district)) {
+    rejections_[kPopulationFilter]++;
+    return 0;
+  }
+
+  new_score = ScoreProposal(node, new_district);
+  acceptance = AcceptanceProbability(
+      old_score, new_score,
+      sampler_.Probability(node_id, new_district),
+      sampler_.ReverseProbability(node_id, new_district));
+
+  // The acceptance test does not depend on contiguity, so drawing it
+  // first lets moves that would be rejected anyway skip the traversal.
+  if (pre_draw_ && rng_.Uniform() > acceptance) {
+    rejections_[kAcceptanceFilter]++;
+    return 0;
+  }
+
+  if (IsDistrictSevered(node)) {
+    rejections_[kContiguityFilter]++;
+    return 0;
+  }
+
+  if (!pre_draw_ && rng_.Uniform() > acceptance) {
+    rejections_[kAcceptanceFilter]++;
+    return 0;
+  }
+
+  score_ = Redistrict(node, new_district);
+  num_accepted_++;
+
+  return old_score - score_;
+}
+
+double Runner::LiftedMetropolisHastings() {
+  double old_score, new_score, forward, reverse, acceptance;
+  uint32_t node_id, target, pair, mover, old_district, new_district;
+  uint32_t p, count = 0, pick;
+
+  num_steps_++;
+  old_score = LogScore();
+
+  if (!sampler_.Sample(rng_.Uniform(), &node_id, &target)) {
+    return 0;
+  }
+  old_district = graph_->district_of_node_[node_id];
+  if (old_district == target) {
+    rejections_[kLabelFilter]++;
+    return 0;
+  }
+  pair = PairIndex(old_district, target);
+
+  // Move along the pair's direction: either the node joins the target, or
+  // one of its neighbors in the target joins the node's district.
+  mover = node_id;
+  new_district = target;
+  if (lower_grows_[pair] != (target < old_district)) {
+    for (p = graph_->adj_offsets_[node_id];
+         p < graph_->adj_offsets_[node_id + 1]; p++) {
+      count += graph_->district_of_node_[graph_->adj_[p]] == target;
+    }
+    pick = rng_.UniformInt(count);
+    for (p = graph_->adj_offsets_[node_id];; p++) {
+      if (graph_->district_of_node_[graph_->adj_[p]] == target &&
+          pick-- == 0) {
+        break;
+      }
     }
+    mover = graph_->adj_[p];
+    new_district = old_district;
+    old_district = target;
+  }
 
-    old_district = node->district_;
-    is_valid = !IsEmptyDistrict(old_district) && !IsDistrictSevered(node);
-    is_valid &= (graph_->nodes_[edge.first]->district_ !=
-                 graph_->nodes_[edge.second]->district_);
-    is_valid &= (edge.first != edge.second);
+  // Every rejection below reverses the pair's direction.
+  if (IsEmptyDistrict(old_district)) {
+    rejections_[kEmptyFilter]++;
+    lower_grows_[pair] = !lower_grows_[pair];
+    return 0;
   }
 
+  if (!IsWithinPopulationTolerance(graph_->nodes_[mover], new_district)) {
+    rejections_[kPopulationFilter]++;
+    lower_grows_[pair] = !lower_grows_[pair];
+    return 0;
+  }
+
+  if (IsDistrictSevered(graph_->nodes_[mover])) {
+    rejections_[kContiguityFilter]++;
+    lower_grows_[pair] = !lower_grows_[pair];
+    return 0;
+  }
+
+  // The reverse proposal depends on the sampler after the move, so the
+  // move is made first and undone if rejected.
+  new_score = ScoreProposal(graph_->nodes_[mover], new_district);
+  forward = LiftedProbability(mover, new_district);
+  Relabel(mover, new_district);
+  reverse = LiftedProbability(mover, old_district);
+
+  acceptance = AcceptanceProbability(old_score, new_score, forward, reverse);
+  if (rng_.Uniform() > acceptance) {
+    Relabel(mover, old_district);
+    rejections_[kAcceptanceFilter]++;
+    lower_grows_[pair] = !lower_grows_[pair];
+    return 0;
+  }
+
+  RecordChange(mover);
+  Journal(mover, old_district);
+  num_accepted_++;
+  score_ = LogScore();
+
+  return old_score - score_;
+}
+
+double Runner::BlockMetropolisHastings() {
+  double old_score, new_score, forward, reverse, acceptance;
+  uint32_t node_id, old_district, new_district, size, pop = 0;
+  uint32_t old_cut, new_cut, old_pop, new_pop, old_min_pop, new_min_pop;
+  uint32_t old_size, new_size;
+
+  num_steps_++;
   old_score = LogScore();
-  new_score = Redistrict(node, new_district);
 
-  if (new_score > old_score) {
-    ratio = decimal_number(generator);
-    if (ratio <= (old_score / new_score)) {
-      Redistrict(node, old_district);
-      score_ = old_score;
-    } else {
-      score_ = new_score;
-      accepted = true;
+  if (!sampler_.Sample(rng_.Uniform(), &node_id, &new_district)) {
+    return 0;
+  }
+  old_district = graph_->district_of_node_[node_id];
+  if (old_district == new_district) {
+    rejections_[kLabelFilter]++;
+    return 0;
+  }
+
+  size = 1 + rng_.UniformInt(max_block_size_);
+  GrowBall(node_id, size, &block_);
+  if (block_.size() < size ||
+      size >= graph_->size_of_district_[old_district]) {
+    rejections_[kEmptyFilter]++;
+    return 0;
+  }
+
+  for (auto &id : block_) {
+    pop += graph_->pop_of_node_[id];
+  }
+  if (!IsWithinPopulationTolerance(old_district, new_district, pop)) {
+    rejections_[kPopulationFilter]++;
+    return 0;
+  }
+
+  // The reverse proposal and the contiguity check depend on the plan after
+  // the move, so the block is moved first and moved back if rejected.
+  forward = BlockProbability(new_district);
+  old_cut = graph_->cut_edges_of_district_[old_district];
+  new_cut = graph_->cut_edges_of_district_[new_district];
+  old_pop = graph_->pop_of_district_[old_district];
+  new_pop = graph_->pop_of_district_[new_district];
+  old_min_pop = graph_->min_pop_of_district_[old_district];
+  new_min_pop = graph_->min_pop_of_district_[new_district];
+  old_size = graph_->size_of_district_[old_district];
+  new_size = graph_->size_of_district_[new_district];
+  MoveBlock(new_district);
+
+  if (IsSeveredByBlock(old_district)) {
+    MoveBlock(old_district);
+    rejections_[kContiguityFilter]++;
+    return 0;
+  }
+
+  new_score = old_score
+      - DistrictScore(old_cut, old_size, old_pop, old_min_pop)
+      - DistrictScore(new_cut, new_size, new_pop, new_min_pop)
+      + DistrictScore(graph_->cut_edges_of_district_[old_district],
+                      graph_->size_of_district_[old_district],
+                      graph_->pop_of_district_[old_district],
+                      graph_->min_pop_of_district_[old_district])
+      + DistrictScore(graph_->cut_edges_of_district_[new_district],
+                      graph_->size_of_district_[new_district],
+                      graph_->pop_of_district_[new_district],
+                      graph_->min_pop_of_district_[new_district]);
+  reverse = BlockProbability(old_district);
+
+  acceptance = AcceptanceProbability(old_score, new_score, forward, reverse);
+  if (rng_.Uniform() > acceptance) {
+    MoveBlock(old_district);
+    rejections_[kAcceptanceFilter]++;
+    return 0;
+  }
+
+  for (auto &id : block_) {
+    RecordChange(id);
+  }
+  JournalBlock(old_district);
+  num_accepted_++;
+  score_ = LogScore();
+
+  return old_score - score_;
+}
+
+double Runner::TabuSearch() {
+  double old_score;
+  uint32_t district, node, p, q, neighbor_district, num_blocks;
+  bool first;
+
+  num_steps_++;
+  tabu_iteration_++;
+  old_score = LogScore();
+  if (old_score < tabu_best_score_) {
+    tabu_best_score_ = old_score;
+  }
+
+  // Every boundary move once, as the sampler counts them: a node and the
+  // district of its first neighbor, in adjacency order, in that district.
+  tabu_moves_.clear();
+  for (district = 0; district < graph_->num_districts_; district++) {
+    for (node = graph_->first_on_perim_[district]; node != graph_->num_nodes_;
+         node = graph_->next_on_perim_[node]) {
+      for (p = graph_->adj_offsets_[node]; p < graph_->adj_offsets_[node + 1];
+           p++) {
+        neighbor_district = graph_->district_of_node_[graph_->adj_[p]];
+        first = neighbor_district != district;
+        for (q = graph_->adj_offsets_[node]; q < p && first; q++) {
+          first = graph_->district_of_node_[graph_->adj_[q]] !=
+                  neighbor_district;
+        }
+        if (first) {
+          tabu_moves_.push_back({node, neighbor_district, 0, false});
+        }
+      }
+    }
+  }
+  if (tabu_moves_.empty()) {
+    return 0;
+  }
+
+  // Scoring only reads the plan, so the moves are split into fixed blocks
+  // scored concurrently.
+  num_blocks = tabu_pool_ == nullptr ? 1 : tabu_pool_->GetNumThreads();
+  std::function<void(uint32_t)> score_block = [this, num_blocks](uint32_t b) {
+    uint32_t begin = (uint64_t) tabu_moves_.size() * b / num_blocks;
+    uint32_t end = (uint64_t) tabu_moves_.size() * (b + 1) / num_blocks;
+    for (uint32_t i = begin; i < end; i++) {
+      TabuMove &move = tabu_moves_[i];
+      Node *moved = graph_->nodes_[move.node];
+      move.allowed = !IsEmptyDistrict(graph_->district_of_node_[move.node]) &&
+                     IsWithinPopulationTolerance(moved, move.district);
+      if (move.allowed) {
+        move.delta = ScoreDelta(moved, move.district);
+      }
     }
+  };
+  if (tabu_pool_ == nullptr) {
+    score_block(0);
   } else {
-    score_ = new_score;
-    accepted = true;
+    tabu_pool_->ParallelFor(num_blocks, score_block);
   }
-  
-  (*changes_)[node->id_] = node->district_;
-  num_steps_++;
 
-  return old_score - new_score;
+  tabu_order_.clear();
+  for (p = 0; p < tabu_moves_.size(); p++) {
+    if (tabu_moves_[p].allowed) {
+      tabu_order_.push_back(p);
+    }
+  }
+  std::sort(tabu_order_.begin(), tabu_order_.end(),
+            [this](uint32_t a, uint32_t b) {
+              return tabu_moves_[a].delta < tabu_moves_[b].delta ||
+                     (tabu_moves_[a].delta == tabu_moves_[b].delta && a < b);
+            });
+
+  // Contiguity is checked serially, best move first, until one passes.
+  for (auto &index : tabu_order_) {
+    const TabuMove &move = tabu_moves_[index];
+    if (tabu_until_[move.node] >= tabu_iteration_ &&
+        old_score + move.delta >= tabu_best_score_) {
+      continue;
+    }
+    if (IsDistrictSevered(graph_->nodes_[move.node])) {
+      continue;
+    }
+
+    score_ = Redistrict(graph_->nodes_[move.node], move.district);
+    tabu_until_[move.node] = tabu_iteration_ + tabu_tenure_;
+    if (score_ < tabu_best_score_) {
+      tabu_best_score_ = score_;
+    }
+    num_accepted_++;
+    return old_score - score_;
+  }
+
+  rejections_[kAcceptanceFilter]++;
+  return 0;
 }
 
-double Runner::Redistrict(Node *node, int new_district) {
-  int old_district = node->district_;
+double Runner::MixtureStep() {
+  double total = 0, u, decrease, start = 0;
+  uint64_t accepted = num_accepted_;
+  int kernel, last = kNumEngines;
+  bool timed;
 
-  graph_->RemoveNodeFromDistrict(node, old_district);
-  graph_->RemoveNodeFromDistrictPerim(node, old_district);
+  for (kernel = 0; kernel < kNumEngines; kernel++) {
+    if (kernel_weights_[kernel] > 0) {
+      total += kernel_weights_[kernel];
+      last = kernel;
+    }
+  }
+  if (last == kNumEngines) {
+    return MetropolisHastings();
+  }
 
-  vector<pair<int, int>>::iterator iter = graph_->perim_edges_->begin();
-  vector<pair<int, int>> *new_perim_edges = new vector<pair<int, int>>;
-  while (iter != graph_->perim_edges_->end()) {
-    pair<int, int> edge = *iter;
-    if (edge.first != node->id_ && edge.second != node->id_) {
-      new_perim_edges->push_back(edge);
+  u = rng_.Uniform() * total;
+  for (kernel = 0; kernel < last; kernel++) {
+    if (u < kernel_weights_[kernel]) {
+      break;
     }
-    iter++;
+    u -= kernel_weights_[kernel];
+  }
+  // Rounding can carry u past the last weight, or onto an unweighted one.
+  if (kernel_weights_[kernel] <= 0) {
+    kernel = last;
   }
-  delete graph_->perim_edges_;
-  graph_->perim_edges_ = new_perim_edges;
 
+  KernelStats &stats = kernel_stats_[kernel];
+  timed = stats.num_steps % kKernelTimingInterval == 0;
+  if (timed) {
+    start = ThreadSeconds();
+  }
+  decrease = StepEngine((Engine) kernel);
+  if (timed) {
+    stats.seconds += ThreadSeconds() - start;
+    kernel_timed_[kernel]++;
+  }
+  stats.num_steps++;
+  if (num_accepted_ != accepted) {
+    stats.num_accepted++;
+    // Rises count as much as falls: near the target the signed changes of
+    // every kernel sum to about zero, while their size measures how far
+    // the kernel carries the chain.
+    stats.score_change += fabs(decrease);
+  }
+
+  num_mixture_steps_++;
+  if (num_mixture_steps_ <= burn_in_ &&
+      num_mixture_steps_ % kKernelAdaptInterval == 0) {
+    AdaptKernelWeights();
+  }
+
+  return decrease;
+}
+
+double Runner::Redistrict(Node *node, int new_district) {
+  int old_district = graph_->district_of_node_[node->id_];
+
+  graph_->RemoveNodeFromDistrict(node, old_district);
   graph_->AddNodeToDistrict(node, new_district);
-  graph_->AddNodeToDistrictPerim(node, new_district);
+  sampler_.UpdateMove(node->id_);
+  RecordChange(node->id_);
+  Journal(node->id_, old_district);
+
+  return LogScore();
+}
 
-  for (auto &neighbor_id : *node->neighbors_) {
-    if (graph_->nodes_[neighbor_id]->district_ != new_district) {
-        graph_->perim_edges_->push_back({node->id_, neighbor_id});
+double Runner::ReCom() {
+  double old_score, new_score, ideal_pop, lower, upper;
+  uint32_t node_id, district_a, district_b, node, stamp, num_cuts;
+
+  num_steps_++;
+  old_score = LogScore();
+
+  // A boundary move names a pair of adjacent districts.
+  if (!sampler_.Sample(rng_.Uniform(), &node_id, &district_b)) {
+    return 0;
+  }
+  district_a = graph_->district_of_node_[node_id];
+
+  region_.clear();
+  for (node = graph_->first_in_district_[district_a];
+       node != graph_->num_nodes_; node = graph_->next_in_district_[node]) {
+    region_.push_back(node);
+  }
+  for (node = graph_->first_in_district_[district_b];
+       node != graph_->num_nodes_; node = graph_->next_in_district_[node]) {
+    region_.push_back(node);
+  }
+
+  tree_.Draw(graph_, region_, &rng_);
+
+  lower = 0;
+  upper = tree_.GetTotalPop();
+  if (pop_tolerance_ > 0) {
+    ideal_pop = ((double) graph_->state_pop_) / graph_->num_districts_;
+    lower = ideal_pop * (1 - pop_tolerance_);
+    upper = ideal_pop * (1 + pop_tolerance_);
+  }
+
+  num_cuts = tree_.FindBalancedCuts(lower, upper);
+  if (num_cuts == 0) {
+    rejections_[kCutFilter]++;
+    return 0;
+  }
+  tree_.GetSubtree(tree_.GetCut(rng_.UniformInt(num_cuts)), &subtree_);
+
+  // The subtree becomes district a and the rest of the region district b.
+  stamp = NextVisitStamp();
+  for (auto &id : subtree_) {
+    targets_[id] = stamp;
+  }
+  moved_.clear();
+  for (auto &id : region_) {
+    if ((targets_[id] == stamp) !=
+        (graph_->district_of_node_[id] == district_a)) {
+      moved_.push_back(id);
     }
   }
+  SwapMoved(district_a, district_b);
+
+  new_score = LogScore();
+  if (rng_.Uniform() > fmin(1, exp(inverse_temp_ * (old_score - new_score)))) {
+    SwapMoved(district_a, district_b);
+    LogScore();
+    rejections_[kAcceptanceFilter]++;
+    return 0;
+  }
 
-  return LogScore();
+  // Every node has already moved, so the journal must take them as one
+  // batch; see TrimJournal.
+  for (auto &id : moved_) {
+    RecordChange(id);
+    AppendToJournal(id, graph_->district_of_node_[id] == district_a
+                            ? district_b
+                            : district_a);
+  }
+  TrimJournal();
+  num_accepted_++;
+  return old_score - score_;
 }
 
 double Runner::Walk(int num_steps) {
-  int sum = 0;
+  double sum = 0;
 
+  ClearChanges();
   for (int i = 0; i < num_steps; i++) {
-    sum += MetropolisHastings();
+    sum += Step();
   }
 
   return sum;
 }
 
+double Runner::Anneal(CoolingSchedule *schedule, uint64_t max_steps,
+                      double max_seconds) {
+  std::chrono::steady_clock::time_point start;
+  std::chrono::duration<double> elapsed;
+  double saved_inverse_temp = inverse_temp_, best_score;
+  uint64_t step, accepted;
+
+  start = std::chrono::steady_clock::now();
+  ClearChanges();
+
+  best_score = LogScore();
+  TrackBest();
+
+  for (step = 0; step < max_steps; step++) {
+    // Reading the clock every step would cost more than the step itself.
+    if (max_seconds > 0 && step % 256 == 0) {
+      elapsed = std::chrono::steady_clock::now() - start;
+      if (elapsed.count() > max_seconds) {
+        break;
+      }
+    }
+
+    inverse_temp_ = 1 / schedule->GetTemperature();
+    accepted = num_accepted_;
+    Step();
+    schedule->Update(num_accepted_ != accepted);
+
+    if (score_ < best_score) {
+      best_score = score_;
+      MarkBest();
+    }
+  }
+
+  RestoreBest();
+  inverse_temp_ = saved_inverse_temp;
+
+  return best_score;
+}
+
+void Runner::TrackBest() {
+  track_best_ = true;
+  MarkBest();
+}
+
+void Runner::MarkBest() {
+  best_in_plan_ = false;
+  journal_nodes_.clear();
+  journal_districts_.clear();
+}
+
 
 //////////////////////////////////////////////////////////////////////////////
 // Queries
 //////////////////////////////////////////////////////////////////////////////
 
 bool Runner::IsEmptyDistrict(int old_district) {
-  return graph_->nodes_in_district_[old_district]->size() <= 1;
+  return graph_->size_of_district_[old_district] <= 1;
 }
 
-bool Runner::IsDistrictSevered(Node *proposed_node) {
-  unordered_map<int, vector<Node *>> map;
-  Node *start;
-  int old_district = proposed_node->district_;
-  proposed_node->district_ = graph_->num_districts_ + 1;
+bool Runner::IsWithinPopulationTolerance(Node *node,
+                                         uint32_t new_district) {
+  return IsWithinPopulationTolerance(graph_->district_of_node_[node->id_],
+                                     new_district,
+                                     graph_->pop_of_node_[node->id_]);
+}
+
+bool Runner::IsWithinPopulationTolerance(uint32_t old_district,
+                                         uint32_t new_district,
+                                         uint32_t pop) {
+  double ideal_pop, old_pop, new_pop;
+
+  if (pop_tolerance_ <= 0) {
+    return true;
+  }
 
-  for (auto &neighbor : *proposed_node->neighbors_) {
-    map[graph_->nodes_[neighbor]->district_].
-                                      push_back(graph_->nodes_[neighbor]);
+  ideal_pop = ((double) graph_->state_pop_) / graph_->num_districts_;
+  old_pop = graph_->pop_of_district_[old_district];
+  new_pop = graph_->pop_of_district_[new_district];
+
+  // Only reject moves that push a district further out of tolerance.
+  if (old_pop - pop < ideal_pop * (1 - pop_tolerance_)) {
+    return false;
+  }
+  if (new_pop + pop > ideal_pop * (1 + pop_tolerance_)) {
+    return false;
   }
 
-  for (auto &pair : map) {
-    for (int i = 0; i < map[pair.first].size() - 1; i++) {
-      if (!DoesPathExist(map[pair.first][i], map[pair.first][i+1])) {
-        proposed_node->district_ = old_district;
-        return true;
+  return true;
+}
+
+bool Runner::IsDistrictSevered(Node *proposed_node) {
+  uint32_t id = proposed_node->id_;
+  uint32_t district = graph_->district_of_node_[id];
+  uint32_t p, q, current, neighbor, stamp, head = 0, tail = 0;
+  uint32_t num_targets = 0, num_found = 1;
+
+  stamp = NextVisitStamp();
+
+  // Only the node's own district can be severed. Every neighbor left in it
+  // must still be reachable from the first one without passing the node.
+  for (p = graph_->adj_offsets_[id]; p < graph_->adj_offsets_[id + 1]; p++) {
+    neighbor = graph_->adj_[p];
+    if (graph_->district_of_node_[neighbor] == district) {
+      targets_[neighbor] = stamp;
+      if (num_targets++ == 0) {
+        queue_[tail++] = neighbor;
+        visited_[neighbor] = stamp;
+      }
+    }
+  }
+  if (num_targets <= 1) {
+    return false;
+  }
+  visited_[id] = stamp;
+
+  // Fast path: the neighbors are often connected to each other directly,
+  // as around most nodes of a planar map, which settles it locally.
+  while (head < tail) {
+    current = queue_[head++];
+    for (q = graph_->adj_offsets_[current];
+         q < graph_->adj_offsets_[current + 1]; q++) {
+      neighbor = graph_->adj_[q];
+      if (targets_[neighbor] == stamp && visited_[neighbor] != stamp) {
+        visited_[neighbor] = stamp;
+        queue_[tail++] = neighbor;
+        if (++num_found == num_targets) {
+          return false;
+        }
       }
     }
   }
 
-  proposed_node->district_ = old_district;
-  return false;
+  // Otherwise search the whole district from every neighbor reached so
+  // far.
+  head = 0;
+  while (head < tail) {
+    current = queue_[head++];
+    for (q = graph_->adj_offsets_[current];
+         q < graph_->adj_offsets_[current + 1]; q++) {
+      neighbor = graph_->adj_[q];
+      if (visited_[neighbor] != stamp &&
+          graph_->district_of_node_[neighbor] == district) {
+        visited_[neighbor] = stamp;
+        queue_[tail++] = neighbor;
+        if (targets_[neighbor] == stamp && ++num_found == num_targets) {
+          return false;
+        }
+      }
+    }
+  }
+
+  return true;
 }
 
 bool Runner::DoesPathExist(Node *start, Node *target) {
-  queue<Node *> q;
-  unordered_set<Node *> processed;
-  Node *current_node;
-  q.push(start);
+  uint32_t district = graph_->district_of_node_[start->id_];
+  uint32_t q, current, neighbor, stamp, head = 0, tail = 0;
+
+  stamp = NextVisitStamp();
+  queue_[tail++] = start->id_;
+  visited_[start->id_] = stamp;
   
-  while (!q.empty()) {
-    current_node = q.front();
-    q.pop();
+  while (head < tail) {
+    current = queue_[head++];
 
-    if (current_node == target) {
+    if (current == target->id_) {
       return true;
     }
-    processed.insert(current_node);
 
-    for (auto &neighbor : *current_node->neighbors_) {
-      if (graph_->nodes_[neighbor]->district_ == current_node->district_ &&
-          std::find(processed.begin(),
-                    processed.end(),
-                    graph_->nodes_[neighbor]) == processed.end()) {
-        q.push(graph_->nodes_[neighbor]);
+    for (q = graph_->adj_offsets_[current];
+         q < graph_->adj_offsets_[current + 1]; q++) {
+      neighbor = graph_->adj_[q];
+      if (visited_[neighbor] != stamp &&
+          graph_->district_of_node_[neighbor] == district) {
+        visited_[neighbor] = stamp;
+        queue_[tail++] = neighbor;
       }
     }
   }
@@ -383,4 +1378,494 @@ Node *Runner::BFS(Node *start, unordered_set<Node *> *set) {
   return nullptr;
 }
 
+double Runner::Step() {
+  return StepEngine(engine_);
+}
+
+double Runner::StepEngine(Engine engine) {
+  switch (engine) {
+    case kReComEngine:
+      return ReCom();
+    case kLiftedEngine:
+      return LiftedMetropolisHastings();
+    case kBlockEngine:
+      return BlockMetropolisHastings();
+    case kTabuEngine:
+      return TabuSearch();
+    case kMixtureEngine:
+      return MixtureStep();
+    default:
+      return MetropolisHastings();
+  }
+}
+
+void Runner::ClearChanges() {
+  for (auto &id : changes_) {
+    is_changed_[id] = false;
+  }
+  changes_.clear();
+}
+
+void Runner::Journal(uint32_t node, uint32_t old_district) {
+  AppendToJournal(node, old_district);
+  TrimJournal();
+}
+
+void Runner::JournalBlock(uint32_t old_district) {
+  for (auto &id : block_) {
+    AppendToJournal(id, old_district);
+  }
+  TrimJournal();
+}
+
+void Runner::AppendToJournal(uint32_t node, uint32_t old_district) {
+  if (!track_best_ || best_in_plan_) {
+    return;
+  }
+
+  journal_nodes_.push_back(node);
+  journal_districts_.push_back(old_district);
+}
+
+void Runner::TrimJournal() {
+  uint32_t i;
+
+  if (best_in_plan_ || journal_nodes_.size() <= graph_->num_nodes_) {
+    return;
+  }
+
+  // Undoing the journal would now cost more than a snapshot, so take one.
+  // Every journaled move has already been made, so the snapshot is the
+  // current plan with all of them undone.
+  std::copy(graph_->district_of_node_,
+            graph_->district_of_node_ + graph_->num_nodes_,
+            best_plan_.begin());
+  for (i = journal_nodes_.size(); i > 0; i--) {
+    best_plan_[journal_nodes_[i - 1]] = journal_districts_[i - 1];
+  }
+  journal_nodes_.clear();
+  journal_districts_.clear();
+  best_in_plan_ = true;
+}
+
+void Runner::RestoreBest() {
+  uint32_t i, node, district;
+
+  if (best_in_plan_) {
+    for (node = 0; node < graph_->num_nodes_; node++) {
+      district = graph_->district_of_node_[node];
+      if (district != best_plan_[node]) {
+        graph_->RemoveNodeFromDistrict(graph_->nodes_[node], district);
+        graph_->AddNodeToDistrict(graph_->nodes_[node], best_plan_[node]);
+        RecordChange(node);
+      }
+    }
+    sampler_.Build(graph_);
+  } else {
+    for (i = journal_nodes_.size(); i > 0; i--) {
+      node = journal_nodes_[i - 1];
+      district = graph_->district_of_node_[node];
+      graph_->RemoveNodeFromDistrict(graph_->nodes_[node], district);
+      graph_->AddNodeToDistrict(graph_->nodes_[node],
+                                journal_districts_[i - 1]);
+      sampler_.UpdateMove(node);
+      RecordChange(node);
+    }
+  }
+
+  journal_nodes_.clear();
+  journal_districts_.clear();
+  best_in_plan_ = false;
+  track_best_ = false;
+  LogScore();
+}
+
+bool Runner::GrowPlan(Rng *rng, vector<uint32_t> *labels,
+                      const std::atomic<uint32_t> *first_accepted,
+                      uint32_t attempt) {
+  uint32_t d, node, p, num_assigned = 0, num_growing;
+  uint32_t num_nodes = graph_->num_nodes_;
+  uint32_t num_districts = graph_->num_districts_;
+  vector<vector<uint32_t>> frontier(num_districts);
+  vector<uint32_t> head(num_districts, 0);
+
+  // num_districts marks the nodes not yet assigned.
+  labels->assign(num_nodes, num_districts);
+
+  // Assigns a node to district d and queues its unassigned neighbors.
+  auto claim = [&](uint32_t node, uint32_t d) {
+    (*labels)[node] = d;
+    num_assigned++;
+    for (p = graph_->adj_offsets_[node]; p < graph_->adj_offsets_[node + 1];
+         p++) {
+      if ((*labels)[graph_->adj_[p]] == num_districts) {
+        frontier[d].push_back(graph_->adj_[p]);
+      }
+    }
+  };
+
+  // Pick a distinct random seed node for each district.
+  for (d = 0; d < num_districts; d++) {
+    do {
+      node = rng->UniformInt(num_nodes);
+    } while ((*labels)[node] != num_districts);
+    claim(node, d);
+  }
+
+  // Grow all districts at once, round-robin, each claiming the unassigned
+  // node closest to its seed. A node enters a queue at most once per
+  // incident edge, so the whole expansion is O(V + E).
+  do {
+    if (first_accepted != nullptr && *first_accepted < attempt) {
+      return false;
+    }
+    num_growing = 0;
+    for (d = 0; d < num_districts; d++) {
+      while (head[d] < frontier[d].size() &&
+             (*labels)[frontier[d][head[d]]] != num_districts) {
+        head[d]++;
+      }
+      if (head[d] < frontier[d].size()) {
+        claim(frontier[d][head[d]++], d);
+        num_growing++;
+      }
+    }
+  } while (num_growing > 0);
+
+  // Every queue ran dry, so any node left over is unreachable from the
+  // seeds.
+  return num_assigned == num_nodes;
+}
+
+bool Runner::IsBalanced(const vector<uint32_t> &labels) const {
+  uint32_t node, d;
+  double ideal_pop = ((double) graph_->state_pop_) / graph_->num_districts_;
+  vector<uint64_t> pops(graph_->num_districts_, 0);
+
+  if (pop_tolerance_ <= 0) {
+    return true;
+  }
+
+  for (node = 0; node < graph_->num_nodes_; node++) {
+    pops[labels[node]] += graph_->pop_of_node_[node];
+  }
+  for (d = 0; d < graph_->num_districts_; d++) {
+    if (pops[d] < ideal_pop * (1 - pop_tolerance_) ||
+        pops[d] > ideal_pop * (1 + pop_tolerance_)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Runner::SplitPlan(Rng *rng, SpanningTree *tree, vector<uint32_t> *labels,
+                       const std::atomic<uint32_t> *first_accepted,
+                       uint32_t attempt) {
+  // The number of trees drawn for one region before giving up.
+  static const uint32_t kMaxDraws = 8;
+  uint32_t k = graph_->num_districts_, n = graph_->num_nodes_;
+  uint32_t d, draw, rest, num_first, num_cuts, j, node;
+  double ideal_pop = ((double) graph_->state_pop_) / k;
+  double lower = 0, upper = graph_->state_pop_;
+  vector<uint32_t> region, subtree, cuts;
+
+  if (pop_tolerance_ > 0) {
+    lower = ideal_pop * (1 - pop_tolerance_);
+    upper = ideal_pop * (1 + pop_tolerance_);
+  }
+
+  labels->assign(n, k - 1);
+  for (node = 0; node < n; node++) {
+    region.push_back(node);
+  }
+
+  for (d = 0; d + 1 < k; d++) {
+    if (first_accepted != nullptr && *first_accepted < attempt) {
+      return false;
+    }
+    rest = k - d - 1;
+    num_cuts = 0;
+    for (draw = 0; draw < kMaxDraws && num_cuts == 0; draw++) {
+      tree->Draw(graph_, region, rng);
+
+      // Either side of a cut can become the new district.
+      num_first = tree->FindCuts(lower, upper, rest * lower, rest * upper);
+      cuts.clear();
+      for (j = 0; j < num_first; j++) {
+        cuts.push_back(tree->GetCut(j));
+      }
+      num_cuts = num_first + tree->FindCuts(rest * lower, rest * upper,
+                                            lower, upper);
+    }
+    if (num_cuts == 0) {
+      return false;
+    }
+
+    // The district's nodes get label d; the rest stay k - 1 and form the
+    // next region.
+    j = rng->UniformInt(num_cuts);
+    if (j < num_first) {
+      tree->GetSubtree(cuts[j], &subtree);
+      for (auto &id : subtree) {
+        (*labels)[id] = d;
+      }
+    } else {
+      tree->GetSubtree(tree->GetCut(j - num_first), &subtree);
+      for (auto &id : region) {
+        (*labels)[id] = d;
+      }
+      for (auto &id : subtree) {
+        (*labels)[id] = k - 1;
+      }
+    }
+
+    j = 0;
+    for (auto &id : region) {
+      if ((*labels)[id] == k - 1) {
+        region[j++] = id;
+      }
+    }
+    region.resize(j);
+  }
+
+  return true;
+}
+
+double Runner::LiftedProbability(uint32_t node, uint32_t district) {
+  uint32_t p, q, neighbor, count;
+  uint32_t old_district = graph_->district_of_node_[node];
+  double prob;
+
+  // The node is proposed directly, or picked as the neighbor of a node of
+  // the growing district that was proposed against the pair's direction.
+  prob = sampler_.Probability(node, district);
+  for (p = graph_->adj_offsets_[node]; p < graph_->adj_offsets_[node + 1];
+       p++) {
+    neighbor = graph_->adj_[p];
+    if (graph_->district_of_node_[neighbor] != district) {
+      continue;
+    }
+    count = 0;
+    for (q = graph_->adj_offsets_[neighbor];
+         q < graph_->adj_offsets_[neighbor + 1]; q++) {
+      count += graph_->district_of_node_[graph_->adj_[q]] == old_district;
+    }
+    prob += sampler_.Probability(neighbor, old_district) / count;
+  }
+
+  return prob;
+}
+
+void Runner::Relabel(uint32_t node, uint32_t district) {
+  graph_->RemoveNodeFromDistrict(graph_->nodes_[node],
+                                 graph_->district_of_node_[node]);
+  graph_->AddNodeToDistrict(graph_->nodes_[node], district);
+  sampler_.UpdateMove(node);
+}
+
+void Runner::SetKernelWeight(Engine kernel, double weight) {
+  if (kernel == kTabuEngine || kernel == kMixtureEngine) {
+    return;
+  }
+  kernel_weights_[kernel] = weight;
+}
+
+KernelStats Runner::GetKernelStats(Engine kernel) {
+  KernelStats stats = kernel_stats_[kernel];
+
+  if (kernel_timed_[kernel] > 0) {
+    stats.seconds *= (double) stats.num_steps / kernel_timed_[kernel];
+  }
+  return stats;
+}
+
+void Runner::AdaptKernelWeights() {
+  double rates[kNumEngines], total_rate = 0, total_weight = 0, share;
+  int kernel, num_weighted = 0;
+  KernelStats stats;
+
+  for (kernel = 0; kernel < kNumEngines; kernel++) {
+    rates[kernel] = 0;
+    if (kernel_weights_[kernel] <= 0) {
+      continue;
+    }
+    num_weighted++;
+    total_weight += kernel_weights_[kernel];
+    stats = GetKernelStats((Engine) kernel);
+    if (stats.seconds > 0) {
+      rates[kernel] = stats.score_change / stats.seconds;
+    }
+    total_rate += rates[kernel];
+  }
+  if (total_rate <= 0) {
+    return;
+  }
+
+  share = kMinKernelShare / num_weighted;
+  for (kernel = 0; kernel < kNumEngines; kernel++) {
+    if (kernel_weights_[kernel] > 0) {
+      kernel_weights_[kernel] = total_weight *
+          (share + (1 - kMinKernelShare) * rates[kernel] / total_rate);
+    }
+  }
+}
+
+void Runner::SetTabuThreads(uint32_t num_threads) {
+  delete tabu_pool_;
+  tabu_pool_ = nullptr;
+  if (num_threads != 1) {
+    tabu_pool_ = new ThreadPool(num_threads);
+  }
+}
+
+void Runner::GrowBall(uint32_t start, uint32_t size, vector<uint32_t> *ball) {
+  uint32_t district = graph_->district_of_node_[start], stamp, head, p;
+  uint32_t neighbor;
+
+  stamp = NextVisitStamp();
+  ball->clear();
+  ball->push_back(start);
+  visited_[start] = stamp;
+  for (head = 0; head < ball->size() && ball->size() < size; head++) {
+    for (p = graph_->adj_offsets_[(*ball)[head]];
+         p < graph_->adj_offsets_[(*ball)[head] + 1] && ball->size() < size;
+         p++) {
+      neighbor = graph_->adj_[p];
+      if (visited_[neighbor] != stamp &&
+          graph_->district_of_node_[neighbor] == district) {
+        visited_[neighbor] = stamp;
+        ball->push_back(neighbor);
+      }
+    }
+  }
+}
+
+double Runner::BlockProbability(uint32_t district) {
+  uint32_t i;
+  double prob = 0, start_prob;
+  bool same;
+
+  for (auto &id : block_) {
+    in_block_[id] = true;
+  }
+
+  // Any node of the block whose search of the same size stays inside it
+  // proposes the same block.
+  for (auto &start : block_) {
+    start_prob = sampler_.Probability(start, district);
+    if (start_prob <= 0) {
+      continue;
+    }
+    GrowBall(start, block_.size(), &ball_);
+    same = ball_.size() == block_.size();
+    for (i = 0; i < ball_.size() && same; i++) {
+      same = in_block_[ball_[i]];
+    }
+    if (same) {
+      prob += start_prob;
+    }
+  }
+
+  for (auto &id : block_) {
+    in_block_[id] = false;
+  }
+  return prob / max_block_size_;
+}
+
+void Runner::MoveBlock(uint32_t district) {
+  for (auto &id : block_) {
+    graph_->RemoveNodeFromDistrict(graph_->nodes_[id],
+                                   graph_->district_of_node_[id]);
+    graph_->AddNodeToDistrict(graph_->nodes_[id], district);
+  }
+
+  // The sampler is only consistent once every node has moved.
+  for (auto &id : block_) {
+    sampler_.UpdateMove(id);
+  }
+}
+
+bool Runner::IsSeveredByBlock(uint32_t district) {
+  uint32_t p, neighbor, current, stamp, head = 0, tail = 0;
+  uint32_t num_targets = 0, num_found = 1;
+
+  // Every node of the district next to the block must still be reachable
+  // from the first one.
+  stamp = NextVisitStamp();
+  for (auto &id : block_) {
+    for (p = graph_->adj_offsets_[id]; p < graph_->adj_offsets_[id + 1];
+         p++) {
+      neighbor = graph_->adj_[p];
+      if (graph_->district_of_node_[neighbor] == district &&
+          targets_[neighbor] != stamp) {
+        targets_[neighbor] = stamp;
+        if (num_targets++ == 0) {
+          queue_[tail++] = neighbor;
+          visited_[neighbor] = stamp;
+        }
+      }
+    }
+  }
+  if (num_targets <= 1) {
+    return false;
+  }
+
+  while (head < tail) {
+    current = queue_[head++];
+    for (p = graph_->adj_offsets_[current];
+         p < graph_->adj_offsets_[current + 1]; p++) {
+      neighbor = graph_->adj_[p];
+      if (visited_[neighbor] != stamp &&
+          graph_->district_of_node_[neighbor] == district) {
+        visited_[neighbor] = stamp;
+        queue_[tail++] = neighbor;
+        if (targets_[neighbor] == stamp && ++num_found == num_targets) {
+          return false;
+        }
+      }
+    }
+  }
+
+  return true;
+}
+
+void Runner::SwapMoved(uint32_t district_a, uint32_t district_b) {
+  uint32_t old_district;
+  Node *node;
+
+  for (auto &id : moved_) {
+    node = graph_->nodes_[id];
+    old_district = graph_->district_of_node_[id];
+    graph_->RemoveNodeFromDistrict(node, old_district);
+    graph_->AddNodeToDistrict(node,
+                              old_district == district_a ? district_b
+                                                         : district_a);
+  }
+
+  // The sampler is only consistent once every node has moved.
+  for (auto &id : moved_) {
+    sampler_.UpdateMove(id);
+  }
+}
+
+uint32_t Runner::NextVisitStamp() {
+  if (++visit_stamp_ == 0) {
+    // The stamp wrapped around; forget every old visit.
+    std::fill(visited_.begin(), visited_.end(), 0);
+    std::fill(targets_.begin(), targets_.end(), 0);
+    visit_stamp_ = 1;
+  }
+  return visit_stamp_;
+}
+
+void Runner::RecordChange(uint32_t node) {
+  if (is_changed_.size() < graph_->num_nodes_) {
+    is_changed_.resize(graph_->num_nodes_, false);
+  }
+  if (!is_changed_[node]) {
+    is_changed_[node] = true;
+    changes_.push_back(node);
+  }
+}
+
 }   // namespace rakan
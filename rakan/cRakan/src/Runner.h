@@ -2,20 +2,99 @@
 #define SRC_RUNNER_H_
  
 #include <inttypes.h>         // for uint32_t, uint16_t, etc.
+#include <math.h>             // for HUGE_VAL
 
+#include <atomic>             // for std::atomic
+#include <functional>         // for std::function
 #include <string>             // for std::string
 #include <unordered_map>      // for std::unordered_map
 #include <unordered_set>      // for std::unordered_set
+#include <vector>             // for std::vector
 
+#include "./BoundarySampler.h"  // for BoundarySampler class
+#include "./CoolingSchedule.h"  // for CoolingSchedule class
 #include "./Graph.h"          // for Graph class
 #include "./Node.h"           // for Node class
+#include "./Rng.h"            // for Rng class
+#include "./SpanningTree.h"   // for SpanningTree class
+#include "./ThreadPool.h"     // for ThreadPool class
 
 using std::string;
 using std::unordered_set;
 using std::unordered_map;
+using std::vector;
 
 namespace rakan {
 
+/*
+* The stages of the proposal filter pipeline run by MetropolisHastings, in
+* the order they are applied. Stages are ordered by cost so that most
+* proposals are discarded before any graph traversal.
+*/
+enum FilterStage {
+  kLabelFilter = 0,     // the node already belongs to the target district
+  kEmptyFilter,         // the move would empty the old district
+  kPopulationFilter,    // the move would leave the population tolerance
+  kAcceptanceFilter,    // the pre-drawn acceptance test rejects the move
+  kContiguityFilter,    // the move would sever the old district
+  kCutFilter,           // the drawn spanning tree has no balanced cut (ReCom)
+  kNumFilterStages
+};
+
+/*
+* The proposal engines a Runner can walk with.
+*/
+enum Engine {
+  kFlipEngine = 0,      // single-node boundary flips, see MetropolisHastings
+  kReComEngine,         // spanning-tree recombination, see ReCom
+  kLiftedEngine,        // non-reversible boundary flips, see
+                        // LiftedMetropolisHastings
+  kBlockEngine,         // connected blocks of boundary nodes, see
+                        // BlockMetropolisHastings
+  kTabuEngine,          // deterministic best boundary moves, see
+                        // TabuSearch
+  kMixtureEngine,       // a weighted mixture of the sampling engines, see
+                        // MixtureStep
+  kNumEngines
+};
+
+/*
+* What one engine has done as a kernel of the mixture engine.
+*/
+struct KernelStats {
+  uint64_t num_steps;       // steps taken by the kernel
+  uint64_t num_accepted;    // steps that changed the plan
+  double seconds;           // the CPU time taken by the stepping thread,
+                            // estimated from one step in every 16
+  double score_change;      // the sum of the absolute changes in score
+                            // made by accepted steps
+};
+
+/*
+* The ways SeedAttempts can draw a plan.
+*/
+enum SeedMethod {
+  kGrowSeeds = 0,       // districts grown from random seeds, see
+                        // SeedDistricts
+  kSplitSeeds           // recursive spanning-tree splits, see
+                        // SeedBalancedDistricts
+};
+
+/*
+* What became of the attempts of one SeedAttempts call.
+*/
+struct SeedStats {
+  uint32_t num_started;     // attempts that began drawing a plan
+  uint32_t num_accepted;    // attempts that drew an acceptable plan
+  uint32_t num_rejected;    // attempts that failed or broke the tolerance
+  uint32_t num_cancelled;   // attempts skipped or abandoned once a lower
+                            // attempt was accepted
+  uint32_t winner;          // the attempt kept; the number of attempts if
+                            // none was
+  double score;             // the score of the plan kept; 0 if unscored
+  double seconds;           // the wall-clock time taken
+};
+
 class Runner {
  public:
 
@@ -25,7 +104,28 @@ class Runner {
   /*
   * Default constructor.
   */
-  Runner() {}
+  Runner()
+      : graph_(nullptr),
+        engine_(kFlipEngine),
+        num_steps_(0),
+        alpha_(0), beta_(0), gamma_(0), eta_(0),
+        inverse_temp_(1),
+        pop_tolerance_(0),
+        pre_draw_(false),
+        max_block_size_(4),
+        tabu_tenure_(10),
+        tabu_iteration_(0),
+        tabu_best_score_(HUGE_VAL),
+        tabu_pool_(nullptr),
+        kernel_weights_(),
+        kernel_stats_(),
+        kernel_timed_(),
+        burn_in_(0),
+        num_mixture_steps_(0),
+        rejections_(),
+        num_accepted_(0),
+        track_best_(false),
+        best_in_plan_(false) {}
 
   /*
   * Constructs a Runner instance with the given graph.
@@ -33,8 +133,35 @@ class Runner {
   * @param    g    The graph this Runner will perform on
   */
   Runner(Graph *g)
-      : num_steps_(0),
-        changes_(new unordered_map<int, int>) {}
+      : graph_(g),
+        engine_(kFlipEngine),
+        num_steps_(0),
+        alpha_(0), beta_(0), gamma_(0), eta_(0),
+        inverse_temp_(1),
+        pop_tolerance_(0),
+        pre_draw_(false),
+        max_block_size_(4),
+        tabu_tenure_(10),
+        tabu_iteration_(0),
+        tabu_best_score_(HUGE_VAL),
+        tabu_pool_(nullptr),
+        kernel_weights_(),
+        kernel_stats_(),
+        kernel_timed_(),
+        burn_in_(0),
+        num_mixture_steps_(0),
+        rejections_(),
+        num_accepted_(0),
+        track_best_(false),
+        best_in_plan_(false) {}
+
+  /*
+  * Stops the threads of tabu steps, if any.
+  */
+  ~Runner();
+
+  Runner(const Runner &other) = delete;
+  Runner &operator=(const Runner &other) = delete;
 
   /*
   * Sets the district assignments according to the given map.
@@ -49,25 +176,179 @@ class Runner {
   */
   uint16_t SetDistricts(unordered_map<uint32_t, uint32_t> *map);
 
+  /*
+  * Switches the populated graph to another plan, given as the district
+  * of every node in node ID order. Only the nodes whose district differs
+  * are moved, so the district populations, perimeters, cut edges, and
+  * sampler are updated in time proportional to the changed nodes and
+  * their edges, and the score is recomputed from the updated district
+  * totals. The changed nodes are recorded as changes and journaled like
+  * any other move. Unlike SetDistricts(map), no PopulateGraphData call is
+  * needed afterwards, and the districts stored on the nodes are not
+  * touched.
+  *
+  * Requires PopulateGraphData to have been called.
+  *
+  * @param    districts   The district of every node
+  *
+  * @return SUCCESS if the plan has been switched to; POPULATE_FAILED if
+  *         the graph data has not been populated; LOAD_FAILED, without
+  *         changing the plan, if some district is out of range
+  */
+  uint16_t SetDistricts(const uint32_t *districts);
+
   /*
   * Generates random seeds on the current graph. Randomly selects
   * a number of nodes to be the "center" of each district and assigns
   * other nodes reachable from the seed nodes to the respective
-  * district.
+  * district. All districts grow together, one node per round, from a
+  * queue per district, so seeding runs in O(V + E) and every district
+  * is contiguous.
   * 
   * @return SUCCESS iff all seeding and assignment successful;
-  *         SEEDING_FAILED otherwise
+  *         SEED_FAILED if some node is unreachable from every seed or
+  *         there are more districts than nodes
   */
   uint16_t SeedDistricts();
 
   /*
-  * Populates the graph's data structures.
+  * Generates a population-balanced plan by recursive spanning-tree
+  * splitting. Each attempt draws a uniformly random spanning tree of the
+  * unassigned region and cuts off a subtree, or its complement, as the
+  * next district, choosing uniformly among the cuts that leave the
+  * district within the population tolerance and the rest within the
+  * tolerance of the districts still to be made. A region whose tree has
+  * no such cut is redrawn a few times before the attempt gives up.
+  *
+  * Attempts run in parallel, see SeedAttempts, and the lowest-numbered
+  * successful attempt is kept. Each attempt draws from its own generator
+  * seeded from this Runner's, so the plan does not depend on the number
+  * of threads. Like SeedDistricts, the plan is stored on the nodes for
+  * PopulateGraphData to read.
+  *
+  * @param    max_attempts  The largest number of attempts to make
+  * @param    num_threads   The number of threads to run attempts on; 0
+  *                         uses one per hardware thread
+  *
+  * @return SUCCESS iff a balanced plan was found; SEED_FAILED if every
+  *         attempt failed, the graph is disconnected, or there are more
+  *         districts than nodes
+  */
+  uint16_t SeedBalancedDistricts(uint32_t max_attempts, uint32_t num_threads);
+
+  /*
+  * Makes up to num_attempts seeding attempts on a pool of threads and
+  * keeps one acceptable plan: a grown plan is acceptable if it is within
+  * the population tolerance, and a split plan always is. Attempt i draws
+  * from stream i of a seed drawn from this Runner's generator.
+  *
+  * Without a score, the lowest-numbered acceptable attempt is kept, and
+  * once an attempt is accepted every higher-numbered one is skipped or
+  * abandoned at its next district. With a score, every attempt runs and
+  * the lowest-scoring acceptable plan is kept, ties going to the lowest
+  * attempt. Either way the plan does not depend on the number of
+  * threads. Like SeedDistricts, the plan is stored on the nodes for
+  * PopulateGraphData to read.
+  *
+  * @param    method        How each attempt draws a plan
+  * @param    num_attempts  The largest number of attempts to make
+  * @param    num_threads   The number of threads to run attempts on; 0
+  *                         uses one per hardware thread
+  * @param    score         Scores a plan given the district of every
+  *                         node, lower being better; called concurrently.
+  *                         Empty keeps the first acceptable plan instead
+  * @param    stats         Filled with what became of the attempts; may
+  *                         be nullptr
+  *
+  * @return SUCCESS iff an acceptable plan was found; SEED_FAILED if no
+  *         attempt gave one, the graph is disconnected, or there are more
+  *         districts than nodes
+  */
+  uint16_t SeedAttempts(
+      SeedMethod method, uint32_t num_attempts, uint32_t num_threads,
+      const std::function<double(const vector<uint32_t> &)> &score,
+      SeedStats *stats);
+
+  /*
+  * Generates a balanced plan on large graphs with the Multilevel
+  * partitioner: the graph is coarsened by heavy-edge matching, the
+  * coarsest graph is split into districts, and the split is refined back
+  * down to the nodes. Seeded from this Runner's generator. The plan is
+  * stored on the nodes even if it misses the population tolerance, and
+  * RepairPopulation can then finish balancing it after PopulateGraphData.
+  *
+  * @return SUCCESS iff the plan is within the population tolerance;
+  *         SEED_FAILED if it is not, the graph is disconnected, or there
+  *         are more districts than nodes
+  */
+  uint16_t SeedMultilevelDistricts();
+
+  /*
+  * Populates the graph's data structures from the districts stored on the
+  * nodes, on one thread; see PopulateGraphData(num_threads).
   * 
   * @return SUCCESS iff all populating was successful; the appropriate
   *         error code otherwise
   */
   uint16_t PopulateGraphData();
 
+  /*
+  * Populates the graph's data structures from the districts stored on the
+  * nodes. The district lists, perimeters, populations and cut edges are
+  * built together in one pass over the adjacency, split across threads
+  * by node range (see Graph::AssignDistricts), and the score is computed
+  * from the resulting district totals. Runs in O(V + E) overall.
+  *
+  * @param    num_threads   The number of threads to run on; 0 uses one
+  *                         per hardware thread
+  *
+  * @return SUCCESS iff all populating was successful; POPULATE_FAILED if
+  *         some node's district is out of range
+  */
+  uint16_t PopulateGraphData(uint32_t num_threads);
+
+  /*
+  * Prepares this Runner to walk from the plan the graph already holds,
+  * e.g. on a copy of a graph whose data has been populated. Unlike
+  * PopulateGraphData, the districts stored on the nodes are not read.
+  *
+  * @return SUCCESS iff the graph's data has been populated;
+  *         POPULATE_FAILED otherwise
+  */
+  uint16_t AdoptGraphData();
+
+  /*
+  * Repairs a plan that breaks the population tolerance, e.g. one just
+  * seeded or loaded, before walking from it. Every round takes the
+  * district furthest out of tolerance and finds, by breadth-first search
+  * over the district adjacency graph, the nearest district on the other
+  * side of the ideal population. Population is then relayed along the
+  * path one pair of districts at a time, peeling boundary nodes from
+  * their shared border, so surplus passes through districts already at
+  * the ideal. The amount brings the district back towards the ideal
+  * without pushing the far end out of tolerance. Moves never sever or
+  * empty a district.
+  *
+  * Rounds that do not reduce the total violation block the district they
+  * served until some round does, and the repair stops once every
+  * district out of tolerance is blocked. Each round is linear in the size
+  * of the district boundaries plus the contiguity checks of the moves
+  * tried. Requires PopulateGraphData to have been called.
+  *
+  * @return SUCCESS iff every district is within the population tolerance,
+  *         or the tolerance is disabled; REPAIR_FAILED otherwise
+  */
+  uint16_t RepairPopulation();
+
+  /*
+  * Copies the engine, scoring weights, inverse temperature, filter, block,
+  * tabu and mixture settings of another Runner. The graph, random state,
+  * tabu threads and kernel statistics are not copied.
+  *
+  * @param    other   The Runner to copy the settings of
+  */
+  void CopySettings(const Runner &other);
+
  //////////////////////////////////////////////////////////////////////////////
  // Scoring
  //////////////////////////////////////////////////////////////////////////////
@@ -114,24 +395,183 @@ class Runner {
   */
   double LogScore();
 
+  /*
+  * Scores the current graph as if the given node were moved into the given
+  * district, without modifying the graph. Only the two affected districts
+  * are re-evaluated, so the cost is proportional to the node's degree.
+  *
+  * @param    node          The node to hypothetically move
+  * @param    new_district  The district to hypothetically move node into
+  *
+  * @return the score the graph would have after the move
+  */
+  double ScoreProposal(Node *node, uint32_t new_district);
+
+  /*
+  * Computes the change in score that moving the given node into the given
+  * district would make, without modifying the graph or this Runner. Safe
+  * to call from several threads while the plan is not being changed.
+  *
+  * @param    node          The node to hypothetically move
+  * @param    new_district  The district to hypothetically move node into
+  *
+  * @return the score after the move minus the current score
+  */
+  double ScoreDelta(Node *node, uint32_t new_district);
+
+  /*
+  * Computes the weighted score contribution of a single district from its
+  * totals. LogScore is the sum of this over all districts.
+  *
+  * @param    cut_edges   The number of edges leaving the district
+  * @param    size        The number of nodes in the district
+  * @param    pop         The total population of the district
+  * @param    min_pop     The minority population of the district
+  *
+  * @return the district's weighted contribution to the score
+  */
+  double DistrictScore(uint32_t cut_edges, uint32_t size,
+                       uint32_t pop, uint32_t min_pop);
+
+  /*
+  * Sets the weights of the scoring metrics used by LogScore.
+  *
+  * @param    alpha   The weight of the compactness score
+  * @param    beta    The weight of the population distribution score
+  * @param    gamma   The weight of the existing-border score
+  * @param    eta     The weight of the VRA score
+  */
+  void SetWeights(double alpha, double beta, double gamma, double eta) {
+    alpha_ = alpha;
+    beta_ = beta;
+    gamma_ = gamma;
+    eta_ = eta;
+  }
+
+  /*
+  * Sets the inverse temperature of the walk. The target distribution
+  * becomes proportional to exp(-inverse_temperature * LogScore()); 1 is
+  * the untempered target and 0 ignores the score entirely.
+  *
+  * @param    inverse_temperature   The non-negative inverse temperature
+  */
+  void SetInverseTemperature(double inverse_temperature) {
+    inverse_temp_ = inverse_temperature;
+  }
+
+  /*
+  * Returns the inverse temperature of the walk.
+  *
+  * @return the inverse temperature
+  */
+  double GetInverseTemperature() { return inverse_temp_; }
+
 
  //////////////////////////////////////////////////////////////////////////////
  // Algorithms
  //////////////////////////////////////////////////////////////////////////////
 
   /*
-  * Implementation of the Metropolis-Hastings algorithm. Randomly
-  * selects a precinct on the border of a district, attempts to
-  * reassign that node to a neighbor district, and evaluates the
-  * score of that redistricting.
+  * Implementation of the Metropolis-Hastings algorithm. Draws a
+  * boundary move from the sampler, attempts to reassign that node to
+  * the neighbor district, and evaluates the score of that
+  * redistricting. The target distribution is proportional to
+  * exp(-inverse temperature * LogScore()), and the acceptance ratio
+  * includes the exact forward and reverse proposal probabilities.
+  *
+  * Proposals pass through the filter pipeline described by FilterStage.
+  * A proposal that fails any stage ends the step as a rejection.
   * 
-  * @return the score of the random redistricting
+  * @return the decrease in score made by this step; 0 if rejected
   */
   double MetropolisHastings();
 
+  /*
+  * Implementation of a lifted, non-reversible Metropolis-Hastings step.
+  * Every pair of districts carries a direction, naming the district of
+  * the pair that grows. A boundary move is drawn from the sampler as in
+  * MetropolisHastings; if its target is the growing district of its pair
+  * the node moves, and otherwise a uniformly random neighbor of the node
+  * in the target district moves into the node's district instead. Either
+  * way the move follows the pair's direction, which is kept until a step
+  * of that pair is rejected, so boundaries drift steadily rather than
+  * diffuse.
+  *
+  * The acceptance ratio uses the exact probabilities of proposing the
+  * move under the current directions and of proposing the move back
+  * under the reversed directions, and a rejected step reverses its pair's
+  * direction. This satisfies skew detailed balance, so the walk samples
+  * the same target as MetropolisHastings with every direction uniform.
+  *
+  * @return the decrease in score made by this step; 0 if rejected
+  */
+  double LiftedMetropolisHastings();
+
+  /*
+  * Implementation of a Metropolis-Hastings step that moves a connected
+  * block of nodes at once. A boundary move (node, district) is drawn from
+  * the sampler as in MetropolisHastings and a block size s uniformly from
+  * 1 to the maximum block size; the block is the first s nodes of a
+  * breadth-first search from the node within its district, neighbors
+  * taken in ascending ID order, and it moves into the drawn district.
+  * Proposals whose search cannot reach s nodes, or would take the whole
+  * district, are rejected as emptying it.
+  *
+  * The forward proposal probability sums over every node of the block
+  * whose search of the same size gives the same block, and the reverse
+  * one is computed the same way after the move, so the walk samples the
+  * same target as MetropolisHastings. The score changes only in the two
+  * districts involved, and is updated from their totals.
+  *
+  * @return the decrease in score made by this step; 0 if rejected
+  */
+  double BlockMetropolisHastings();
+
+  /*
+  * Implementation of one step of tabu search, a deterministic local
+  * search for low-scoring plans. Scores every boundary move of the plan
+  * (a node and a district it borders), across the threads set by
+  * SetTabuThreads, and makes the lowest-scoring move that keeps the
+  * plan valid, even if it raises the score. Ties go to the move found
+  * first along the districts' perimeters.
+  *
+  * A node that has moved stays tabu, and may not move again, for the
+  * tabu tenure of steps, so the search climbs out of local minima rather
+  * than undoing its last moves. A tabu move is still allowed if it
+  * reaches a score lower than any seen by tabu steps so far, its
+  * aspiration. The inverse temperature and random number generator are
+  * unused. A step with no allowed move is counted as rejected under
+  * kAcceptanceFilter.
+  *
+  * @return the decrease in score made by this step, negative if it rose;
+  *         0 if no move was made
+  */
+  double TabuSearch();
+
+  /*
+  * Implementation of one step of a mixture of proposal kernels. Picks one
+  * of the sampling engines (flips, ReCom, lifted flips and blocks) with
+  * probability proportional to its kernel weight, see SetKernelWeight,
+  * and takes one step of it, recording the kernel's statistics. Without
+  * any weight, takes a flip step.
+  *
+  * During the first burn-in steps of the mixture, see SetBurnIn, the
+  * weights are adapted every 1024 steps towards the kernels whose
+  * accepted moves change the score most, in either direction, per second
+  * of CPU time on the stepping thread, keeping their total and a small
+  * share for every weighted kernel. The weights then stay fixed, so after
+  * burn-in the walk is a fixed mixture of kernels that each keep the
+  * target invariant, and keeps it invariant too. ReCom follows its own
+  * measure, see ReCom, and pulls the mixture towards it.
+  *
+  * @return the decrease in score made by this step; 0 if rejected
+  */
+  double MixtureStep();
+
   /*
   * Makes a redistrcting move on the given node. Removes
   * the node from its old district and into the given district.
+  * Requires PopulateGraphData to have been called.
   * 
   * @param    node          The node to make the move on
   * @param    new_district  The new district ID to move node into
@@ -141,8 +581,25 @@ class Runner {
   double Redistrict(Node *node, int new_district);
 
   /*
-  * Walks along the graph this Runner has loaded. Implements the
-  * Metropolis-Hastings algorithm on the graph a given number of times.
+  * Implementation of one recombination (ReCom) step. Draws a boundary move
+  * from the sampler to choose a pair of adjacent districts, merges them,
+  * draws a uniformly random spanning tree of the merged region, and cuts
+  * a uniformly random tree edge that leaves both parts within the
+  * population tolerance. The new plan is accepted with probability
+  * min(1, exp(inverse temperature * (old score - new score))). The
+  * spanning-tree proposal ratio is not included, so the chain follows the
+  * usual ReCom measure rather than exactly exp(-LogScore()).
+  *
+  * A step whose tree has no balanced cut is rejected. With the population
+  * tolerance disabled, every tree edge is a balanced cut.
+  *
+  * @return the decrease in score made by this step; 0 if rejected
+  */
+  double ReCom();
+
+  /*
+  * Walks along the graph this Runner has loaded. Takes a given number of
+  * steps of the selected engine on the graph.
   * 
   * @param    num_steps     The number of steps to take in this walk
   * 
@@ -150,6 +607,47 @@ class Runner {
   */
   double Walk(int num_steps);
 
+  /*
+  * Anneals the plan towards a low score. Walks with the selected engine
+  * at the temperature given by the schedule, i.e. at inverse temperature
+  * 1 / temperature, until the step or time budget runs out, then restores
+  * the best plan seen. The best plan is tracked with a journal of the
+  * moves made since it was seen, so a new best costs O(1); once the
+  * journal grows to the number of nodes it is replaced by a snapshot.
+  * See TrackBest.
+  *
+  * The inverse temperature is restored afterwards.
+  *
+  * @param    schedule      The cooling schedule to follow
+  * @param    max_steps     The largest number of steps to take
+  * @param    max_seconds   The largest number of seconds to run for;
+  *                         non-positive for no time limit
+  *
+  * @return the score of the best plan, which the graph now holds
+  */
+  double Anneal(CoolingSchedule *schedule, uint64_t max_steps,
+                double max_seconds);
+
+  /*
+  * Starts tracking a best plan, initially the current plan. While
+  * tracking, every move is journaled so that RestoreBest can undo the
+  * moves made since the best plan; the caller decides what is best by
+  * calling MarkBest.
+  */
+  void TrackBest();
+
+  /*
+  * Marks the current plan as the best plan. Runs in O(1).
+  */
+  void MarkBest();
+
+  /*
+  * Returns the graph to the best plan and stops tracking. Runs in time
+  * proportional to the number of moves since the best plan, or the
+  * number of nodes if that is smaller.
+  */
+  void RestoreBest();
+
  //////////////////////////////////////////////////////////////////////////////
  // Queries
  //////////////////////////////////////////////////////////////////////////////
@@ -163,6 +661,34 @@ class Runner {
   */
   bool IsEmptyDistrict(int district);
 
+  /*
+  * Queries whether or not moving the node into the given district keeps
+  * both affected districts within the population tolerance. Moves that
+  * bring an out-of-tolerance district closer to the ideal population are
+  * always allowed. Uses the running district totals, so runs in O(1).
+  *
+  * @param    node          The node that will be hypothetically moved
+  * @param    new_district  The district node would be moved into
+  *
+  * @return true iff the move respects the population tolerance, or the
+  *         tolerance is disabled
+  */
+  bool IsWithinPopulationTolerance(Node *node, uint32_t new_district);
+
+  /*
+  * Queries whether or not moving an amount of population from one district
+  * into another keeps both within the population tolerance, as above.
+  *
+  * @param    old_district  The district the population would leave
+  * @param    new_district  The district the population would enter
+  * @param    pop           The population that would be moved
+  *
+  * @return true iff the move respects the population tolerance, or the
+  *         tolerance is disabled
+  */
+  bool IsWithinPopulationTolerance(uint32_t old_district,
+                                   uint32_t new_district, uint32_t pop);
+
   /*
   * Queries whether or not the district that the proposed node is in will be
   * severed once the proposed node is removed.
@@ -217,14 +743,190 @@ class Runner {
   */
   void SetGraph(Graph *graph) { graph_ = graph; }
 
+  /*
+  * Returns the sampler that draws boundary moves for this Runner. Built
+  * by PopulateGraphData.
+  *
+  * @return the pointer pointing to the boundary sampler
+  */
+  BoundarySampler *GetSampler() { return &sampler_; }
+
+  /*
+  * Sets the population tolerance enforced by the filter pipeline, as a
+  * fraction of the ideal district population.
+  *
+  * @param    tolerance   The allowed deviation from the ideal district
+  *                       population; non-positive disables the check
+  */
+  void SetPopulationTolerance(double tolerance) { pop_tolerance_ = tolerance; }
+
+  /*
+  * Gets the population tolerance enforced by the filter pipeline.
+  *
+  * @return the allowed deviation from the ideal district population
+  */
+  double GetPopulationTolerance() { return pop_tolerance_; }
+
+  /*
+  * Enables or disables drawing the acceptance test before the contiguity
+  * check, so that moves that would be rejected anyway skip the traversal.
+  *
+  * @param    enabled   true to run the acceptance test before contiguity
+  */
+  void SetPreDrawAcceptance(bool enabled) { pre_draw_ = enabled; }
+
+  /*
+  * Sets the largest block moved by one step of the block engine.
+  *
+  * @param    size    The largest number of nodes moved at once; at least 1
+  */
+  void SetMaxBlockSize(uint32_t size) { max_block_size_ = size; }
+
+  /*
+  * Returns the largest block moved by one step of the block engine.
+  *
+  * @return the largest block size
+  */
+  uint32_t GetMaxBlockSize() { return max_block_size_; }
+
+  /*
+  * Sets the number of steps a node stays tabu after a tabu step moves it.
+  *
+  * @param    tenure    The number of steps; 0 disables the tabu list
+  */
+  void SetTabuTenure(uint32_t tenure) { tabu_tenure_ = tenure; }
+
+  /*
+  * Returns the number of steps a node stays tabu after it moves.
+  *
+  * @return the tabu tenure
+  */
+  uint32_t GetTabuTenure() { return tabu_tenure_; }
+
+  /*
+  * Sets the number of threads that tabu steps score moves on. Steps make
+  * the same moves on any number of threads.
+  *
+  * @param    num_threads   The number of threads; 0 uses one per hardware
+  *                         thread
+  */
+  void SetTabuThreads(uint32_t num_threads);
+
+  /*
+  * Returns the number of threads that tabu steps score moves on.
+  *
+  * @return the number of threads
+  */
+  uint32_t GetTabuThreads() {
+    return tabu_pool_ == nullptr ? 1 : tabu_pool_->GetNumThreads();
+  }
+
+  /*
+  * Reseeds the random number generator used by seeding and walking. Two
+  * Runners with the same seed, graph, and settings make the same moves.
+  *
+  * @param    seed    The seed for the random number generator
+  */
+  void SetSeed(uint64_t seed) { rng_.Seed(seed); }
+
+  /*
+  * Returns the random number generator used by this Runner, e.g. to
+  * select an independent stream for a parallel chain.
+  *
+  * @return the pointer pointing to the random number generator
+  */
+  Rng *GetRng() { return &rng_; }
+
+  /*
+  * Selects the proposal engine used by Walk.
+  *
+  * @param    engine  The engine to walk with
+  */
+  void SetEngine(Engine engine) { engine_ = engine; }
+
+  /*
+  * Returns the proposal engine used by Walk.
+  *
+  * @return the selected engine
+  */
+  Engine GetEngine() { return engine_; }
+
+  /*
+  * Sets the weight of an engine in the mixture engine. Weights need not
+  * sum to 1; the tabu and mixture engines cannot be mixed and keep
+  * weight 0.
+  *
+  * @param    kernel  The engine to weigh
+  * @param    weight  The non-negative weight; 0 leaves the engine out
+  */
+  void SetKernelWeight(Engine kernel, double weight);
+
+  /*
+  * Returns the weight of an engine in the mixture engine, as adapted
+  * during burn-in.
+  *
+  * @param    kernel  The engine to query
+  *
+  * @return the engine's weight
+  */
+  double GetKernelWeight(Engine kernel) { return kernel_weights_[kernel]; }
+
+  /*
+  * Sets the number of mixture steps during which kernel weights adapt,
+  * counted from the first mixture step.
+  *
+  * @param    num_steps   The number of burn-in steps; 0 never adapts
+  */
+  void SetBurnIn(uint64_t num_steps) { burn_in_ = num_steps; }
+
+  /*
+  * Returns what an engine has done as a kernel of the mixture engine.
+  *
+  * @param    kernel  The engine to query
+  *
+  * @return the engine's statistics
+  */
+  KernelStats GetKernelStats(Engine kernel);
+
+  /*
+  * Returns the number of proposals rejected by the given filter stage
+  * since construction or the last call to ResetRejections.
+  *
+  * @param    stage   The filter stage to query
+  *
+  * @return the number of rejections at that stage
+  */
+  uint64_t GetRejections(FilterStage stage) { return rejections_[stage]; }
+
+  /*
+  * Returns the number of proposals accepted since construction.
+  *
+  * @return the number of accepted proposals
+  */
+  uint64_t GetNumAccepted() { return num_accepted_; }
+
+  /*
+  * Resets all per-stage rejection counters to zero.
+  */
+  void ResetRejections() {
+    for (int i = 0; i < kNumFilterStages; i++) {
+      rejections_[i] = 0;
+    }
+  }
+
  private:
   // The graph that is loaded and evaluated by this Runner.
   Graph *graph_;
 
-  // A map of the changes that have been made since the last walk.
-  // Maps from a node ID to a district ID and assumes that this change
-  // is new.
-  unordered_map<int, int> *changes_;
+  // The IDs of the nodes whose district has changed since the last walk.
+  // Their new districts are read from the graph.
+  vector<uint32_t> changes_;
+
+  // Flags marking which nodes are in changes_, indexed by node ID.
+  vector<bool> is_changed_;
+
+  // The proposal engine used by Walk.
+  Engine engine_;
 
   // The number of steps to take per walk.
   int num_steps_;
@@ -241,6 +943,251 @@ class Runner {
   double beta_;
   double gamma_;
   double eta_;
+
+  // The inverse temperature that scales score differences in acceptance.
+  double inverse_temp_;
+
+  // The allowed deviation from the ideal district population, as a
+  // fraction of the ideal. Non-positive disables the check.
+  double pop_tolerance_;
+
+  // Whether the acceptance test is drawn before the contiguity check.
+  bool pre_draw_;
+
+  // The largest number of nodes a block step moves.
+  uint32_t max_block_size_;
+
+  // State for tabu steps: the tenure, the number of tabu steps taken, the
+  // lowest score they have seen, and the threads moves are scored on;
+  // nullptr scores them on the calling thread.
+  uint32_t tabu_tenure_;
+  uint64_t tabu_iteration_;
+  double tabu_best_score_;
+  ThreadPool *tabu_pool_;
+
+  // State for mixture steps: the weight of every engine, its statistics
+  // and the number of its steps that were timed, the number of steps
+  // weights adapt for, and the number of mixture steps taken.
+  double kernel_weights_[kNumEngines];
+  KernelStats kernel_stats_[kNumEngines];
+  uint64_t kernel_timed_[kNumEngines];
+  uint64_t burn_in_;
+  uint64_t num_mixture_steps_;
+
+  // The number of proposals rejected at each filter stage.
+  uint64_t rejections_[kNumFilterStages];
+
+  // The number of proposals accepted since construction.
+  uint64_t num_accepted_;
+
+  // State for tracking the best plan, see TrackBest. While track_best_
+  // is set, every move since the best plan was seen is journaled as a
+  // node and the district it left. If best_in_plan_ is set, the best plan
+  // is instead held densely in best_plan_ and the journal is unused.
+  bool track_best_;
+  bool best_in_plan_;
+  vector<uint32_t> journal_nodes_;
+  vector<uint32_t> journal_districts_;
+  vector<uint32_t> best_plan_;
+
+  // The random number generator for seeding and walking.
+  Rng rng_;
+
+  // The weighted sampler over boundary moves of the current plan.
+  BoundarySampler sampler_;
+
+  // Scratch space for graph traversals, sized by PopulateGraphData so that
+  // walking never allocates. A node has been visited by the current
+  // traversal iff its entry in visited_ equals visit_stamp_; targets_
+  // marks the nodes a traversal is looking for the same way.
+  vector<uint32_t> queue_;
+  vector<uint32_t> visited_;
+  vector<uint32_t> targets_;
+  uint32_t visit_stamp_;
+
+  // The direction of every pair of districts for lifted steps, indexed by
+  // PairIndex: true iff the lower-numbered district of the pair grows.
+  vector<bool> lower_grows_;
+
+  // Scratch space for ReCom steps: the spanning tree of the merged region,
+  // the region's nodes, one side of the cut, and the nodes that moved.
+  SpanningTree tree_;
+  vector<uint32_t> region_;
+  vector<uint32_t> subtree_;
+  vector<uint32_t> moved_;
+
+  // Scratch space for block steps: the proposed block, flags marking its
+  // nodes, and another search used to compare against it.
+  vector<uint32_t> block_;
+  vector<uint8_t> in_block_;
+  vector<uint32_t> ball_;
+
+  // A boundary move scored by a tabu step: the change in score it makes,
+  // and whether it keeps its districts nonempty and within tolerance.
+  struct TabuMove {
+    uint32_t node;
+    uint32_t district;
+    double delta;
+    bool allowed;
+  };
+
+  // Scratch space for tabu steps: the boundary moves of the plan, their
+  // order by score, and the last step at which each node is tabu.
+  vector<TabuMove> tabu_moves_;
+  vector<uint32_t> tabu_order_;
+  vector<uint64_t> tabu_until_;
+
+  /*
+  * Returns the Metropolis-Hastings probability of accepting a move from a
+  * graph with the old score to a graph with the new score, given the
+  * forward and reverse proposal probabilities of the move.
+  */
+  double AcceptanceProbability(double old_score, double new_score,
+                               double forward_prob, double reverse_prob);
+
+  /*
+  * Takes one step of the selected engine.
+  */
+  double Step();
+
+  /*
+  * Takes one step of the given engine.
+  */
+  double StepEngine(Engine engine);
+
+  /*
+  * Moves the kernel weights towards the kernels that have changed the
+  * score most per second, see MixtureStep.
+  */
+  void AdaptKernelWeights();
+
+  /*
+  * Forgets which nodes have changed district.
+  */
+  void ClearChanges();
+
+  /*
+  * Journals the move of a node out of the given district, if the best
+  * plan is being tracked.
+  */
+  void Journal(uint32_t node, uint32_t old_district);
+
+  /*
+  * Makes one attempt of SeedDistricts, writing a district for every node
+  * into labels. Returns false if the attempt failed, or was abandoned
+  * because first_accepted, if given, fell below attempt.
+  */
+  bool GrowPlan(Rng *rng, vector<uint32_t> *labels,
+                const std::atomic<uint32_t> *first_accepted, uint32_t attempt);
+
+  /*
+  * Makes one attempt of SeedBalancedDistricts, writing a district for
+  * every node into labels. Returns false if the attempt failed, or was
+  * abandoned because first_accepted, if given, fell below attempt.
+  */
+  bool SplitPlan(Rng *rng, SpanningTree *tree, vector<uint32_t> *labels,
+                 const std::atomic<uint32_t> *first_accepted, uint32_t attempt);
+
+  /*
+  * Queries whether every district of a plan, given as the district of
+  * every node, is within the population tolerance.
+  */
+  bool IsBalanced(const vector<uint32_t> &labels) const;
+
+  /*
+  * Returns the index of a pair of districts in lower_grows_.
+  */
+  uint32_t PairIndex(uint32_t district_a, uint32_t district_b) {
+    return district_a < district_b
+        ? district_a * graph_->num_districts_ + district_b
+        : district_b * graph_->num_districts_ + district_a;
+  }
+
+  /*
+  * Returns the probability that a lifted step proposes moving the node
+  * into the given district, which must be the growing district of the
+  * pair it forms with the node's district.
+  */
+  double LiftedProbability(uint32_t node, uint32_t district);
+
+  /*
+  * Moves a node into a district, keeping the sampler up to date but
+  * without recording or journaling the move.
+  */
+  void Relabel(uint32_t node, uint32_t district);
+
+  /*
+  * Moves boundary nodes of one district into an adjacent district,
+  * nearest the shared border first, until about the given population has
+  * moved. Skips moves that would sever or empty the district. Returns the
+  * population moved.
+  */
+  double TransferPopulation(uint32_t from, uint32_t to, double amount);
+
+  /*
+  * Collects into ball the first size nodes reached by a breadth-first
+  * search from the start node within its district, or fewer if the
+  * district is smaller.
+  */
+  void GrowBall(uint32_t start, uint32_t size, vector<uint32_t> *ball);
+
+  /*
+  * Returns the probability that a block step proposes moving the nodes
+  * of block_, which share a district, into the given district.
+  */
+  double BlockProbability(uint32_t district);
+
+  /*
+  * Moves every node of block_ into a district, keeping the sampler up to
+  * date but without recording or journaling the moves.
+  */
+  void MoveBlock(uint32_t district);
+
+  /*
+  * Queries whether the given district has been severed by moving the
+  * nodes of block_ out of it.
+  */
+  bool IsSeveredByBlock(uint32_t district);
+
+  /*
+  * Journals the moves of every node of block_ out of the given district,
+  * once they have all been made, if the best plan is being tracked.
+  */
+  void JournalBlock(uint32_t old_district);
+
+  /*
+  * Adds the move of a node out of the given district to the journal, if
+  * the best plan is being tracked, without checking its length. A batch of
+  * moves that have all been made is appended and then trimmed once, so
+  * that a snapshot never holds part of the batch.
+  */
+  void AppendToJournal(uint32_t node, uint32_t old_district);
+
+  /*
+  * Replaces the journal by a snapshot of the best plan once undoing it
+  * would cost more than a snapshot. Every journaled move must already have
+  * been made.
+  */
+  void TrimJournal();
+
+  /*
+  * Moves every node of moved_ into the other district of the given pair,
+  * keeping the sampler up to date.
+  */
+  void SwapMoved(uint32_t district_a, uint32_t district_b);
+
+  /*
+  * Starts a new traversal and returns its visit stamp.
+  */
+  uint32_t NextVisitStamp();
+
+  /*
+  * Records that the given node has changed district since the last walk.
+  */
+  void RecordChange(uint32_t node);
+
+  friend class MultipleTry;
+  friend class ParallelFlip;
 };        // class Runner
 
 }         // namespace rakan
@@ -0,0 +1,310 @@
+#include "./SMC.h"
+
+#include <math.h>             // for exp(), log(), INFINITY
+#include <inttypes.h>         // for uint16_t, uint32_t, uint64_t
+
+#include <algorithm>          // for std::copy
+#include <vector>             // for std::vector
+
+#include "./Graph.h"          // for Graph class
+#include "./ReturnCodes.h"    // for SUCCESS, SAMPLE_FAILED
+#include "./Runner.h"         // for Runner class
+
+namespace rakan {
+
+const uint16_t SMC::kUnassigned;
+
+// Derives the seed of one particle's generator for one step.
+static uint64_t ParticleSeed(uint64_t seed, uint32_t step, uint32_t particle) {
+  return seed ^ (step * 0x9e3779b97f4a7c15ULL) ^
+         (particle * 0xc2b2ae3d27d4eb4fULL);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Constructors and destructors
+///////////////////////////////////////////////////////////////////////////////
+
+SMC::SMC(Runner *runner, uint32_t num_particles, uint32_t num_threads)
+    : runner_(runner),
+      graph_(runner->GetGraph()),
+      num_nodes_(graph_->num_nodes_),
+      num_districts_(graph_->num_districts_),
+      num_particles_(num_particles),
+      threshold_(1),
+      seed_(runner->GetRng()->Next()),
+      pool_(num_threads) {
+  uint32_t i;
+
+  scratch_.resize(pool_.GetNumThreads());
+  for (i = 0; i < scratch_.size(); i++) {
+    scratch_[i].tree.Reserve(graph_);
+    scratch_[i].region.reserve(num_nodes_);
+    scratch_[i].subtree.reserve(num_nodes_);
+    scratch_[i].cuts.reserve(num_nodes_);
+  }
+}
+
+SMC::~SMC() {}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Algorithms
+///////////////////////////////////////////////////////////////////////////////
+
+uint16_t SMC::Run() {
+  uint32_t step, p, v, head = 0;
+  uint32_t num_blocks = scratch_.size();
+  vector<uint32_t> queue;
+  vector<bool> seen(num_nodes_, false);
+  double max_log_weight, sum = 0;
+
+  if (num_districts_ == 0 || num_districts_ >= kUnassigned ||
+      num_particles_ == 0 || num_nodes_ == 0 ||
+      graph_->adj_offsets_ == nullptr) {
+    return SAMPLE_FAILED;
+  }
+
+  // Spanning trees only exist on connected regions.
+  queue.push_back(0);
+  seen[0] = true;
+  while (head < queue.size()) {
+    v = queue[head++];
+    for (p = graph_->adj_offsets_[v]; p < graph_->adj_offsets_[v + 1]; p++) {
+      if (!seen[graph_->adj_[p]]) {
+        seen[graph_->adj_[p]] = true;
+        queue.push_back(graph_->adj_[p]);
+      }
+    }
+  }
+  if (queue.size() < num_nodes_) {
+    return SAMPLE_FAILED;
+  }
+
+  particles_.assign((uint64_t) num_particles_ * num_nodes_, kUnassigned);
+  resampled_.resize(particles_.size());
+  log_weights_.assign(num_particles_, 0);
+  rng_.Seed(seed_);
+
+  // A single district needs no splits; every particle is the whole state.
+  if (num_districts_ == 1) {
+    particles_.assign(particles_.size(), 0);
+    log_weights_.assign(num_particles_, 0);
+  }
+
+  for (step = 0; step + 1 < num_districts_; step++) {
+    auto split_block = [this, step, num_blocks](uint32_t block) {
+      uint64_t begin = (uint64_t) block * num_particles_ / num_blocks;
+      uint64_t end = (uint64_t) (block + 1) * num_particles_ / num_blocks;
+      for (uint64_t particle = begin; particle < end; particle++) {
+        Split(particle, step, &scratch_[block]);
+      }
+    };
+    pool_.ParallelFor(num_blocks, split_block);
+    Resample();
+  }
+
+  // Normalize the final weights.
+  max_log_weight = -INFINITY;
+  for (p = 0; p < num_particles_; p++) {
+    if (log_weights_[p] > max_log_weight) {
+      max_log_weight = log_weights_[p];
+    }
+  }
+  if (max_log_weight == -INFINITY) {
+    return SAMPLE_FAILED;
+  }
+
+  weights_.resize(num_particles_);
+  for (p = 0; p < num_particles_; p++) {
+    weights_[p] = exp(log_weights_[p] - max_log_weight);
+    sum += weights_[p];
+  }
+  for (p = 0; p < num_particles_; p++) {
+    weights_[p] /= sum;
+  }
+
+  return SUCCESS;
+}
+
+void SMC::Split(uint32_t particle, uint32_t step, Scratch *scratch) {
+  uint16_t *labels = &particles_[(uint64_t) particle * num_nodes_];
+  uint32_t v, j, p, num_first, num_cuts, rest = num_districts_ - step - 1;
+  uint32_t num_crossing = 0;
+  uint16_t side, other;
+  double tolerance = runner_->GetPopulationTolerance();
+  double ideal, lower = 0, upper = INFINITY;
+  double inverse_temp = runner_->GetInverseTemperature();
+  Rng rng(ParticleSeed(seed_, step, particle));
+
+  if (log_weights_[particle] == -INFINITY) {
+    return;
+  }
+
+  if (tolerance > 0) {
+    ideal = ((double) graph_->state_pop_) / num_districts_;
+    lower = ideal * (1 - tolerance);
+    upper = ideal * (1 + tolerance);
+  }
+
+  scratch->region.clear();
+  for (v = 0; v < num_nodes_; v++) {
+    if (labels[v] == kUnassigned) {
+      scratch->region.push_back(v);
+    }
+  }
+
+  scratch->tree.Draw(graph_, scratch->region, &rng);
+
+  // Either side of a cut can become the new district.
+  num_first = scratch->tree.FindCuts(lower, upper,
+                                     rest * lower, rest * upper);
+  scratch->cuts.clear();
+  for (j = 0; j < num_first; j++) {
+    scratch->cuts.push_back(scratch->tree.GetCut(j));
+  }
+  num_cuts = num_first + scratch->tree.FindCuts(rest * lower, rest * upper,
+                                                lower, upper);
+  if (num_cuts == 0) {
+    log_weights_[particle] = -INFINITY;
+    return;
+  }
+
+  j = rng.UniformInt(num_cuts);
+  if (j < num_first) {
+    scratch->tree.GetSubtree(scratch->cuts[j], &scratch->subtree);
+    for (auto &node : scratch->subtree) {
+      labels[node] = step;
+    }
+  } else {
+    scratch->tree.GetSubtree(scratch->tree.GetCut(j - num_first),
+                             &scratch->subtree);
+    for (auto &node : scratch->region) {
+      labels[node] = step;
+    }
+    for (auto &node : scratch->subtree) {
+      labels[node] = kUnassigned;
+    }
+  }
+
+  // The drawn tree is one of tau(D) tau(R) |C(D, R)| trees that give the
+  // split, so the weight also divides by the number of edges between the
+  // two sides.
+  side = labels[scratch->subtree[0]];
+  other = side == step ? kUnassigned : step;
+  for (auto &node : scratch->subtree) {
+    for (p = graph_->adj_offsets_[node]; p < graph_->adj_offsets_[node + 1];
+         p++) {
+      if (labels[graph_->adj_[p]] == other) {
+        num_crossing++;
+      }
+    }
+  }
+
+  log_weights_[particle] += log((double) num_cuts) -
+      log((double) num_crossing) -
+      inverse_temp * ScoreDistrict(labels, scratch->region, step);
+
+  // The last split leaves the final district behind.
+  if (rest == 1) {
+    for (auto &node : scratch->region) {
+      if (labels[node] == kUnassigned) {
+        labels[node] = step + 1;
+      }
+    }
+    log_weights_[particle] -=
+        inverse_temp * ScoreDistrict(labels, scratch->region, step + 1);
+  }
+}
+
+double SMC::ScoreDistrict(const uint16_t *labels,
+                          const vector<uint32_t> &nodes,
+                          uint16_t label) const {
+  uint32_t p, cut_edges = 0, size = 0, pop = 0, min_pop = 0;
+
+  for (auto &node : nodes) {
+    if (labels[node] != label) {
+      continue;
+    }
+    size++;
+    pop += graph_->pop_of_node_[node];
+    min_pop += graph_->min_pop_of_node_[node];
+    for (p = graph_->adj_offsets_[node]; p < graph_->adj_offsets_[node + 1];
+         p++) {
+      if (labels[graph_->adj_[p]] != label) {
+        cut_edges++;
+      }
+    }
+  }
+
+  return runner_->DistrictScore(cut_edges, size, pop, min_pop);
+}
+
+void SMC::Resample() {
+  uint32_t p, source = 0;
+  double max_log_weight = -INFINITY, sum = 0, sum_squares = 0;
+  double u, cumulative;
+
+  for (p = 0; p < num_particles_; p++) {
+    if (log_weights_[p] > max_log_weight) {
+      max_log_weight = log_weights_[p];
+    }
+  }
+  if (max_log_weight == -INFINITY) {
+    return;
+  }
+
+  weights_.resize(num_particles_);
+  for (p = 0; p < num_particles_; p++) {
+    weights_[p] = exp(log_weights_[p] - max_log_weight);
+    sum += weights_[p];
+    sum_squares += weights_[p] * weights_[p];
+  }
+  if (sum * sum / sum_squares >= threshold_ * num_particles_) {
+    return;
+  }
+
+  // Systematic resampling.
+  u = rng_.Uniform() / num_particles_;
+  cumulative = weights_[0] / sum;
+  for (p = 0; p < num_particles_; p++) {
+    while (cumulative < u && source + 1 < num_particles_) {
+      source++;
+      cumulative += weights_[source] / sum;
+    }
+    std::copy(&particles_[(uint64_t) source * num_nodes_],
+              &particles_[(uint64_t) source * num_nodes_] + num_nodes_,
+              &resampled_[(uint64_t) p * num_nodes_]);
+    u += 1.0 / num_particles_;
+  }
+
+  particles_.swap(resampled_);
+  log_weights_.assign(num_particles_, 0);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Queries
+///////////////////////////////////////////////////////////////////////////////
+
+double SMC::GetWeight(uint32_t particle) const {
+  return weights_[particle];
+}
+
+bool SMC::CopyParticle(uint32_t particle, Graph *graph) const {
+  const uint16_t *labels = GetParticle(particle);
+  uint32_t v;
+
+  for (v = 0; v < num_nodes_; v++) {
+    if (labels[v] >= num_districts_) {
+      return false;
+    }
+  }
+
+  graph->ClearDistricts();
+  for (v = 0; v < num_nodes_; v++) {
+    graph->AddNodeToDistrict(graph->nodes_[v], labels[v]);
+  }
+  return true;
+}
+
+}   // namespace rakan
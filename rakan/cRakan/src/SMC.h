@@ -0,0 +1,194 @@
+#ifndef SRC_SMC_H_
+#define SRC_SMC_H_
+
+#include <inttypes.h>         // for uint16_t, uint32_t, uint64_t
+
+#include <vector>             // for std::vector
+
+#include "./Graph.h"          // for Graph class
+#include "./Rng.h"            // for Rng class
+#include "./Runner.h"         // for Runner class
+#include "./SpanningTree.h"   // for SpanningTree class
+#include "./ThreadPool.h"     // for ThreadPool class
+
+using std::vector;
+
+namespace rakan {
+
+/*
+* A sequential Monte Carlo sampler of whole plans. Every particle starts
+* with the whole state unassigned and splits off one district per step:
+* it draws a uniform spanning tree of its unassigned region and cuts a
+* uniformly random tree edge that leaves a district within the population
+* tolerance and a remainder that can still be split into the remaining
+* districts. Particles are then resampled by importance weight.
+*
+* As in SMC-redist, the target is proportional to exp(-inverse temperature
+* * LogScore()) times the product of the spanning-tree counts of the
+* districts. A split (D, R) is drawn with probability tau(D) tau(R)
+* |C(D, R)| / tau(region) / (number of valid cuts), where tau counts
+* spanning trees and C(D, R) is the set of edges between the two sides,
+* so each split weighs the number of valid cuts of the drawn tree over
+* |C(D, R)|; using the drawn tree's count in place of its intractable
+* expectation keeps the weights unbiased. Districts are labeled in the
+* order they are split off, so a plan is counted once per order whose
+* remainders are all connected and within the tolerance. The score terms
+* are taken from a Runner, whose weights and inverse temperature are used.
+*
+* Particles are stored as one 16-bit district label per node. Each particle
+* draws from its own generator, seeded from the sampler's seed, the step
+* and the particle, so results do not depend on the number of threads.
+*/
+class SMC {
+ public:
+  /////////////////////////////////////////////////////////////////////////////
+  // Constructors and destructors
+  /////////////////////////////////////////////////////////////////////////////
+
+  /*
+  * Creates a sampler over the graph of a Runner whose graph data has been
+  * populated. The Runner supplies the scoring weights, inverse temperature
+  * and population tolerance, and must outlive the sampler.
+  *
+  * @param    runner          the Runner to score districts with
+  * @param    num_particles   the number of particles
+  * @param    num_threads     the number of threads to run on; 0 uses one
+  *                           per hardware thread
+  */
+  SMC(Runner *runner, uint32_t num_particles, uint32_t num_threads);
+
+  /*
+  * Default destructor.
+  */
+  ~SMC();
+
+  SMC(const SMC &other) = delete;
+  SMC &operator=(const SMC &other) = delete;
+
+  /*
+  * Seeds the sampler.
+  *
+  * @param    seed    the seed to derive all particles' generators from
+  */
+  void SetSeed(uint64_t seed) { seed_ = seed; }
+
+  /*
+  * Sets when particles are resampled: after every step whose effective
+  * sample size falls below the given fraction of the number of particles.
+  *
+  * @param    threshold   the fraction, in [0, 1]; 1 resamples every step
+  */
+  void SetResampleThreshold(double threshold) { threshold_ = threshold; }
+
+  /////////////////////////////////////////////////////////////////////////////
+  // Algorithms
+  /////////////////////////////////////////////////////////////////////////////
+
+  /*
+  * Draws a full set of particles.
+  *
+  * @return SUCCESS iff at least one particle is a complete plan;
+  *         SAMPLE_FAILED if the graph is disconnected, has too many
+  *         districts, or every particle ran out of valid cuts
+  */
+  uint16_t Run();
+
+  /////////////////////////////////////////////////////////////////////////////
+  // Queries
+  /////////////////////////////////////////////////////////////////////////////
+
+  /*
+  * Gets the number of particles.
+  *
+  * @return the number of particles
+  */
+  uint32_t GetNumParticles() const { return num_particles_; }
+
+  /*
+  * Gets the normalized importance weight of a particle after Run.
+  *
+  * @param    particle    the particle
+  *
+  * @return the weight of the particle; all weights sum to 1
+  */
+  double GetWeight(uint32_t particle) const;
+
+  /*
+  * Gets the district labels of a particle, one per node.
+  *
+  * @param    particle    the particle
+  *
+  * @return a pointer to the particle's labels
+  */
+  const uint16_t *GetParticle(uint32_t particle) const {
+    return &particles_[(uint64_t) particle * num_nodes_];
+  }
+
+  /*
+  * Loads a particle into a graph over the same nodes, replacing its plan.
+  * The graph's flattened adjacency must be built.
+  *
+  * @param    particle    the particle to load
+  * @param    graph       the graph to load the particle into
+  *
+  * @return true iff the particle is a complete plan and has been loaded
+  */
+  bool CopyParticle(uint32_t particle, Graph *graph) const;
+
+ private:
+  // Per-thread scratch space for splitting particles.
+  struct Scratch {
+    SpanningTree tree;
+    vector<uint32_t> region;
+    vector<uint32_t> subtree;
+    vector<uint32_t> cuts;
+  };
+
+  // Splits the next district off one particle, updating its log weight.
+  void Split(uint32_t particle, uint32_t step, Scratch *scratch);
+
+  // Computes the weighted score of the nodes of a particle that carry the
+  // given label.
+  double ScoreDistrict(const uint16_t *labels, const vector<uint32_t> &nodes,
+                       uint16_t label) const;
+
+  // Resamples the particles by weight if the effective sample size is
+  // below the threshold.
+  void Resample();
+
+  // The label of nodes that have not been assigned a district.
+  static const uint16_t kUnassigned = 0xFFFF;
+
+  // The Runner and graph the sampler works on.
+  Runner *runner_;
+  Graph *graph_;
+  uint32_t num_nodes_;
+  uint32_t num_districts_;
+
+  // The particles' labels, num_nodes_ per particle, and the buffer they
+  // are resampled into.
+  uint32_t num_particles_;
+  vector<uint16_t> particles_;
+  vector<uint16_t> resampled_;
+
+  // The log importance weight of each particle; -infinity for particles
+  // that ran out of valid cuts.
+  vector<double> log_weights_;
+
+  // The normalized weight of each particle after the last Run.
+  vector<double> weights_;
+
+  // Resampling settings and state.
+  double threshold_;
+  uint64_t seed_;
+  Rng rng_;
+
+  // One scratch space per block of particles.
+  vector<Scratch> scratch_;
+
+  ThreadPool pool_;
+};        // class SMC
+
+}         // namespace rakan
+
+#endif    // SRC_SMC_H_
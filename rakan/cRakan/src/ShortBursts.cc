@@ -0,0 +1,108 @@
+#include "./ShortBursts.h"
+
+#include <inttypes.h>         // for uint32_t, uint64_t
+
+#include <vector>             // for std::vector
+
+#include "./Graph.h"          // for Graph class
+#include "./Runner.h"         // for Runner class
+
+namespace rakan {
+
+///////////////////////////////////////////////////////////////////////////////
+// Constructors and destructors
+///////////////////////////////////////////////////////////////////////////////
+
+ShortBursts::ShortBursts(Runner *base, uint32_t num_bursts,
+                         uint32_t num_threads)
+    : pool_(num_threads) {
+  uint32_t i;
+  Graph *graph;
+  Runner *burst;
+
+  best_ = new Graph(*base->GetGraph());
+  for (i = 0; i < num_bursts; i++) {
+    graph = new Graph(*best_);
+    burst = new Runner(graph);
+    burst->CopySettings(*base);
+    burst->AdoptGraphData();
+    graphs_.push_back(graph);
+    bursts_.push_back(burst);
+  }
+
+  SetSeed(base->GetRng()->Next());
+}
+
+ShortBursts::~ShortBursts() {
+  uint32_t i;
+
+  for (i = 0; i < bursts_.size(); i++) {
+    delete bursts_[i];
+    delete graphs_[i];
+  }
+  delete best_;
+}
+
+void ShortBursts::SetSeed(uint64_t seed) {
+  uint32_t i;
+
+  for (i = 0; i < bursts_.size(); i++) {
+    bursts_[i]->GetRng()->SeedStream(seed, i + 1);
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Algorithms
+///////////////////////////////////////////////////////////////////////////////
+
+uint32_t ShortBursts::Run(uint32_t num_rounds, uint32_t burst_length) {
+  uint32_t round, i, winner;
+
+  auto run_burst = [this, burst_length](uint32_t burst) {
+    RunBurst(burst, burst_length);
+  };
+
+  for (round = 0; round < num_rounds; round++) {
+    pool_.ParallelFor(bursts_.size(), run_burst);
+
+    // Take the first burst with the highest count, so that the winner does
+    // not depend on which thread finished first.
+    winner = 0;
+    for (i = 1; i < graphs_.size(); i++) {
+      if (graphs_[i]->GetNumMajorityMinority() >
+          graphs_[winner]->GetNumMajorityMinority()) {
+        winner = i;
+      }
+    }
+    if (!graphs_.empty() &&
+        graphs_[winner]->GetNumMajorityMinority() >=
+        best_->GetNumMajorityMinority()) {
+      best_->CopyPlan(*graphs_[winner]);
+    }
+  }
+
+  return best_->GetNumMajorityMinority();
+}
+
+void ShortBursts::RunBurst(uint32_t burst, uint32_t burst_length) {
+  Runner *runner = bursts_[burst];
+  Graph *graph = graphs_[burst];
+  uint32_t step, best_count;
+
+  graph->CopyPlan(*best_);
+  runner->AdoptGraphData();
+
+  best_count = graph->GetNumMajorityMinority();
+  runner->TrackBest();
+  for (step = 0; step < burst_length; step++) {
+    runner->Walk(1);
+    if (graph->GetNumMajorityMinority() >= best_count) {
+      best_count = graph->GetNumMajorityMinority();
+      runner->MarkBest();
+    }
+  }
+  runner->RestoreBest();
+}
+
+}   // namespace rakan
@@ -0,0 +1,111 @@
+#ifndef SRC_SHORTBURSTS_H_
+#define SRC_SHORTBURSTS_H_
+
+#include <inttypes.h>         // for uint32_t, uint64_t
+
+#include <vector>             // for std::vector
+
+#include "./Graph.h"          // for Graph class
+#include "./Runner.h"         // for Runner class
+#include "./ThreadPool.h"     // for ThreadPool class
+
+using std::vector;
+
+namespace rakan {
+
+/*
+* A "short bursts" optimizer for the number of majority-minority districts.
+* Every round runs a number of short walks, the bursts, from the best plan
+* so far, in parallel. Each burst remembers the best plan it visits,
+* preferring later plans on ties so that bursts keep moving along
+* plateaus, and the best of the bursts becomes the starting plan of the
+* next round.
+*
+* The objective is read from the graph's running count after every step,
+* in O(1). Burst i always draws from stream i + 1 of the seed, so results
+* do not depend on the number of threads.
+*/
+class ShortBursts {
+ public:
+  /////////////////////////////////////////////////////////////////////////////
+  // Constructors and destructors
+  /////////////////////////////////////////////////////////////////////////////
+
+  /*
+  * Creates the bursts from a Runner whose graph data has been populated.
+  * Every burst walks with the base Runner's settings, starting from its
+  * current plan.
+  *
+  * @param    base          the Runner to copy the plan and settings of
+  * @param    num_bursts    the number of bursts per round
+  * @param    num_threads   the number of threads to run bursts on; 0 uses
+  *                         one per hardware thread
+  */
+  ShortBursts(Runner *base, uint32_t num_bursts, uint32_t num_threads);
+
+  /*
+  * Destroys all bursts and their graphs.
+  */
+  ~ShortBursts();
+
+  ShortBursts(const ShortBursts &other) = delete;
+  ShortBursts &operator=(const ShortBursts &other) = delete;
+
+  /*
+  * Seeds every burst from an independent stream of one seed.
+  *
+  * @param    seed    the seed to derive all streams from
+  */
+  void SetSeed(uint64_t seed);
+
+  /////////////////////////////////////////////////////////////////////////////
+  // Algorithms
+  /////////////////////////////////////////////////////////////////////////////
+
+  /*
+  * Runs rounds of bursts.
+  *
+  * @param    num_rounds      the number of rounds to run
+  * @param    burst_length    the number of steps in each burst
+  *
+  * @return the number of majority-minority districts in the best plan
+  */
+  uint32_t Run(uint32_t num_rounds, uint32_t burst_length);
+
+  /////////////////////////////////////////////////////////////////////////////
+  // Queries
+  /////////////////////////////////////////////////////////////////////////////
+
+  /*
+  * Gets the best plan found so far. The graph shares the base Runner's
+  * nodes.
+  *
+  * @return the graph holding the best plan
+  */
+  Graph *GetBest() { return best_; }
+
+  /*
+  * Gets the number of majority-minority districts in the best plan.
+  *
+  * @return the best objective found so far
+  */
+  uint32_t GetBestCount() const { return best_->GetNumMajorityMinority(); }
+
+ private:
+  // Runs one burst from the best plan.
+  void RunBurst(uint32_t burst, uint32_t burst_length);
+
+  // The plan every round starts from.
+  Graph *best_;
+
+  // The Runners of the bursts and the graphs they walk on.
+  vector<Runner *> bursts_;
+  vector<Graph *> graphs_;
+
+  // Runs the bursts.
+  ThreadPool pool_;
+};        // class ShortBursts
+
+}         // namespace rakan
+
+#endif    // SRC_SHORTBURSTS_H_
@@ -0,0 +1,166 @@
+#include "./SpanningTree.h"
+
+#include <inttypes.h>         // for uint32_t, uint64_t
+
+#include <algorithm>          // for std::fill
+#include <vector>             // for std::vector
+
+#include "./Graph.h"          // for Graph class
+#include "./Rng.h"            // for Rng class
+
+namespace rakan {
+
+///////////////////////////////////////////////////////////////////////////////
+// Constructors and destructors
+///////////////////////////////////////////////////////////////////////////////
+
+SpanningTree::SpanningTree()
+    : graph_(nullptr),
+      stamp_(0),
+      root_(0),
+      total_pop_(0) {}
+
+SpanningTree::~SpanningTree() {}
+
+void SpanningTree::Reserve(Graph *graph) {
+  uint32_t n = graph->num_nodes_;
+
+  graph_ = graph;
+  order_.reserve(n);
+  in_region_.assign(n, 0);
+  in_tree_.assign(n, 0);
+  stamp_ = 0;
+  parent_.resize(n);
+  next_.resize(n);
+  first_child_.resize(n);
+  next_sibling_.resize(n);
+  subtree_pop_.resize(n);
+  cuts_.reserve(n);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Mutators
+///////////////////////////////////////////////////////////////////////////////
+
+void SpanningTree::Draw(Graph *graph, const vector<uint32_t> &nodes,
+                        Rng *rng) {
+  uint32_t i, u, v, stamp, none = graph->num_nodes_;
+
+  if (graph != graph_ || in_region_.size() < graph->num_nodes_) {
+    Reserve(graph);
+  }
+
+  stamp = NextStamp();
+  for (auto &node : nodes) {
+    in_region_[node] = stamp;
+  }
+
+  root_ = nodes[rng->UniformInt(nodes.size())];
+  in_tree_[root_] = stamp;
+  parent_[root_] = none;
+
+  // Wilson's algorithm: from each node outside the tree, take a random walk
+  // until it hits the tree, then add the loop-erased path. Overwriting next_
+  // on every visit erases the loops implicitly.
+  for (auto &start : nodes) {
+    for (u = start; in_tree_[u] != stamp; u = next_[u]) {
+      next_[u] = RandomRegionNeighbor(u, rng);
+    }
+    for (u = start; in_tree_[u] != stamp; u = next_[u]) {
+      in_tree_[u] = stamp;
+      parent_[u] = next_[u];
+    }
+  }
+
+  for (auto &node : nodes) {
+    first_child_[node] = none;
+  }
+  for (auto &node : nodes) {
+    if (node != root_) {
+      next_sibling_[node] = first_child_[parent_[node]];
+      first_child_[parent_[node]] = node;
+    }
+  }
+
+  // Order the nodes so that every parent comes before its children.
+  order_.clear();
+  order_.push_back(root_);
+  for (i = 0; i < order_.size(); i++) {
+    for (v = first_child_[order_[i]]; v != none; v = next_sibling_[v]) {
+      order_.push_back(v);
+    }
+  }
+
+  for (auto &node : nodes) {
+    subtree_pop_[node] = graph_->pop_of_node_[node];
+  }
+  for (i = order_.size() - 1; i > 0; i--) {
+    v = order_[i];
+    subtree_pop_[parent_[v]] += subtree_pop_[v];
+  }
+  total_pop_ = subtree_pop_[root_];
+}
+
+uint32_t SpanningTree::FindBalancedCuts(double lower, double upper) {
+  return FindCuts(lower, upper, lower, upper);
+}
+
+uint32_t SpanningTree::FindCuts(double lower, double upper,
+                                double rest_lower, double rest_upper) {
+  uint32_t i;
+  uint64_t pop;
+
+  cuts_.clear();
+  for (i = 1; i < order_.size(); i++) {
+    pop = subtree_pop_[order_[i]];
+    if (pop >= lower && pop <= upper &&
+        total_pop_ - pop >= rest_lower && total_pop_ - pop <= rest_upper) {
+      cuts_.push_back(order_[i]);
+    }
+  }
+
+  return cuts_.size();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Queries
+///////////////////////////////////////////////////////////////////////////////
+
+void SpanningTree::GetSubtree(uint32_t node, vector<uint32_t> *subtree) const {
+  uint32_t i, v, none = graph_->num_nodes_;
+
+  subtree->clear();
+  subtree->push_back(node);
+  for (i = 0; i < subtree->size(); i++) {
+    for (v = first_child_[(*subtree)[i]]; v != none; v = next_sibling_[v]) {
+      subtree->push_back(v);
+    }
+  }
+}
+
+uint32_t SpanningTree::RandomRegionNeighbor(uint32_t node, Rng *rng) const {
+  uint32_t begin = graph_->adj_offsets_[node];
+  uint32_t degree = graph_->adj_offsets_[node + 1] - begin;
+  uint32_t neighbor;
+
+  // The region is connected, so some neighbor is always inside it.
+  do {
+    neighbor = graph_->adj_[begin + rng->UniformInt(degree)];
+  } while (in_region_[neighbor] != stamp_);
+
+  return neighbor;
+}
+
+uint32_t SpanningTree::NextStamp() {
+  if (++stamp_ == 0) {
+    // The stamp wrapped around; forget every old region.
+    std::fill(in_region_.begin(), in_region_.end(), 0);
+    std::fill(in_tree_.begin(), in_tree_.end(), 0);
+    stamp_ = 1;
+  }
+  return stamp_;
+}
+
+}   // namespace rakan
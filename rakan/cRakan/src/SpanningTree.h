@@ -0,0 +1,162 @@
+#ifndef SRC_SPANNINGTREE_H_
+#define SRC_SPANNINGTREE_H_
+
+#include <inttypes.h>         // for uint32_t, uint64_t
+
+#include <vector>             // for std::vector
+
+#include "./Graph.h"          // for Graph class
+#include "./Rng.h"            // for Rng class
+
+using std::vector;
+
+namespace rakan {
+
+/*
+* A uniformly random spanning tree of a connected region of a graph, drawn
+* with Wilson's algorithm. Once drawn, the tree can be searched for edges
+* whose removal splits the region into two parts with populations inside a
+* given range.
+*
+* All buffers are kept between draws, so repeated draws over regions of at
+* most the same size do not allocate.
+*/
+class SpanningTree {
+ public:
+  /////////////////////////////////////////////////////////////////////////////
+  // Constructors and destructors
+  /////////////////////////////////////////////////////////////////////////////
+
+  /*
+  * Default constructor. The tree is empty until Draw is called.
+  */
+  SpanningTree();
+
+  /*
+  * Default destructor.
+  */
+  ~SpanningTree();
+
+  /*
+  * Sizes the tree's buffers for the given graph, so that later draws on it
+  * do not allocate.
+  *
+  * @param    graph   the graph that trees will be drawn on
+  */
+  void Reserve(Graph *graph);
+
+  /////////////////////////////////////////////////////////////////////////////
+  // Mutators
+  /////////////////////////////////////////////////////////////////////////////
+
+  /*
+  * Draws a uniformly random spanning tree of the subgraph induced by the
+  * given nodes. The graph's flattened adjacency must be built, and the
+  * induced subgraph must be connected.
+  *
+  * @param    graph   the graph the nodes belong to
+  * @param    nodes   the IDs of the nodes of the region; must be non-empty
+  * @param    rng     the random number generator to draw from
+  */
+  void Draw(Graph *graph, const vector<uint32_t> &nodes, Rng *rng);
+
+  /*
+  * Finds every tree edge whose removal leaves both parts with a population
+  * in [lower, upper]. Each such edge is identified by its child endpoint.
+  *
+  * @param    lower   the smallest allowed population of either part
+  * @param    upper   the largest allowed population of either part
+  *
+  * @return the number of balanced cut edges found
+  */
+  uint32_t FindBalancedCuts(double lower, double upper);
+
+  /*
+  * Finds every tree edge whose removal leaves the part below the edge with
+  * a population in [lower, upper] and the part above it, which holds the
+  * root, with a population in [rest_lower, rest_upper]. Each such edge is
+  * identified by its child endpoint.
+  *
+  * @param    lower         the smallest allowed population below the edge
+  * @param    upper         the largest allowed population below the edge
+  * @param    rest_lower    the smallest allowed population above the edge
+  * @param    rest_upper    the largest allowed population above the edge
+  *
+  * @return the number of cut edges found
+  */
+  uint32_t FindCuts(double lower, double upper,
+                    double rest_lower, double rest_upper);
+
+  /////////////////////////////////////////////////////////////////////////////
+  // Queries
+  /////////////////////////////////////////////////////////////////////////////
+
+  /*
+  * Gets a cut edge found by the last call to FindBalancedCuts or
+  * FindCuts.
+  *
+  * @param    index   the index of the cut, less than the number found
+  *
+  * @return the child endpoint of the cut edge
+  */
+  uint32_t GetCut(uint32_t index) const { return cuts_[index]; }
+
+  /*
+  * Gets the population of the region the tree spans.
+  *
+  * @return the total population of the region
+  */
+  uint64_t GetTotalPop() const { return total_pop_; }
+
+  /*
+  * Gets the nodes below the given node in the tree, the node included.
+  * These form one side of the cut made at the node's parent edge.
+  *
+  * @param    node      the root of the subtree
+  * @param    subtree   the return parameter for the subtree's node IDs
+  */
+  void GetSubtree(uint32_t node, vector<uint32_t> *subtree) const;
+
+ private:
+  // Gets a uniformly random neighbor of the node inside the region.
+  uint32_t RandomRegionNeighbor(uint32_t node, Rng *rng) const;
+
+  // Starts a new draw and returns its stamp.
+  uint32_t NextStamp();
+
+  // The graph the current tree was drawn on.
+  Graph *graph_;
+
+  // The nodes of the region, ordered so that parents precede children.
+  vector<uint32_t> order_;
+
+  // A node is in the region iff its entry equals stamp_, and in the tree
+  // built so far iff its entry in in_tree_ equals stamp_.
+  vector<uint32_t> in_region_;
+  vector<uint32_t> in_tree_;
+  uint32_t stamp_;
+
+  // The tree's parent pointers, and the next node of the current walk in
+  // Wilson's algorithm. The root's parent is the number of nodes.
+  vector<uint32_t> parent_;
+  vector<uint32_t> next_;
+
+  // The children of each node as intrusive lists, terminated by the number
+  // of nodes.
+  vector<uint32_t> first_child_;
+  vector<uint32_t> next_sibling_;
+
+  // The population of the subtree below each node.
+  vector<uint64_t> subtree_pop_;
+
+  // The cut edges found by the last search.
+  vector<uint32_t> cuts_;
+
+  // The root of the current tree and the population it spans.
+  uint32_t root_;
+  uint64_t total_pop_;
+};        // class SpanningTree
+
+}         // namespace rakan
+
+#endif    // SRC_SPANNINGTREE_H_
@@ -0,0 +1,102 @@
+#include "./ThreadPool.h"
+
+#include <inttypes.h>         // for uint32_t, uint64_t
+
+#include <functional>         // for std::function
+#include <mutex>              // for std::mutex, std::unique_lock
+#include <thread>             // for std::thread
+
+namespace rakan {
+
+///////////////////////////////////////////////////////////////////////////////
+// Constructors and destructors
+///////////////////////////////////////////////////////////////////////////////
+
+ThreadPool::ThreadPool(uint32_t num_threads)
+    : task_(nullptr),
+      num_tasks_(0),
+      generation_(0),
+      next_task_(0),
+      busy_workers_(0),
+      stop_(false) {
+  uint32_t i;
+
+  if (num_threads == 0) {
+    num_threads = std::thread::hardware_concurrency();
+  }
+  for (i = 1; i < num_threads; i++) {
+    workers_.push_back(std::thread(&ThreadPool::WorkerLoop, this));
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  work_ready_.notify_all();
+
+  for (auto &worker : workers_) {
+    worker.join();
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Execution
+///////////////////////////////////////////////////////////////////////////////
+
+void ThreadPool::ParallelFor(uint32_t num_tasks,
+                             const std::function<void(uint32_t)> &task) {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    task_ = &task;
+    num_tasks_ = num_tasks;
+    next_task_ = 0;
+    busy_workers_ = workers_.size();
+    generation_++;
+  }
+  work_ready_.notify_all();
+
+  RunTasks();
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  work_done_.wait(lock, [this] { return busy_workers_ == 0; });
+  task_ = nullptr;
+}
+
+void ThreadPool::WorkerLoop() {
+  uint64_t seen_generation = 0;
+
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      work_ready_.wait(lock, [this, seen_generation] {
+        return stop_ || generation_ != seen_generation;
+      });
+      if (stop_) {
+        return;
+      }
+      seen_generation = generation_;
+    }
+
+    RunTasks();
+
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (--busy_workers_ == 0) {
+        work_done_.notify_one();
+      }
+    }
+  }
+}
+
+void ThreadPool::RunTasks() {
+  uint32_t i;
+
+  while ((i = next_task_++) < num_tasks_) {
+    (*task_)(i);
+  }
+}
+
+}   // namespace rakan
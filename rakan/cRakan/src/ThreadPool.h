@@ -0,0 +1,97 @@
+#ifndef SRC_THREADPOOL_H_
+#define SRC_THREADPOOL_H_
+
+#include <inttypes.h>         // for uint32_t, uint64_t
+
+#include <atomic>             // for std::atomic
+#include <condition_variable> // for std::condition_variable
+#include <functional>         // for std::function
+#include <mutex>              // for std::mutex
+#include <thread>             // for std::thread
+#include <vector>             // for std::vector
+
+namespace rakan {
+
+/*
+* A fixed pool of worker threads for fork-join parallel loops. The calling
+* thread takes part in every loop, so a pool of one thread runs loops
+* inline.
+*/
+class ThreadPool {
+ public:
+  /////////////////////////////////////////////////////////////////////////////
+  // Constructors and destructors
+  /////////////////////////////////////////////////////////////////////////////
+
+  /*
+  * Starts a pool with the given number of threads, the calling thread
+  * included.
+  *
+  * @param    num_threads   the number of threads; 0 uses one per hardware
+  *                         thread
+  */
+  explicit ThreadPool(uint32_t num_threads);
+
+  /*
+  * Stops and joins all worker threads.
+  */
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &other) = delete;
+  ThreadPool &operator=(const ThreadPool &other) = delete;
+
+  /////////////////////////////////////////////////////////////////////////////
+  // Execution
+  /////////////////////////////////////////////////////////////////////////////
+
+  /*
+  * Runs task(i) for every i in [0, num_tasks) across the pool, and returns
+  * once all of them have finished. Tasks must not call ParallelFor on the
+  * same pool.
+  *
+  * @param    num_tasks   the number of tasks to run
+  * @param    task        the task to run, given its index
+  */
+  void ParallelFor(uint32_t num_tasks,
+                   const std::function<void(uint32_t)> &task);
+
+  /*
+  * Gets the number of threads in the pool, the calling thread included.
+  *
+  * @return the number of threads
+  */
+  uint32_t GetNumThreads() const { return workers_.size() + 1; }
+
+ private:
+  // The loop run by each worker thread.
+  void WorkerLoop();
+
+  // Claims and runs tasks of the current loop until none are left.
+  void RunTasks();
+
+  // The worker threads, not including the calling thread.
+  std::vector<std::thread> workers_;
+
+  // Guards the fields below and signals workers and the caller.
+  std::mutex mutex_;
+  std::condition_variable work_ready_;
+  std::condition_variable work_done_;
+
+  // The current loop. generation_ changes every time a loop starts.
+  const std::function<void(uint32_t)> *task_;
+  uint32_t num_tasks_;
+  uint64_t generation_;
+
+  // The index of the next unclaimed task of the current loop.
+  std::atomic<uint32_t> next_task_;
+
+  // The number of workers still running tasks of the current loop.
+  uint32_t busy_workers_;
+
+  // Whether the pool is shutting down.
+  bool stop_;
+};        // class ThreadPool
+
+}         // namespace rakan
+
+#endif    // SRC_THREADPOOL_H_
@@ -0,0 +1,68 @@
+#include <inttypes.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <new>
+
+#include "../src/Graph.h"
+#include "../src/Runner.h"
+#include "./test_grid.h"
+
+#include "gtest/gtest.h"
+
+/*
+* The number of heap allocations made through operator new by any thread
+* since the test binary started.
+*/
+static std::atomic<uint64_t> allocation_count(0);
+
+void *operator new(size_t size) {
+  allocation_count++;
+  void *ptr = malloc(size == 0 ? 1 : size);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void operator delete(void *ptr) noexcept {
+  free(ptr);
+}
+
+void operator delete(void *ptr, size_t size) noexcept {
+  free(ptr);
+}
+
+namespace rakan {
+
+// Tests that walking makes no heap allocations once the Runner is warm.
+TEST(Test_Allocation, TestWalkDoesNotAllocate) {
+  Graph *g = MakeGrid(10, 10, 4);
+  Runner runner(g);
+  runner.SetWeights(1, 1, 0, 1);
+  runner.SetPopulationTolerance(0.5);
+  ASSERT_EQ(runner.PopulateGraphData(), 0);
+
+  runner.Walk(1000);
+  vector<uint32_t> plan(g->GetNumNodes());
+  for (uint32_t i = 0; i < g->GetNumNodes(); i++) {
+    plan[i] = g->GetDistrictOf(i);
+  }
+
+  uint64_t before = allocation_count;
+  runner.Walk(5000);
+  uint64_t after = allocation_count;
+  ASSERT_GT(before, 0);
+  ASSERT_EQ(after - before, 0);
+
+  // The walk must actually have moved nodes for the count to mean much.
+  bool moved = false;
+  for (uint32_t i = 0; i < g->GetNumNodes(); i++) {
+    moved |= plan[i] != g->GetDistrictOf(i);
+  }
+  ASSERT_TRUE(moved);
+
+  DeleteGrid(g);
+}
+
+}   // namespace rakan
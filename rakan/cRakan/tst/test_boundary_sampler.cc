@@ -0,0 +1,71 @@
+#include <inttypes.h>
+
+#include "../src/BoundarySampler.h"
+#include "../src/Graph.h"
+#include "../src/Node.h"
+#include "../src/Runner.h"
+#include "./test_grid.h"
+
+#include "gtest/gtest.h"
+
+namespace rakan {
+
+// Tests that every boundary move of a fresh plan carries one unit of weight.
+TEST(Test_BoundarySampler, TestBuild) {
+  Graph *g = MakeGrid(4, 4, 2);
+  Runner runner(g);
+  ASSERT_EQ(runner.PopulateGraphData(), 0);
+  BoundarySampler sampler;
+  sampler.Build(g);
+
+  // Columns 1 and 2 face each other across the district border.
+  ASSERT_DOUBLE_EQ(sampler.Total(), 8);
+  ASSERT_DOUBLE_EQ(sampler.Weight(1, 1), 1);
+  ASSERT_DOUBLE_EQ(sampler.Weight(2, 0), 1);
+  ASSERT_DOUBLE_EQ(sampler.Weight(0, 1), 0);
+  ASSERT_DOUBLE_EQ(sampler.Probability(5, 1), 1.0 / 8);
+
+  uint32_t node, district;
+  for (int i = 0; i < 100; i++) {
+    ASSERT_TRUE(sampler.Sample(i / 100.0, &node, &district));
+    ASSERT_NE(g->GetDistrictOf(node), district);
+    ASSERT_GT(sampler.Weight(node, district), 0);
+  }
+
+  DeleteGrid(g);
+}
+
+// Tests that incremental updates and predicted reverse probabilities agree
+// with a sampler rebuilt from scratch.
+TEST(Test_BoundarySampler, TestUpdateMove) {
+  Graph *g = MakeGrid(4, 4, 2);
+  Runner runner(g);
+  ASSERT_EQ(runner.PopulateGraphData(), 0);
+  BoundarySampler sampler;
+  sampler.SetWeightFunction([](uint32_t node, uint32_t district) {
+    return 1.0 + node + district;
+  });
+  sampler.Build(g);
+
+  double reverse = sampler.ReverseProbability(5, 1);
+  g->RemoveNodeFromDistrict(g->GetNode(5), 0);
+  g->AddNodeToDistrict(g->GetNode(5), 1);
+  sampler.UpdateMove(5);
+  ASSERT_NEAR(sampler.Probability(5, 0), reverse, 1e-12);
+
+  BoundarySampler rebuilt;
+  rebuilt.SetWeightFunction([](uint32_t node, uint32_t district) {
+    return 1.0 + node + district;
+  });
+  rebuilt.Build(g);
+  ASSERT_NEAR(sampler.Total(), rebuilt.Total(), 1e-9);
+  for (uint32_t i = 0; i < g->GetNumNodes(); i++) {
+    for (uint32_t d = 0; d < g->GetNumDistricts(); d++) {
+      ASSERT_DOUBLE_EQ(sampler.Weight(i, d), rebuilt.Weight(i, d));
+    }
+  }
+
+  DeleteGrid(g);
+}
+
+}   // namespace rakan
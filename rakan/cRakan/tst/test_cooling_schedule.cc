@@ -0,0 +1,75 @@
+#include <inttypes.h>
+
+#include "../src/BoundarySampler.h"
+#include "../src/CoolingSchedule.h"
+#include "../src/Graph.h"
+#include "../src/Runner.h"
+#include "./test_grid.h"
+
+#include "gtest/gtest.h"
+
+namespace rakan {
+
+// Tests the temperatures produced by each schedule.
+TEST(Test_CoolingSchedule, TestSchedules) {
+  GeometricCooling geometric(8, 0.5);
+  geometric.Update(true);
+  geometric.Update(false);
+  ASSERT_DOUBLE_EQ(geometric.GetTemperature(), 2);
+  geometric.Reset();
+  ASSERT_DOUBLE_EQ(geometric.GetTemperature(), 8);
+
+  LinearCooling linear(10, 2, 4);
+  linear.Update(true);
+  ASSERT_DOUBLE_EQ(linear.GetTemperature(), 8);
+  for (int i = 0; i < 10; i++) {
+    linear.Update(true);
+  }
+  ASSERT_DOUBLE_EQ(linear.GetTemperature(), 2);
+
+  AdaptiveCooling adaptive(1, 0.5, 4, 0.5);
+  for (int i = 0; i < 4; i++) {
+    adaptive.Update(true);
+  }
+  ASSERT_DOUBLE_EQ(adaptive.GetTemperature(), 0.5);
+  for (int i = 0; i < 4; i++) {
+    adaptive.Update(i == 0);
+  }
+  ASSERT_DOUBLE_EQ(adaptive.GetTemperature(), 1);
+}
+
+// Tests that annealing ends on the best plan it saw, both when the best
+// plan is held in the journal and when it has been snapshotted.
+TEST(Test_CoolingSchedule, TestAnneal) {
+  Graph *g = MakeGrid(10, 10, 4);
+  Runner runner(g);
+  runner.SetWeights(1, 1, 0, 0);
+  runner.SetPopulationTolerance(0.5);
+  runner.SetSeed(3);
+  ASSERT_EQ(runner.PopulateGraphData(), 0);
+
+  double initial = runner.LogScore();
+  GeometricCooling cooling(5, 0.999);
+  double best = runner.Anneal(&cooling, 5000, 0);
+  ASSERT_LE(best, initial);
+  ASSERT_NEAR(runner.LogScore(), best, 1e-9);
+  ASSERT_EQ(runner.GetInverseTemperature(), 1);
+  ASSERT_TRUE(AllDistrictsContiguous(g));
+
+  BoundarySampler rebuilt;
+  rebuilt.Build(g);
+  ASSERT_NEAR(runner.GetSampler()->Total(), rebuilt.Total(), 1e-9);
+
+  // A very hot walk wanders far from its best plan, so the journal
+  // overflows into a snapshot.
+  LinearCooling hot(1e6, 1e6, 1);
+  best = runner.Anneal(&hot, 5000, 0);
+  ASSERT_NEAR(runner.LogScore(), best, 1e-9);
+  ASSERT_TRUE(AllDistrictsContiguous(g));
+  rebuilt.Build(g);
+  ASSERT_NEAR(runner.GetSampler()->Total(), rebuilt.Total(), 1e-9);
+
+  DeleteGrid(g);
+}
+
+}   // namespace rakan
@@ -0,0 +1,65 @@
+#include <inttypes.h>
+
+#include <vector>
+
+#include "../src/Ensemble.h"
+#include "../src/Graph.h"
+#include "../src/Runner.h"
+#include "./test_grid.h"
+
+#include "gtest/gtest.h"
+
+namespace rakan {
+
+/*
+* Runs an ensemble with the given number of threads and records the score
+* of every sample of every chain, and the final plan of every chain.
+*/
+static void RunEnsemble(uint32_t num_threads,
+                        vector<vector<double>> *scores,
+                        vector<vector<uint32_t>> *plans) {
+  Graph *g = MakeGrid(8, 8, 4);
+  Runner base(g);
+  base.SetWeights(1, 1, 0, 1);
+  base.SetPopulationTolerance(0.5);
+  ASSERT_EQ(base.PopulateGraphData(), 0);
+
+  Ensemble ensemble(&base, 5, num_threads);
+  ensemble.SetSeed(99);
+  scores->assign(ensemble.GetNumChains(), vector<double>());
+  ensemble.SetSink([scores](uint32_t chain, uint64_t sample, Runner *runner) {
+    ASSERT_EQ((*scores)[chain].size(), sample);
+    (*scores)[chain].push_back(runner->LogScore());
+  });
+  ensemble.Run(30, 50);
+
+  plans->assign(ensemble.GetNumChains(), vector<uint32_t>());
+  for (uint32_t c = 0; c < ensemble.GetNumChains(); c++) {
+    Graph *chain_graph = ensemble.GetChain(c)->GetGraph();
+    for (uint32_t i = 0; i < chain_graph->GetNumNodes(); i++) {
+      (*plans)[c].push_back(chain_graph->GetDistrictOf(i));
+    }
+  }
+
+  DeleteGrid(g);
+}
+
+// Tests that the chains' samples do not depend on the number of threads.
+TEST(Test_Ensemble, TestDeterministicAcrossThreads) {
+  vector<vector<double>> serial_scores, parallel_scores;
+  vector<vector<uint32_t>> serial_plans, parallel_plans;
+
+  RunEnsemble(1, &serial_scores, &serial_plans);
+  RunEnsemble(3, &parallel_scores, &parallel_plans);
+
+  ASSERT_EQ(serial_scores, parallel_scores);
+  ASSERT_EQ(serial_plans, parallel_plans);
+  for (auto &chain_scores : serial_scores) {
+    ASSERT_EQ(chain_scores.size(), 30);
+  }
+
+  // Independent streams give the chains different paths.
+  ASSERT_NE(serial_plans[0], serial_plans[1]);
+}
+
+}   // namespace rakan
@@ -0,0 +1,186 @@
+#include <inttypes.h>
+
+#include <vector>
+
+#include "../enumerate/Enumerator.h"
+#include "../src/Graph.h"
+#include "../src/ReturnCodes.h"
+#include "../src/Runner.h"
+#include "./test_grid.h"
+
+#include "gtest/gtest.h"
+
+namespace rakan {
+
+// Counts the plans of a grid by trying every labeling.
+static uint64_t BruteForce(uint32_t rows, uint32_t cols, uint32_t k,
+                           double tolerance) {
+  uint32_t n = rows * cols, v, d;
+  uint64_t labeling, code, total = 1, count = 0;
+  double ideal = ((double) n) / k;
+
+  for (v = 0; v < n; v++) {
+    total *= k;
+  }
+  Graph *g = MakeGrid(rows, cols, k);
+  for (labeling = 0; labeling < total; labeling++) {
+    code = labeling;
+    for (v = 0; v < n; v++) {
+      g->GetNode(v)->SetDistrict(code % k);
+      code /= k;
+    }
+    Runner runner(g);
+    if (runner.PopulateGraphData() != SUCCESS || !AllDistrictsContiguous(g)) {
+      continue;
+    }
+    bool valid = true;
+    for (d = 0; d < k; d++) {
+      valid = valid && g->GetDistrictSize(d) > 0;
+      if (tolerance > 0) {
+        valid = valid && g->GetDistrictPop(d) >= ideal * (1 - tolerance) &&
+                g->GetDistrictPop(d) <= ideal * (1 + tolerance);
+      }
+    }
+    count += valid;
+  }
+  DeleteGrid(g);
+  return count;
+}
+
+// Tests the counts against known values and against trying every
+// labeling, and that listing finds each partition once.
+TEST(Test_Enumerator, TestCount) {
+  Graph *g = MakeGrid(2, 2, 2);
+  g->BuildAdjacency();
+  Enumerator square(g);
+  ASSERT_EQ(square.Count(2, 0), 12);
+  ASSERT_EQ(square.Count(1, 0), 1);
+  ASSERT_EQ(square.Count(4, 0), 24);
+  ASSERT_EQ(square.Count(5, 0), 0);
+  DeleteGrid(g);
+
+  const uint32_t shapes[][4] = {
+    {3, 3, 3, 0}, {2, 4, 2, 0}, {3, 3, 3, 20}, {2, 5, 2, 20}, {3, 3, 2, 50}
+  };
+  for (auto &shape : shapes) {
+    double tolerance = shape[3] / 100.0;
+    g = MakeGrid(shape[0], shape[1], shape[2]);
+    g->BuildAdjacency();
+    Enumerator enumerator(g);
+    uint64_t count = enumerator.Count(shape[2], tolerance);
+    ASSERT_EQ(count, BruteForce(shape[0], shape[1], shape[2], tolerance));
+
+    ASSERT_TRUE(enumerator.List(shape[2], tolerance, count));
+    uint64_t labelings = enumerator.GetNumListed();
+    for (uint32_t d = 2; d <= shape[2]; d++) {
+      labelings *= d;
+    }
+    ASSERT_EQ(labelings, count);
+    for (uint64_t plan = 0; plan < enumerator.GetNumListed(); plan++) {
+      for (uint32_t v = 0; v < g->GetNumNodes(); v++) {
+        g->GetNode(v)->SetDistrict(enumerator.GetPlan(plan)[v]);
+      }
+      Runner runner(g);
+      ASSERT_EQ(runner.PopulateGraphData(), SUCCESS);
+      ASSERT_TRUE(AllDistrictsContiguous(g));
+    }
+    if (enumerator.GetNumListed() > 1) {
+      ASSERT_FALSE(enumerator.List(shape[2], tolerance, 1));
+      ASSERT_EQ(enumerator.GetNumListed(), 0);
+    }
+    DeleteGrid(g);
+  }
+}
+
+// Tests a count out of reach of trying every labeling: a 6x6 grid has
+// 1123743 partitions into two connected pieces (OEIS A068416).
+TEST(Test_Enumerator, TestCountLarge) {
+  Graph *g = MakeGrid(6, 6, 2);
+  g->BuildAdjacency();
+  Enumerator enumerator(g);
+  ASSERT_EQ(enumerator.Count(2, 0), 2 * 1123743ULL);
+  ASSERT_LE(enumerator.GetMaxStates(), 10000);
+  DeleteGrid(g);
+
+  g = MakeGrid(8, 8, 2);
+  g->BuildAdjacency();
+  Enumerator larger(g);
+  ASSERT_EQ(larger.Count(2, 0), 2 * 127561384993ULL);
+  DeleteGrid(g);
+}
+
+// Tests that counts that do not fit in 64 bits saturate: a path of n nodes
+// has one partition into n districts, and n! labelings.
+TEST(Test_Enumerator, TestCountOverflow) {
+  Graph *g = MakeGrid(1, 20, 20);
+  g->BuildAdjacency();
+  Enumerator fits(g);
+  ASSERT_EQ(fits.Count(20, 0), 2432902008176640000ULL);
+  DeleteGrid(g);
+
+  g = MakeGrid(1, 21, 21);
+  g->BuildAdjacency();
+  Enumerator overflows(g);
+  ASSERT_EQ(overflows.Count(21, 0), UINT64_MAX);
+  DeleteGrid(g);
+}
+
+// Tests that a flip walk matches its exact target.
+TEST(Test_Enumerator, TestCompareWalk) {
+  Graph *g = MakeGrid(3, 3, 3);
+  Runner runner(g);
+  runner.SetWeights(0.5, 0, 0, 1);
+  runner.SetPopulationTolerance(0.4);
+  runner.SetSeed(13);
+  ASSERT_EQ(runner.PopulateGraphData(), SUCCESS);
+
+  Enumerator enumerator(g);
+  ASSERT_TRUE(enumerator.List(3, 0.4, 100000));
+  ASSERT_GT(enumerator.GetNumListed(), 1);
+  ASSERT_LT(enumerator.CompareWalk(&runner, 100000, 2), 0.03);
+  DeleteGrid(g);
+}
+
+// Tests that block steps match the same target, with blocks large enough
+// to move a whole district but one.
+TEST(Test_Enumerator, TestCompareBlockWalk) {
+  Graph *g = MakeGrid(3, 3, 3);
+  Runner runner(g);
+  runner.SetWeights(0.5, 0, 0, 1);
+  runner.SetPopulationTolerance(0.4);
+  runner.SetEngine(kBlockEngine);
+  runner.SetMaxBlockSize(3);
+  runner.SetSeed(11);
+  ASSERT_EQ(runner.PopulateGraphData(), SUCCESS);
+
+  Enumerator enumerator(g);
+  ASSERT_TRUE(enumerator.List(3, 0.4, 100000));
+  ASSERT_LT(enumerator.CompareWalk(&runner, 200000, 2), 0.04);
+  ASSERT_GT(runner.GetNumAccepted(), 0);
+  DeleteGrid(g);
+}
+
+// Tests that a mixture of kernels matches the same target once its weights
+// have adapted and stopped.
+TEST(Test_Enumerator, TestCompareMixtureWalk) {
+  Graph *g = MakeGrid(3, 3, 3);
+  Runner runner(g);
+  runner.SetWeights(0.5, 0, 0, 1);
+  runner.SetPopulationTolerance(0.4);
+  runner.SetEngine(kMixtureEngine);
+  runner.SetKernelWeight(kFlipEngine, 1);
+  runner.SetKernelWeight(kLiftedEngine, 1);
+  runner.SetKernelWeight(kBlockEngine, 1);
+  runner.SetMaxBlockSize(3);
+  runner.SetBurnIn(20000);
+  runner.SetSeed(3);
+  ASSERT_EQ(runner.PopulateGraphData(), SUCCESS);
+  runner.Walk(20000);
+
+  Enumerator enumerator(g);
+  ASSERT_TRUE(enumerator.List(3, 0.4, 100000));
+  ASSERT_LT(enumerator.CompareWalk(&runner, 200000, 2), 0.04);
+  DeleteGrid(g);
+}
+
+}   // namespace rakan
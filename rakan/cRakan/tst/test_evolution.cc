@@ -0,0 +1,59 @@
+#include <inttypes.h>
+
+#include <vector>
+
+#include "../src/Evolution.h"
+#include "../src/Graph.h"
+#include "../src/ReturnCodes.h"
+#include "../src/Runner.h"
+#include "./test_grid.h"
+
+#include "gtest/gtest.h"
+
+namespace rakan {
+
+// Tests that evolution improves on a seeded plan, keeps valid plans
+// ranked by score, and does not depend on the number of threads.
+TEST(Test_Evolution, TestRun) {
+  Graph *g = MakeGrid(12, 12, 4);
+  Runner base(g);
+  base.SetWeights(1, 0, 0, 0);
+  base.SetPopulationTolerance(0.1);
+  base.SetSeed(8);
+  ASSERT_EQ(base.SeedDistricts(), SUCCESS);
+  ASSERT_EQ(base.PopulateGraphData(), SUCCESS);
+  ASSERT_EQ(base.RepairPopulation(), SUCCESS);
+  double initial = base.LogScore();
+
+  Evolution one(&base, 12, 1);
+  Evolution three(&base, 12, 3);
+  one.SetSeed(31);
+  three.SetSeed(31);
+  double best = one.Run(15, 30);
+  ASSERT_EQ(three.Run(15, 30), best);
+  ASSERT_EQ(one.GetNumGenerations(), 15);
+  ASSERT_LT(best, initial * 0.8);
+
+  std::vector<uint32_t> plan(144), other(144);
+  for (uint32_t rank = 0; rank < one.GetPopulationSize(); rank++) {
+    one.GetPlan(rank, plan.data());
+    three.GetPlan(rank, other.data());
+    ASSERT_EQ(plan, other);
+    if (rank > 0) {
+      ASSERT_GE(one.GetScore(rank), one.GetScore(rank - 1));
+    }
+
+    // Every plan is valid and scored as a Runner would score it.
+    ASSERT_EQ(base.SetDistricts(plan.data()), SUCCESS);
+    ASSERT_DOUBLE_EQ(base.LogScore(), one.GetScore(rank));
+    ASSERT_TRUE(AllDistrictsContiguous(g));
+    for (uint32_t d = 0; d < 4; d++) {
+      ASSERT_GE(g->GetDistrictPop(d), 36 * 0.9);
+      ASSERT_LE(g->GetDistrictPop(d), 36 * 1.1);
+    }
+  }
+
+  DeleteGrid(g);
+}
+
+}   // namespace rakan
@@ -1,7 +1,13 @@
 #include <inttypes.h>
 
+#include <algorithm>
+#include <vector>
+
 #include "../src/Graph.h"
 #include "../src/Node.h"
+#include "../src/Runner.h"
+#include "../src/ThreadPool.h"
+#include "./test_grid.h"
 
 #include "gtest/gtest.h"
 
@@ -47,4 +53,94 @@ TEST(Test_Graph, TestAddMultiple) {
   ASSERT_EQ(g.GetNode(1), &n1);
 }
 
+// Tests that a copied graph keeps its own plan but shares the nodes.
+TEST(Test_Graph, TestCopy) {
+  Graph *g = MakeGrid(4, 4, 2);
+  Runner runner(g);
+  ASSERT_EQ(runner.PopulateGraphData(), 0);
+
+  Graph copy(*g);
+  ASSERT_EQ(copy.GetNode(5), g->GetNode(5));
+  ASSERT_EQ(copy.GetDistrictOf(5), 0);
+  ASSERT_EQ(copy.GetCutEdges(0), g->GetCutEdges(0));
+
+  copy.RemoveNodeFromDistrict(copy.GetNode(5), 0);
+  copy.AddNodeToDistrict(copy.GetNode(5), 1);
+  ASSERT_EQ(copy.GetDistrictOf(5), 1);
+  ASSERT_EQ(copy.GetDistrictSize(1), 9);
+  ASSERT_EQ(g->GetDistrictOf(5), 0);
+  ASSERT_EQ(g->GetDistrictSize(1), 8);
+
+  // Copies, and copies of copies, share the topology of the original and
+  // leave it intact when they are destroyed.
+  Graph *nested = new Graph(copy);
+  ASSERT_EQ(copy.GetNodes(), g->GetNodes());
+  ASSERT_EQ(nested->GetNodes(), g->GetNodes());
+  ASSERT_EQ(nested->GetDistrictSize(1), 9);
+  delete nested;
+  g->RemoveNodeFromDistrict(g->GetNode(5), 0);
+  g->AddNodeToDistrict(g->GetNode(5), 1);
+  ASSERT_EQ(g->GetCutEdges(1), copy.GetCutEdges(1));
+
+  // A copy that rebuilds its adjacency stops sharing.
+  copy.BuildAdjacency();
+  ASSERT_NE(copy.GetNodes(), g->GetNodes());
+  ASSERT_EQ(copy.GetNode(5), g->GetNode(5));
+
+  DeleteGrid(g);
+}
+
+// Tests that assigning a whole plan at once, on any number of threads,
+// builds the same structures as adding its nodes one at a time.
+TEST(Test_Graph, TestAssignDistricts) {
+  Graph *g = MakeGrid(9, 11, 5);
+  uint32_t v, d, threads;
+  vector<uint32_t> plan(99);
+
+  g->BuildAdjacency();
+  for (v = 0; v < 99; v++) {
+    plan[v] = (v / 11 + v % 11) * 5 / 19;
+  }
+  Graph expected(*g);
+  expected.ClearDistricts();
+  for (v = 0; v < 99; v++) {
+    expected.AddNodeToDistrict(g->GetNode(v), plan[v]);
+  }
+
+  for (threads = 1; threads <= 4; threads += 3) {
+    ThreadPool pool(threads);
+    ASSERT_TRUE(g->AssignDistricts(plan.data(), &pool));
+    ASSERT_EQ(g->GetNumMajorityMinority(),
+              expected.GetNumMajorityMinority());
+    for (d = 0; d < 5; d++) {
+      ASSERT_EQ(g->GetDistrictSize(d), expected.GetDistrictSize(d));
+      ASSERT_EQ(g->GetDistrictPop(d), expected.GetDistrictPop(d));
+      ASSERT_EQ(g->GetMinorityPop(d), expected.GetMinorityPop(d));
+      ASSERT_EQ(g->GetCutEdges(d), expected.GetCutEdges(d));
+
+      vector<uint32_t> nodes, expected_nodes, perim, expected_perim;
+      ASSERT_TRUE(g->GetNodesInDistrict(d, &nodes));
+      ASSERT_TRUE(expected.GetNodesInDistrict(d, &expected_nodes));
+      ASSERT_EQ(nodes, expected_nodes);
+      ASSERT_TRUE(g->GetPerimNodes(d, &perim));
+      ASSERT_TRUE(expected.GetPerimNodes(d, &expected_perim));
+      std::sort(perim.begin(), perim.end());
+      std::sort(expected_perim.begin(), expected_perim.end());
+      ASSERT_EQ(perim, expected_perim);
+    }
+
+    // The lists stay consistent under single-node moves.
+    g->RemoveNodeFromDistrict(g->GetNode(40), plan[40]);
+    g->AddNodeToDistrict(g->GetNode(40), (plan[40] + 1) % 5);
+    ASSERT_EQ(g->GetDistrictSize(plan[40]),
+              expected.GetDistrictSize(plan[40]) - 1);
+  }
+
+  plan[7] = 5;
+  ThreadPool pool(2);
+  ASSERT_FALSE(g->AssignDistricts(plan.data(), &pool));
+  ASSERT_EQ(g->GetDistrictSize(0), 0);
+  DeleteGrid(g);
+}
+
 }   // namespace rakan
@@ -0,0 +1,108 @@
+#ifndef TST_TEST_GRID_H_
+#define TST_TEST_GRID_H_
+
+#include <inttypes.h>
+
+#include "../src/Graph.h"
+#include "../src/Node.h"
+
+namespace rakan {
+
+/*
+* Builds a rows x cols grid graph with one person per node, split into
+* num_districts vertical stripes. Every third node is a minority node.
+* The nodes are owned by the caller and released with DeleteGrid.
+*
+* @param    rows            the number of rows in the grid
+* @param    cols            the number of columns in the grid
+* @param    num_districts   the number of districts, must be <= cols
+*
+* @return the newly allocated graph
+*/
+inline Graph *MakeGrid(uint32_t rows, uint32_t cols, uint32_t num_districts) {
+  Graph *g = new Graph(rows * cols, num_districts, rows * cols);
+  uint32_t r, c, id;
+
+  for (r = 0; r < rows; r++) {
+    for (c = 0; c < cols; c++) {
+      id = r * cols + c;
+      Node *node = new Node(id, c * num_districts / cols);
+      node->SetTotalPop(1);
+      node->SetCAPop(id % 3 == 0 ? 0 : 1);
+      g->AddNode(node);
+    }
+  }
+
+  for (r = 0; r < rows; r++) {
+    for (c = 0; c < cols; c++) {
+      id = r * cols + c;
+      if (c + 1 < cols) {
+        g->GetNode(id)->AddNeighbor(*g->GetNode(id + 1));
+        g->GetNode(id + 1)->AddNeighbor(*g->GetNode(id));
+      }
+      if (r + 1 < rows) {
+        g->GetNode(id)->AddNeighbor(*g->GetNode(id + cols));
+        g->GetNode(id + cols)->AddNeighbor(*g->GetNode(id));
+      }
+    }
+  }
+
+  return g;
+}
+
+/*
+* Releases a graph built by MakeGrid along with its nodes.
+*
+* @param    g   the graph to release
+*/
+inline void DeleteGrid(Graph *g) {
+  for (uint32_t i = 0; i < g->GetNumNodes(); i++) {
+    delete g->GetNode(i);
+  }
+  delete g;
+}
+
+/*
+* Queries whether or not every non-empty district of the graph is connected,
+* using the graph's live plan.
+*
+* @param    g   the graph to check
+*
+* @return true iff all districts are contiguous
+*/
+inline bool AllDistrictsContiguous(Graph *g) {
+  uint32_t n = g->GetNumNodes();
+  for (uint32_t d = 0; d < g->GetNumDistricts(); d++) {
+    vector<bool> seen(n, false);
+    vector<uint32_t> stack;
+    uint32_t total = 0, reached = 0;
+    for (uint32_t i = 0; i < n; i++) {
+      if (g->GetDistrictOf(i) == d) {
+        total++;
+        if (stack.empty() && reached == 0) {
+          stack.push_back(i);
+          seen[i] = true;
+        }
+      }
+    }
+    while (!stack.empty()) {
+      uint32_t current = stack.back();
+      stack.pop_back();
+      reached++;
+      for (auto &neighbor : *g->GetNode(current)->GetNeighbors()) {
+        if (!seen[neighbor] && g->GetDistrictOf(neighbor) == d) {
+          seen[neighbor] = true;
+          stack.push_back(neighbor);
+        }
+      }
+    }
+    if (reached != total) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}   // namespace rakan
+
+#endif    // TST_TEST_GRID_H_
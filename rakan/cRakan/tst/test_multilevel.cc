@@ -0,0 +1,66 @@
+#include <inttypes.h>
+
+#include "../src/Graph.h"
+#include "../src/Multilevel.h"
+#include "../src/ReturnCodes.h"
+#include "../src/Runner.h"
+#include "./test_grid.h"
+
+#include "gtest/gtest.h"
+
+namespace rakan {
+
+// Tests that a large grid is coarsened over several levels and split into
+// contiguous districts within the tolerance.
+TEST(Test_Multilevel, TestPartition) {
+  Graph *g = MakeGrid(80, 80, 7);
+  g->BuildAdjacency();
+
+  Multilevel partitioner(g);
+  partitioner.SetSeed(5);
+  ASSERT_EQ(partitioner.Partition(7, 0.02), SUCCESS);
+  ASSERT_GT(partitioner.GetNumLevels(), 2);
+
+  for (uint32_t v = 0; v < g->GetNumNodes(); v++) {
+    ASSERT_LT(partitioner.GetDistrict(v), 7);
+    g->GetNode(v)->SetDistrict(partitioner.GetDistrict(v));
+  }
+  Runner runner(g);
+  ASSERT_EQ(runner.PopulateGraphData(), SUCCESS);
+  ASSERT_TRUE(AllDistrictsContiguous(g));
+  for (uint32_t d = 0; d < 7; d++) {
+    ASSERT_GE(g->GetDistrictPop(d), 6400 / 7.0 * 0.98);
+    ASSERT_LE(g->GetDistrictPop(d), 6400 / 7.0 * 1.02);
+  }
+
+  DeleteGrid(g);
+}
+
+// Tests seeding a Runner through the partitioner, and that disconnected
+// graphs and too many districts are refused.
+TEST(Test_Multilevel, TestSeedRunner) {
+  Graph *g = MakeGrid(30, 40, 5);
+  Runner runner(g);
+  runner.SetPopulationTolerance(0.05);
+  ASSERT_EQ(runner.SeedMultilevelDistricts(), SUCCESS);
+  ASSERT_EQ(runner.PopulateGraphData(), SUCCESS);
+  ASSERT_TRUE(AllDistrictsContiguous(g));
+  for (uint32_t d = 0; d < 5; d++) {
+    ASSERT_GE(g->GetDistrictPop(d), 240 * 0.95);
+    ASSERT_LE(g->GetDistrictPop(d), 240 * 1.05);
+  }
+  DeleteGrid(g);
+
+  g = new Graph(2, 1, 2);
+  Node *a = new Node(0, 0), *b = new Node(1, 0);
+  g->AddNode(a);
+  g->AddNode(b);
+  g->BuildAdjacency();
+  Multilevel disconnected(g);
+  ASSERT_EQ(disconnected.Partition(1, 0.1), SEED_FAILED);
+  ASSERT_EQ(disconnected.GetNumLevels(), 0);
+  ASSERT_EQ(disconnected.Partition(3, 0.1), SEED_FAILED);
+  DeleteGrid(g);
+}
+
+}   // namespace rakan
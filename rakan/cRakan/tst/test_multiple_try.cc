@@ -0,0 +1,79 @@
+#include <inttypes.h>
+
+#include <vector>
+
+#include "../src/Graph.h"
+#include "../src/MultipleTry.h"
+#include "../src/Runner.h"
+#include "./test_grid.h"
+
+#include "gtest/gtest.h"
+
+namespace rakan {
+
+// Tests that walks keep every district contiguous and do not depend on the
+// number of threads.
+TEST(Test_MultipleTry, TestThreadCount) {
+  Graph *one_graph = MakeGrid(6, 6, 3);
+  Graph *three_graph = MakeGrid(6, 6, 3);
+  Runner one_runner(one_graph);
+  Runner three_runner(three_graph);
+  one_runner.SetWeights(1, 0, 0, 0);
+  three_runner.SetWeights(1, 0, 0, 0);
+  one_runner.SetSeed(5);
+  three_runner.SetSeed(5);
+  ASSERT_EQ(one_runner.PopulateGraphData(), 0);
+  ASSERT_EQ(three_runner.PopulateGraphData(), 0);
+
+  MultipleTry one(&one_runner, 8, 1);
+  MultipleTry three(&three_runner, 8, 3);
+  for (int i = 0; i < 20; i++) {
+    one.Walk(25);
+    three.Walk(25);
+    ASSERT_TRUE(AllDistrictsContiguous(one_graph));
+    for (uint32_t v = 0; v < 36; v++) {
+      ASSERT_EQ(one_graph->GetDistrictOf(v), three_graph->GetDistrictOf(v));
+    }
+  }
+  ASSERT_GT(one_runner.GetNumAccepted(), 0);
+  ASSERT_EQ(one_runner.GetNumAccepted(), three_runner.GetNumAccepted());
+
+  DeleteGrid(one_graph);
+  DeleteGrid(three_graph);
+}
+
+// Tests that an unweighted walk on a 2x2 grid visits all 12 contiguous
+// two-district plans equally often.
+TEST(Test_MultipleTry, TestUniform) {
+  Graph *g = MakeGrid(2, 2, 2);
+  Runner runner(g);
+  runner.SetSeed(9);
+  ASSERT_EQ(runner.PopulateGraphData(), 0);
+
+  MultipleTry kernel(&runner, 4, 2);
+  std::vector<uint32_t> visits(16, 0);
+  uint32_t num_steps = 60000, plan, num_plans = 0;
+  for (uint32_t i = 0; i < num_steps; i++) {
+    kernel.Step();
+    plan = 0;
+    for (uint32_t v = 0; v < 4; v++) {
+      plan |= g->GetDistrictOf(v) << v;
+    }
+    visits[plan]++;
+  }
+
+  for (plan = 0; plan < 16; plan++) {
+    // The diagonal splits sever a district; all-0 and all-1 empty one.
+    if (plan == 0 || plan == 15 || plan == 6 || plan == 9) {
+      ASSERT_EQ(visits[plan], 0);
+      continue;
+    }
+    num_plans++;
+    ASSERT_NEAR(visits[plan], num_steps / 12.0, num_steps / 12.0 * 0.1);
+  }
+  ASSERT_EQ(num_plans, 12);
+
+  DeleteGrid(g);
+}
+
+}   // namespace rakan
@@ -0,0 +1,150 @@
+#include <inttypes.h>
+
+#include <vector>
+
+#include "../src/Graph.h"
+#include "../src/ParallelFlip.h"
+#include "../src/Runner.h"
+#include "./test_grid.h"
+
+#include "gtest/gtest.h"
+
+namespace rakan {
+
+// Tests that walks keep the plan valid and the Runner consistent, and do
+// not depend on the number of threads.
+TEST(Test_ParallelFlip, TestThreadCount) {
+  Graph *one_graph = MakeGrid(8, 8, 8);
+  Graph *three_graph = MakeGrid(8, 8, 8);
+  Runner one_runner(one_graph);
+  Runner three_runner(three_graph);
+  one_runner.SetWeights(1, 0, 0, 1);
+  three_runner.SetWeights(1, 0, 0, 1);
+  one_runner.SetPopulationTolerance(0.5);
+  three_runner.SetPopulationTolerance(0.5);
+  one_runner.SetSeed(4);
+  three_runner.SetSeed(4);
+  ASSERT_EQ(one_runner.PopulateGraphData(), 0);
+  ASSERT_EQ(three_runner.PopulateGraphData(), 0);
+
+  ParallelFlip one(&one_runner, 1);
+  ParallelFlip three(&three_runner, 3);
+  for (int i = 0; i < 20; i++) {
+    one.Walk(5, 20);
+    three.Walk(5, 20);
+    // Every district is matched each epoch.
+    ASSERT_EQ(one.GetNumPairs(), 4);
+    ASSERT_EQ(three.GetNumPairs(), 4);
+    ASSERT_TRUE(AllDistrictsContiguous(three_graph));
+    for (uint32_t v = 0; v < 64; v++) {
+      ASSERT_EQ(one_graph->GetDistrictOf(v), three_graph->GetDistrictOf(v));
+    }
+
+    uint32_t count = 0;
+    for (uint32_t d = 0; d < 8; d++) {
+      ASSERT_GE(three_graph->GetDistrictPop(d), 4);
+      ASSERT_LE(three_graph->GetDistrictPop(d), 12);
+      count += 2 * three_graph->GetMinorityPop(d) >
+               three_graph->GetDistrictPop(d);
+    }
+    ASSERT_EQ(three_graph->GetNumMajorityMinority(), count);
+  }
+  ASSERT_GT(three_runner.GetNumAccepted(), 0);
+  ASSERT_EQ(one_runner.GetNumAccepted(), three_runner.GetNumAccepted());
+
+  // The sampler has kept up, so the serial kernel can carry on.
+  three_runner.Walk(200);
+  ASSERT_TRUE(AllDistrictsContiguous(three_graph));
+
+  DeleteGrid(one_graph);
+  DeleteGrid(three_graph);
+}
+
+// Tests that the best plan survives epochs that overflow the journal,
+// which happens partway through an epoch's moves.
+TEST(Test_ParallelFlip, TestRestoreBest) {
+  for (uint64_t seed = 0; seed < 30; seed++) {
+    Graph *g = MakeGrid(8, 8, 4);
+    Runner runner(g);
+    runner.SetSeed(seed);
+    ASSERT_EQ(runner.PopulateGraphData(), 0);
+
+    std::vector<uint32_t> plan(64);
+    for (uint32_t v = 0; v < 64; v++) {
+      plan[v] = g->GetDistrictOf(v);
+    }
+
+    ParallelFlip kernel(&runner, 2);
+    runner.TrackBest();
+    kernel.Walk(20, 20);
+    runner.RestoreBest();
+    for (uint32_t v = 0; v < 64; v++) {
+      ASSERT_EQ(g->GetDistrictOf(v), plan[v]);
+    }
+    ASSERT_TRUE(AllDistrictsContiguous(g));
+
+    DeleteGrid(g);
+  }
+}
+
+// Tests that districts which did not touch when the kernel was created
+// come to exchange nodes once they do.
+TEST(Test_ParallelFlip, TestNewPairs) {
+  Graph *g = MakeGrid(6, 6, 3);
+  Runner runner(g);
+  runner.SetWeights(0, 0, 0, 0);
+  runner.SetPopulationTolerance(0.5);
+  runner.SetSeed(7);
+  ASSERT_EQ(runner.PopulateGraphData(), 0);
+
+  // The stripes are 0, 1 and 2 from left to right.
+  ParallelFlip kernel(&runner, 2);
+  std::vector<uint32_t> plan(36);
+  bool exchanged = false;
+  for (uint32_t i = 0; i < 2000 && !exchanged; i++) {
+    for (uint32_t v = 0; v < 36; v++) {
+      plan[v] = g->GetDistrictOf(v);
+    }
+    kernel.Walk(1, 10);
+    for (uint32_t v = 0; v < 36; v++) {
+      exchanged |= plan[v] + g->GetDistrictOf(v) == 2 && plan[v] != 1;
+    }
+  }
+  ASSERT_TRUE(exchanged);
+  ASSERT_TRUE(AllDistrictsContiguous(g));
+
+  DeleteGrid(g);
+}
+
+// Tests that an unweighted walk on a 2x2 grid visits all 12 contiguous
+// two-district plans equally often.
+TEST(Test_ParallelFlip, TestUniform) {
+  Graph *g = MakeGrid(2, 2, 2);
+  Runner runner(g);
+  runner.SetSeed(2);
+  ASSERT_EQ(runner.PopulateGraphData(), 0);
+
+  ParallelFlip kernel(&runner, 2);
+  std::vector<uint32_t> visits(16, 0);
+  uint32_t num_epochs = 60000, plan;
+  for (uint32_t i = 0; i < num_epochs; i++) {
+    kernel.Walk(1, 1);
+    plan = 0;
+    for (uint32_t v = 0; v < 4; v++) {
+      plan |= g->GetDistrictOf(v) << v;
+    }
+    visits[plan]++;
+  }
+
+  for (plan = 0; plan < 16; plan++) {
+    if (plan == 0 || plan == 15 || plan == 6 || plan == 9) {
+      ASSERT_EQ(visits[plan], 0);
+    } else {
+      ASSERT_NEAR(visits[plan], num_epochs / 12.0, num_epochs / 12.0 * 0.1);
+    }
+  }
+
+  DeleteGrid(g);
+}
+
+}   // namespace rakan
@@ -0,0 +1,78 @@
+#include <inttypes.h>
+
+#include <atomic>
+#include <vector>
+
+#include "../src/Graph.h"
+#include "../src/ParallelTempering.h"
+#include "../src/Runner.h"
+#include "../src/ThreadPool.h"
+#include "./test_grid.h"
+
+#include "gtest/gtest.h"
+
+namespace rakan {
+
+// Tests that every task of a parallel loop runs exactly once.
+TEST(Test_ParallelTempering, TestThreadPool) {
+  ThreadPool pool(3);
+  ASSERT_EQ(pool.GetNumThreads(), 3);
+
+  for (int round = 0; round < 20; round++) {
+    std::vector<std::atomic<int>> counts(50);
+    for (auto &count : counts) {
+      count = 0;
+    }
+    pool.ParallelFor(counts.size(), [&counts](uint32_t i) { counts[i]++; });
+    for (auto &count : counts) {
+      ASSERT_EQ(count, 1);
+    }
+  }
+}
+
+// Tests that swaps permute the replicas over the rungs, that the cold chain
+// stays a valid plan, and that adaptation keeps the ladder decreasing.
+TEST(Test_ParallelTempering, TestRun) {
+  Graph *g = MakeGrid(8, 8, 4);
+  Runner base(g);
+  base.SetWeights(2, 1, 0, 0);
+  base.SetPopulationTolerance(0.5);
+  base.SetSeed(5);
+  ASSERT_EQ(base.PopulateGraphData(), 0);
+
+  ParallelTempering pt(&base, 4, 2);
+  uint32_t samples = 0;
+  pt.SetSampleCallback([&samples](Runner *cold) {
+    ASSERT_EQ(cold->GetInverseTemperature(), 1);
+    samples++;
+  });
+  pt.SetAdaptation(true, 0.3);
+  pt.Run(50, 20);
+  pt.SetAdaptation(false, 0.3);
+  pt.Run(50, 20);
+  ASSERT_EQ(samples, 100);
+
+  std::vector<bool> seen(pt.GetNumReplicas(), false);
+  for (uint32_t rung = 0; rung < pt.GetNumReplicas(); rung++) {
+    Runner *replica = pt.GetReplica(rung);
+    ASSERT_EQ(replica->GetInverseTemperature(), pt.GetInverseTemperature(rung));
+    if (rung > 0) {
+      ASSERT_LT(pt.GetInverseTemperature(rung),
+                pt.GetInverseTemperature(rung - 1));
+    }
+    ASSERT_GE(pt.GetSwapRate(rung), 0);
+    ASSERT_LE(pt.GetSwapRate(rung), 1);
+    ASSERT_TRUE(AllDistrictsContiguous(replica->GetGraph()));
+  }
+  ASSERT_EQ(pt.GetInverseTemperature(0), 1);
+  ASSERT_GT(pt.GetSwapRate(0), 0);
+
+  // The base graph is untouched by the replicas.
+  for (uint32_t i = 0; i < g->GetNumNodes(); i++) {
+    ASSERT_EQ(g->GetDistrictOf(i), g->GetNode(i)->GetDistrict());
+  }
+
+  DeleteGrid(g);
+}
+
+}   // namespace rakan
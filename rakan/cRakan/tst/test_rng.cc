@@ -0,0 +1,85 @@
+#include <inttypes.h>
+
+#include <vector>
+
+#include "../src/Graph.h"
+#include "../src/Rng.h"
+#include "../src/Runner.h"
+#include "./test_grid.h"
+
+#include "gtest/gtest.h"
+
+namespace rakan {
+
+// Tests that a seed determines the sequence and that streams differ.
+TEST(Test_Rng, TestSeedAndStreams) {
+  Rng a(42), b(42), c(43), d;
+  int i;
+
+  for (i = 0; i < 100; i++) {
+    ASSERT_EQ(a.Next(), b.Next());
+  }
+  ASSERT_NE(a.Next(), c.Next());
+
+  a.SeedStream(42, 1);
+  b.Seed(42);
+  b.Jump();
+  c.SeedStream(42, 2);
+  d.SeedStream(42, 0);
+  for (i = 0; i < 100; i++) {
+    uint64_t x = a.Next();
+    ASSERT_EQ(x, b.Next());
+    ASSERT_NE(x, c.Next());
+    ASSERT_NE(x, d.Next());
+  }
+}
+
+// Tests the ranges and rough moments of the uniform draws.
+TEST(Test_Rng, TestUniform) {
+  Rng rng(7);
+  std::vector<int> counts(10, 0);
+  double u, sum = 0;
+  uint32_t k;
+  int i, n = 100000;
+
+  for (i = 0; i < n; i++) {
+    u = rng.Uniform();
+    ASSERT_GE(u, 0);
+    ASSERT_LT(u, 1);
+    sum += u;
+
+    k = rng.UniformInt(10);
+    ASSERT_LT(k, 10);
+    counts[k]++;
+  }
+
+  ASSERT_NEAR(sum / n, 0.5, 0.01);
+  for (i = 0; i < 10; i++) {
+    ASSERT_NEAR(counts[i], n / 10, n / 100);
+  }
+}
+
+// Tests that two Runners with the same seed take the same walk.
+TEST(Test_Rng, TestReproducibleWalk) {
+  Graph *g = MakeGrid(8, 8, 4), *h = MakeGrid(8, 8, 4);
+  Runner a(g), b(h);
+  uint32_t i;
+
+  a.SetWeights(1, 1, 0, 0);
+  b.SetWeights(1, 1, 0, 0);
+  a.SetSeed(2018);
+  b.SetSeed(2018);
+  ASSERT_EQ(a.PopulateGraphData(), 0);
+  ASSERT_EQ(b.PopulateGraphData(), 0);
+
+  a.Walk(2000);
+  b.Walk(2000);
+  for (i = 0; i < g->GetNumNodes(); i++) {
+    ASSERT_EQ(g->GetDistrictOf(i), h->GetDistrictOf(i));
+  }
+
+  DeleteGrid(g);
+  DeleteGrid(h);
+}
+
+}   // namespace rakan
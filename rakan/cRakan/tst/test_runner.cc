@@ -1,8 +1,14 @@
 #include <inttypes.h>
+#include <math.h>
+
+#include <algorithm>
+#include <vector>
 
 #include "../src/Runner.h"
 #include "../src/Graph.h"
 #include "../src/Node.h"
+#include "../src/ReturnCodes.h"
+#include "./test_grid.h"
 
 #include "gtest/gtest.h"
 
@@ -36,4 +42,462 @@ TEST(Test_Runner, TestScores) {
   ASSERT_EQ(runner.ScoreVRA(), 1);
 }
 
+// Tests that a hypothetical move scores the same as actually making it.
+TEST(Test_Runner, TestScoreProposal) {
+  Graph *g = MakeGrid(4, 4, 2);
+  Runner runner(g);
+  runner.SetWeights(1, 1, 0, 1);
+  ASSERT_EQ(runner.PopulateGraphData(), 0);
+
+  // Node 1 borders district 1 through node 2.
+  Node *node = g->GetNode(1);
+  double proposed = runner.ScoreProposal(node, 1);
+  ASSERT_NEAR(runner.Redistrict(node, 1), proposed, 1e-9);
+  runner.Redistrict(node, 0);
+  ASSERT_NEAR(runner.ScoreProposal(node, 0), runner.LogScore(), 1e-9);
+
+  DeleteGrid(g);
+}
+
+// Tests the O(1) population tolerance check on a balanced plan.
+TEST(Test_Runner, TestPopulationTolerance) {
+  Graph *g = MakeGrid(4, 4, 2);
+  Runner runner(g);
+  ASSERT_EQ(runner.PopulateGraphData(), 0);
+
+  // Disabled by default.
+  ASSERT_TRUE(runner.IsWithinPopulationTolerance(g->GetNode(1), 1));
+
+  // Each district holds the ideal 8 people; losing one leaves 7.
+  runner.SetPopulationTolerance(0.1);
+  ASSERT_FALSE(runner.IsWithinPopulationTolerance(g->GetNode(1), 1));
+  runner.SetPopulationTolerance(0.2);
+  ASSERT_TRUE(runner.IsWithinPopulationTolerance(g->GetNode(1), 1));
+
+  DeleteGrid(g);
+}
+
+// Tests that a walk through the filter pipeline keeps districts contiguous
+// and the running totals consistent with a full recount.
+TEST(Test_Runner, TestFilterPipelineWalk) {
+  Graph *g = MakeGrid(6, 6, 3);
+  Runner runner(g);
+  runner.SetWeights(1, 1, 0, 1);
+  runner.SetPopulationTolerance(0.5);
+  runner.SetPreDrawAcceptance(true);
+  ASSERT_EQ(runner.PopulateGraphData(), 0);
+
+  runner.Walk(200);
+  ASSERT_TRUE(AllDistrictsContiguous(g));
+
+  BoundarySampler rebuilt;
+  rebuilt.Build(g);
+  ASSERT_NEAR(runner.GetSampler()->Total(), rebuilt.Total(), 1e-9);
+
+  double expected = 0;
+  for (uint32_t d = 0; d < g->GetNumDistricts(); d++) {
+    uint32_t cut = 0, size = 0;
+    for (uint32_t i = 0; i < g->GetNumNodes(); i++) {
+      if (g->GetDistrictOf(i) != d) {
+        continue;
+      }
+      size++;
+      for (auto &neighbor : *g->GetNode(i)->GetNeighbors()) {
+        if (g->GetDistrictOf(neighbor) != d) {
+          cut++;
+        }
+      }
+    }
+    expected += static_cast<double>(cut) * cut / size;
+  }
+  ASSERT_NEAR(runner.ScoreCompactness(), expected, 1e-9);
+
+  runner.ResetRejections();
+  for (int i = 0; i < kNumFilterStages; i++) {
+    ASSERT_EQ(runner.GetRejections(static_cast<FilterStage>(i)), 0);
+  }
+
+  DeleteGrid(g);
+}
+
+// Tests that seeding covers the graph with contiguous districts, and fails
+// only when some node cannot be reached.
+TEST(Test_Runner, TestSeedDistricts) {
+  Graph *g = MakeGrid(20, 20, 5);
+  Runner runner(g);
+  uint32_t d;
+
+  runner.SetSeed(7);
+  ASSERT_EQ(runner.SeedDistricts(), 0);
+  ASSERT_EQ(runner.PopulateGraphData(), 0);
+  for (d = 0; d < g->GetNumDistricts(); d++) {
+    ASSERT_GT(g->GetDistrictSize(d), 0);
+  }
+  ASSERT_TRUE(AllDistrictsContiguous(g));
+  DeleteGrid(g);
+
+  // Two separate edges cannot be covered by a single district.
+  Graph *h = new Graph(4, 1, 4);
+  for (uint32_t i = 0; i < 4; i++) {
+    h->AddNode(new Node(i, 0));
+  }
+  h->GetNode(0)->AddNeighbor(*h->GetNode(1));
+  h->GetNode(1)->AddNeighbor(*h->GetNode(0));
+  h->GetNode(2)->AddNeighbor(*h->GetNode(3));
+  h->GetNode(3)->AddNeighbor(*h->GetNode(2));
+  Runner disconnected(h);
+  ASSERT_EQ(disconnected.SeedDistricts(), SEED_FAILED);
+  DeleteGrid(h);
+}
+
+// Tests that lifted steps sample the target exactly, by comparing visit
+// frequencies on a 2x3 grid against the enumerated distribution.
+TEST(Test_Runner, TestLiftedWalk) {
+  uint32_t plan, v, num_steps = 400000;
+  std::vector<double> target(64, 0), visits(64, 0);
+  double total = 0, distance = 0;
+
+  Graph *h = MakeGrid(2, 3, 2);
+  for (plan = 0; plan < 64; plan++) {
+    for (v = 0; v < 6; v++) {
+      h->GetNode(v)->SetDistrict((plan >> v) & 1);
+    }
+    Runner scorer(h);
+    scorer.SetWeights(0.5, 0, 0, 1);
+    if (scorer.PopulateGraphData() != SUCCESS || !AllDistrictsContiguous(h) ||
+        h->GetDistrictPop(0) == 0 || h->GetDistrictPop(1) == 0) {
+      continue;
+    }
+    target[plan] = exp(-scorer.LogScore());
+    total += target[plan];
+  }
+  DeleteGrid(h);
+
+  Graph *g = MakeGrid(2, 3, 2);
+  Runner runner(g);
+  runner.SetWeights(0.5, 0, 0, 1);
+  runner.SetEngine(kLiftedEngine);
+  runner.SetSeed(21);
+  ASSERT_EQ(runner.PopulateGraphData(), 0);
+
+  for (uint32_t i = 0; i < num_steps; i++) {
+    runner.Walk(1);
+    plan = 0;
+    for (v = 0; v < 6; v++) {
+      plan |= g->GetDistrictOf(v) << v;
+    }
+    visits[plan]++;
+  }
+
+  for (plan = 0; plan < 64; plan++) {
+    distance += fabs(visits[plan] / num_steps - target[plan] / total);
+  }
+  ASSERT_LT(distance / 2, 0.02);
+  ASSERT_GT(runner.GetNumAccepted(), 0);
+
+  DeleteGrid(g);
+}
+
+// Tests that repair balances a lopsided plan without breaking contiguity,
+// and fails when no plan can meet the tolerance.
+TEST(Test_Runner, TestRepairPopulation) {
+  Graph *g = MakeGrid(10, 10, 4);
+  for (uint32_t v = 0; v < 100; v++) {
+    uint32_t col = v % 10;
+    g->GetNode(v)->SetDistrict(col < 7 ? 0 : col - 6);
+  }
+  Runner runner(g);
+  runner.SetPopulationTolerance(0.1);
+  ASSERT_EQ(runner.PopulateGraphData(), 0);
+  ASSERT_EQ(g->GetDistrictPop(0), 70);
+
+  ASSERT_EQ(runner.RepairPopulation(), SUCCESS);
+  for (uint32_t d = 0; d < 4; d++) {
+    ASSERT_GE(g->GetDistrictPop(d), 22.5);
+    ASSERT_LE(g->GetDistrictPop(d), 27.5);
+  }
+  ASSERT_TRUE(AllDistrictsContiguous(g));
+
+  BoundarySampler rebuilt;
+  rebuilt.Build(g);
+  ASSERT_NEAR(runner.GetSampler()->Total(), rebuilt.Total(), 1e-9);
+  DeleteGrid(g);
+
+  // Ten people cannot be split into three districts within 1%.
+  Graph *h = MakeGrid(2, 5, 3);
+  Runner impossible(h);
+  impossible.SetPopulationTolerance(0.01);
+  ASSERT_EQ(impossible.PopulateGraphData(), 0);
+  ASSERT_EQ(impossible.RepairPopulation(), REPAIR_FAILED);
+  ASSERT_TRUE(AllDistrictsContiguous(h));
+  DeleteGrid(h);
 }
+
+// Tests that repair relays surplus through districts already at the ideal:
+// half of a grid in one district and the rest in unequal stripes.
+TEST(Test_Runner, TestRepairUnequalStripes) {
+  for (uint32_t k : {6, 8}) {
+    Graph *g = MakeGrid(50, 50, k);
+    for (uint32_t v = 0; v < 2500; v++) {
+      uint32_t col = v % 50;
+      g->GetNode(v)->SetDistrict(col < 25 ? 0 : 1 + (col - 25) * (k - 1) / 25);
+    }
+    Runner runner(g);
+    runner.SetPopulationTolerance(0.05);
+    ASSERT_EQ(runner.PopulateGraphData(), SUCCESS);
+
+    ASSERT_EQ(runner.RepairPopulation(), SUCCESS);
+    for (uint32_t d = 0; d < k; d++) {
+      ASSERT_GE(g->GetDistrictPop(d), 2500.0 / k * 0.95);
+      ASSERT_LE(g->GetDistrictPop(d), 2500.0 / k * 1.05);
+    }
+    ASSERT_TRUE(AllDistrictsContiguous(g));
+    DeleteGrid(g);
+  }
+}
+
+// Tests that balanced seeding makes contiguous plans within the tolerance
+// that do not depend on the number of threads.
+TEST(Test_Runner, TestSeedBalancedDistricts) {
+  Graph *g = MakeGrid(12, 12, 6);
+  Graph *h = MakeGrid(12, 12, 6);
+  Runner one(g);
+  Runner three(h);
+  one.SetPopulationTolerance(0.05);
+  three.SetPopulationTolerance(0.05);
+  one.SetSeed(17);
+  three.SetSeed(17);
+  ASSERT_EQ(one.SeedBalancedDistricts(100, 1), SUCCESS);
+  ASSERT_EQ(three.SeedBalancedDistricts(100, 3), SUCCESS);
+  ASSERT_EQ(one.PopulateGraphData(), SUCCESS);
+  ASSERT_EQ(three.PopulateGraphData(), SUCCESS);
+
+  ASSERT_TRUE(AllDistrictsContiguous(g));
+  for (uint32_t d = 0; d < 6; d++) {
+    ASSERT_GE(g->GetDistrictPop(d), 24 * 0.95);
+    ASSERT_LE(g->GetDistrictPop(d), 24 * 1.05);
+  }
+  for (uint32_t v = 0; v < 144; v++) {
+    ASSERT_EQ(g->GetDistrictOf(v), h->GetDistrictOf(v));
+  }
+  DeleteGrid(g);
+  DeleteGrid(h);
+
+  Graph *single = MakeGrid(3, 3, 1);
+  Runner whole(single);
+  ASSERT_EQ(whole.SeedBalancedDistricts(1, 1), SUCCESS);
+  ASSERT_EQ(whole.PopulateGraphData(), SUCCESS);
+  ASSERT_EQ(single->GetDistrictPop(0), 9);
+  DeleteGrid(single);
+}
+
+// Tests that switching plans by array moves only the differing nodes and
+// leaves every derived structure as a full rebuild would.
+TEST(Test_Runner, TestSetDistrictsArray) {
+  Graph *g = MakeGrid(10, 10, 4);
+  Graph *h = MakeGrid(10, 10, 4);
+  Runner runner(g);
+  Runner rebuilt(h);
+  vector<uint32_t> plan(100);
+  uint32_t v, d;
+
+  ASSERT_EQ(runner.SetDistricts(plan.data()), POPULATE_FAILED);
+  ASSERT_EQ(runner.PopulateGraphData(), SUCCESS);
+  runner.SetPopulationTolerance(0.3);
+  runner.SetSeed(3);
+  runner.Walk(200);
+
+  // Horizontal stripes, rebuilt from scratch on the other graph.
+  for (v = 0; v < 100; v++) {
+    plan[v] = v / 25;
+    h->GetNode(v)->SetDistrict(plan[v]);
+  }
+  ASSERT_EQ(rebuilt.PopulateGraphData(), SUCCESS);
+
+  plan[0] = 4;
+  ASSERT_EQ(runner.SetDistricts(plan.data()), LOAD_FAILED);
+  plan[0] = 0;
+  ASSERT_EQ(runner.SetDistricts(plan.data()), SUCCESS);
+
+  for (v = 0; v < 100; v++) {
+    ASSERT_EQ(g->GetDistrictOf(v), plan[v]);
+  }
+  for (d = 0; d < 4; d++) {
+    ASSERT_EQ(g->GetDistrictSize(d), h->GetDistrictSize(d));
+    ASSERT_EQ(g->GetCutEdges(d), h->GetCutEdges(d));
+    ASSERT_EQ(g->GetDistrictPop(d), h->GetDistrictPop(d));
+    ASSERT_EQ(g->GetMinorityPop(d), h->GetMinorityPop(d));
+    vector<uint32_t> perim, expected;
+    ASSERT_TRUE(g->GetPerimNodes(d, &perim));
+    ASSERT_TRUE(h->GetPerimNodes(d, &expected));
+    std::sort(perim.begin(), perim.end());
+    std::sort(expected.begin(), expected.end());
+    ASSERT_EQ(perim, expected);
+  }
+  ASSERT_EQ(g->GetNumMajorityMinority(), h->GetNumMajorityMinority());
+  ASSERT_NEAR(runner.LogScore(), rebuilt.LogScore(), 1e-9);
+
+  // The sampler follows the switch, so walking goes on from the new plan.
+  runner.Walk(200);
+  ASSERT_TRUE(AllDistrictsContiguous(g));
+  DeleteGrid(g);
+  DeleteGrid(h);
+}
+
+// Counts the edges of a 12x12 grid whose ends lie in different districts.
+static double CutEdges(const vector<uint32_t> &labels) {
+  double cut = 0;
+  for (uint32_t v = 0; v < 144; v++) {
+    if (v % 12 + 1 < 12 && labels[v] != labels[v + 1]) {
+      cut++;
+    }
+    if (v + 12 < 144 && labels[v] != labels[v + 12]) {
+      cut++;
+    }
+  }
+  return cut;
+}
+
+// Tests that parallel seeding keeps the lowest acceptable attempt, or the
+// best scoring one, independently of the number of threads, and that the
+// attempts are accounted for.
+TEST(Test_Runner, TestSeedAttempts) {
+  Graph *g = MakeGrid(12, 12, 4);
+  Graph *h = MakeGrid(12, 12, 4);
+  Runner one(g);
+  Runner three(h);
+  SeedStats first, second;
+  one.SetPopulationTolerance(0.1);
+  three.SetPopulationTolerance(0.1);
+  one.SetSeed(29);
+  three.SetSeed(29);
+
+  ASSERT_EQ(one.SeedAttempts(kGrowSeeds, 500, 1, nullptr, &first), SUCCESS);
+  ASSERT_EQ(three.SeedAttempts(kGrowSeeds, 500, 3, nullptr, &second),
+            SUCCESS);
+  ASSERT_EQ(first.winner, second.winner);
+  ASSERT_EQ(first.num_accepted, 1);
+  ASSERT_EQ(first.num_rejected, first.winner);
+  ASSERT_EQ(first.num_cancelled, 500 - first.winner - 1);
+  ASSERT_EQ(second.num_accepted + second.num_rejected +
+            second.num_cancelled, 500);
+  ASSERT_EQ(one.PopulateGraphData(), SUCCESS);
+  ASSERT_EQ(three.PopulateGraphData(), SUCCESS);
+  ASSERT_TRUE(AllDistrictsContiguous(g));
+  for (uint32_t d = 0; d < 4; d++) {
+    ASSERT_GE(g->GetDistrictPop(d), 36 * 0.9);
+    ASSERT_LE(g->GetDistrictPop(d), 36 * 1.1);
+  }
+  for (uint32_t v = 0; v < 144; v++) {
+    ASSERT_EQ(g->GetDistrictOf(v), h->GetDistrictOf(v));
+  }
+
+  // Scored seeding runs every attempt and keeps the shortest boundary.
+  ASSERT_EQ(one.SeedAttempts(kSplitSeeds, 24, 1, CutEdges, &first), SUCCESS);
+  ASSERT_EQ(three.SeedAttempts(kSplitSeeds, 24, 3, CutEdges, &second),
+            SUCCESS);
+  ASSERT_EQ(first.winner, second.winner);
+  ASSERT_EQ(first.score, second.score);
+  ASSERT_EQ(first.num_started, 24);
+  ASSERT_EQ(second.num_cancelled, 0);
+  ASSERT_GT(first.num_accepted, 1);
+  ASSERT_EQ(one.PopulateGraphData(), SUCCESS);
+  ASSERT_EQ(three.PopulateGraphData(), SUCCESS);
+  vector<uint32_t> labels(144);
+  for (uint32_t v = 0; v < 144; v++) {
+    labels[v] = g->GetDistrictOf(v);
+    ASSERT_EQ(labels[v], h->GetDistrictOf(v));
+  }
+  ASSERT_EQ(CutEdges(labels), first.score);
+  DeleteGrid(g);
+  DeleteGrid(h);
+}
+
+// Tests that tabu steps make the same moves on any number of threads,
+// improve on a poor plan, and never undo the move just made.
+TEST(Test_Runner, TestTabuSearch) {
+  Graph *g = MakeGrid(10, 10, 4);
+  Graph *h = MakeGrid(10, 10, 4);
+  Runner one(g);
+  Runner three(h);
+  vector<vector<uint32_t> > plans;
+  double initial, best;
+
+  for (Runner *runner : {&one, &three}) {
+    runner->SetWeights(1, 0, 0, 0);
+    runner->SetPopulationTolerance(0.1);
+    runner->SetEngine(kTabuEngine);
+    runner->SetTabuTenure(5);
+    ASSERT_EQ(runner->PopulateGraphData(), SUCCESS);
+  }
+  three.SetTabuThreads(3);
+  ASSERT_EQ(three.GetTabuThreads(), 3);
+  initial = best = one.LogScore();
+
+  for (int i = 0; i < 200; i++) {
+    one.Walk(1);
+    three.Walk(1);
+    vector<uint32_t> plan(100);
+    for (uint32_t v = 0; v < 100; v++) {
+      plan[v] = g->GetDistrictOf(v);
+      ASSERT_EQ(plan[v], h->GetDistrictOf(v));
+    }
+    if (plans.size() >= 2) {
+      ASSERT_NE(plan, plans[plans.size() - 2]);
+    }
+    plans.push_back(plan);
+    best = std::min(best, one.LogScore());
+  }
+
+  ASSERT_EQ(one.GetNumAccepted(), 200);
+  ASSERT_LT(best, initial * 0.8);
+  ASSERT_TRUE(AllDistrictsContiguous(g));
+  for (uint32_t d = 0; d < 4; d++) {
+    ASSERT_GE(g->GetDistrictPop(d), 25 * 0.9);
+    ASSERT_LE(g->GetDistrictPop(d), 25 * 1.1);
+  }
+  DeleteGrid(g);
+  DeleteGrid(h);
+}
+
+// Tests that mixture steps are accounted to their kernels, and that the
+// weights adapt during burn-in only.
+TEST(Test_Runner, TestMixtureStats) {
+  Graph *g = MakeGrid(10, 10, 4);
+  Runner runner(g);
+  runner.SetWeights(1, 0, 0, 0);
+  runner.SetPopulationTolerance(0.2);
+  runner.SetEngine(kMixtureEngine);
+  runner.SetKernelWeight(kFlipEngine, 3);
+  runner.SetKernelWeight(kReComEngine, 1);
+  runner.SetKernelWeight(kTabuEngine, 1);
+  runner.SetBurnIn(4096);
+  runner.SetSeed(6);
+  ASSERT_EQ(runner.PopulateGraphData(), SUCCESS);
+  ASSERT_EQ(runner.GetKernelWeight(kTabuEngine), 0);
+
+  runner.Walk(4096);
+  double flip = runner.GetKernelWeight(kFlipEngine);
+  double recom = runner.GetKernelWeight(kReComEngine);
+  ASSERT_NE(flip, 3);
+  ASSERT_DOUBLE_EQ(flip + recom, 4);
+  ASSERT_GE(std::min(flip, recom), 4 * 0.1 / 2);
+  runner.Walk(4096);
+  ASSERT_EQ(runner.GetKernelWeight(kFlipEngine), flip);
+  ASSERT_EQ(runner.GetKernelWeight(kReComEngine), recom);
+
+  KernelStats flips = runner.GetKernelStats(kFlipEngine);
+  KernelStats recoms = runner.GetKernelStats(kReComEngine);
+  ASSERT_EQ(flips.num_steps + recoms.num_steps, 8192);
+  ASSERT_EQ(flips.num_accepted + recoms.num_accepted,
+            runner.GetNumAccepted());
+  ASSERT_GT(flips.num_accepted, 0);
+  ASSERT_GT(recoms.num_accepted, 0);
+  ASSERT_GT(flips.seconds, 0);
+  ASSERT_GT(recoms.score_change, 0);
+  ASSERT_EQ(runner.GetKernelStats(kBlockEngine).num_steps, 0);
+  ASSERT_TRUE(AllDistrictsContiguous(g));
+  DeleteGrid(g);
+}
+
+}   // namespace rakan
@@ -0,0 +1,62 @@
+#include <inttypes.h>
+
+#include "../src/Graph.h"
+#include "../src/Runner.h"
+#include "../src/ShortBursts.h"
+#include "./test_grid.h"
+
+#include "gtest/gtest.h"
+
+namespace rakan {
+
+/*
+* Counts the majority-minority districts of a graph from scratch.
+*/
+static uint32_t CountMajorityMinority(Graph *g) {
+  uint32_t d, count = 0;
+
+  for (d = 0; d < g->GetNumDistricts(); d++) {
+    if (2 * g->GetMinorityPop(d) > g->GetDistrictPop(d)) {
+      count++;
+    }
+  }
+  return count;
+}
+
+// Tests that the running majority-minority count follows the plan.
+TEST(Test_ShortBursts, TestRunningCount) {
+  Graph *g = MakeGrid(6, 6, 6);
+  Runner runner(g);
+  runner.SetPopulationTolerance(0.9);
+  ASSERT_EQ(runner.PopulateGraphData(), 0);
+  ASSERT_EQ(g->GetNumMajorityMinority(), CountMajorityMinority(g));
+
+  for (int i = 0; i < 50; i++) {
+    runner.Walk(20);
+    ASSERT_EQ(g->GetNumMajorityMinority(), CountMajorityMinority(g));
+  }
+
+  DeleteGrid(g);
+}
+
+// Tests that bursts find majority-minority districts the initial plan
+// lacks, and that the best plan is a valid plan.
+TEST(Test_ShortBursts, TestRun) {
+  Graph *g = MakeGrid(6, 6, 6);
+  Runner base(g);
+  base.SetPopulationTolerance(0.5);
+  base.SetSeed(12);
+  ASSERT_EQ(base.PopulateGraphData(), 0);
+  uint32_t initial = g->GetNumMajorityMinority();
+
+  ShortBursts bursts(&base, 4, 2);
+  uint32_t count = bursts.Run(200, 50);
+  ASSERT_GT(count, initial);
+  ASSERT_EQ(count, bursts.GetBestCount());
+  ASSERT_EQ(count, CountMajorityMinority(bursts.GetBest()));
+  ASSERT_TRUE(AllDistrictsContiguous(bursts.GetBest()));
+
+  DeleteGrid(g);
+}
+
+}   // namespace rakan
@@ -0,0 +1,218 @@
+#include <inttypes.h>
+#include <math.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../enumerate/Enumerator.h"
+#include "../src/Graph.h"
+#include "../src/ReturnCodes.h"
+#include "../src/Runner.h"
+#include "../src/SMC.h"
+#include "./test_grid.h"
+
+#include "gtest/gtest.h"
+
+namespace rakan {
+
+// Tests that every weighted particle is a contiguous plan within the
+// population tolerance, and that the weights are normalized.
+TEST(Test_SMC, TestRun) {
+  Graph *g = MakeGrid(6, 6, 4);
+  Runner runner(g);
+  runner.SetPopulationTolerance(0.2);
+  ASSERT_EQ(runner.PopulateGraphData(), 0);
+
+  SMC smc(&runner, 64, 2);
+  smc.SetSeed(7);
+  ASSERT_EQ(smc.Run(), SUCCESS);
+
+  double sum = 0;
+  uint32_t d, weighted = 0;
+  for (uint32_t i = 0; i < smc.GetNumParticles(); i++) {
+    sum += smc.GetWeight(i);
+    if (smc.GetWeight(i) == 0) {
+      continue;
+    }
+    weighted++;
+    ASSERT_TRUE(smc.CopyParticle(i, g));
+    ASSERT_TRUE(AllDistrictsContiguous(g));
+    for (d = 0; d < g->GetNumDistricts(); d++) {
+      ASSERT_GE(g->GetDistrictPop(d), 9 * 0.8);
+      ASSERT_LE(g->GetDistrictPop(d), 9 * 1.2);
+    }
+  }
+  ASSERT_GT(weighted, 0);
+  ASSERT_NEAR(sum, 1, 1e-9);
+
+  DeleteGrid(g);
+}
+
+// Tests that the particles do not depend on the number of threads.
+TEST(Test_SMC, TestThreadCount) {
+  Graph *g = MakeGrid(6, 6, 3);
+  Runner runner(g);
+  runner.SetPopulationTolerance(0.2);
+  ASSERT_EQ(runner.PopulateGraphData(), 0);
+
+  SMC one(&runner, 32, 1);
+  SMC three(&runner, 32, 3);
+  one.SetSeed(3);
+  three.SetSeed(3);
+  ASSERT_EQ(one.Run(), SUCCESS);
+  ASSERT_EQ(three.Run(), SUCCESS);
+
+  for (uint32_t i = 0; i < 32; i++) {
+    ASSERT_EQ(one.GetWeight(i), three.GetWeight(i));
+    for (uint32_t v = 0; v < g->GetNumNodes(); v++) {
+      ASSERT_EQ(one.GetParticle(i)[v], three.GetParticle(i)[v]);
+    }
+  }
+
+  DeleteGrid(g);
+}
+
+// Counts the spanning trees of one district of a plan of a grid, by the
+// matrix-tree theorem.
+static double SpanningTrees(const uint32_t *labels, uint32_t district,
+                            uint32_t rows, uint32_t cols) {
+  std::vector<uint32_t> nodes, index(rows * cols, rows * cols);
+  uint32_t v, i, j, r;
+  double det = 1;
+
+  for (v = 0; v < rows * cols; v++) {
+    if (labels[v] == district) {
+      index[v] = nodes.size();
+      nodes.push_back(v);
+    }
+  }
+
+  // The Laplacian with the last row and column removed.
+  uint32_t m = nodes.size() - 1;
+  std::vector<std::vector<double> > a(m, std::vector<double>(m, 0));
+  for (i = 0; i < m; i++) {
+    v = nodes[i];
+    uint32_t neighbors[4] = {
+      v >= cols ? v - cols : v, v + cols < rows * cols ? v + cols : v,
+      v % cols > 0 ? v - 1 : v, v % cols + 1 < cols ? v + 1 : v
+    };
+    for (auto &u : neighbors) {
+      if (u != v && labels[u] == district) {
+        a[i][i]++;
+        if (index[u] < m) {
+          a[i][index[u]]--;
+        }
+      }
+    }
+  }
+
+  for (i = 0; i < m; i++) {
+    for (r = i + 1; r < m; r++) {
+      double f = a[r][i] / a[i][i];
+      for (j = i; j < m; j++) {
+        a[r][j] -= f * a[i][j];
+      }
+    }
+    det *= a[i][i];
+  }
+  return det;
+}
+
+// Queries whether the nodes of a grid plan in either of two districts are
+// connected.
+static bool IsConnected(const uint32_t *labels, uint32_t a, uint32_t b,
+                        uint32_t rows, uint32_t cols) {
+  std::vector<uint32_t> stack;
+  std::vector<bool> seen(rows * cols, false);
+  uint32_t v, count = 0, found = 0;
+
+  for (v = 0; v < rows * cols; v++) {
+    if (labels[v] == a || labels[v] == b) {
+      count++;
+      if (stack.empty()) {
+        stack.push_back(v);
+        seen[v] = true;
+      }
+    }
+  }
+  while (!stack.empty()) {
+    v = stack.back();
+    stack.pop_back();
+    found++;
+    uint32_t neighbors[4] = {
+      v >= cols ? v - cols : v, v + cols < rows * cols ? v + cols : v,
+      v % cols > 0 ? v - 1 : v, v % cols + 1 < cols ? v + 1 : v
+    };
+    for (auto &u : neighbors) {
+      if (!seen[u] && (labels[u] == a || labels[u] == b)) {
+        seen[u] = true;
+        stack.push_back(u);
+      }
+    }
+  }
+  return found == count;
+}
+
+// Keys a plan by its districts, numbered in order of first appearance.
+template <typename Label>
+static std::string Key(const Label *labels, uint32_t n) {
+  std::map<uint32_t, char> names;
+  std::string key;
+
+  for (uint32_t v = 0; v < n; v++) {
+    if (names.find(labels[v]) == names.end()) {
+      char name = '0' + names.size();
+      names[labels[v]] = name;
+    }
+    key += names[labels[v]];
+  }
+  return key;
+}
+
+// Tests that the weighted particles match the target, the product of the
+// districts' spanning-tree counts, over every plan of a small grid. A plan
+// is reached once per district split off first that leaves the other two
+// connected, and the order of the last two is free.
+TEST(Test_SMC, TestTarget) {
+  Graph *g = MakeGrid(3, 3, 3);
+  Runner runner(g);
+  runner.SetPopulationTolerance(0.4);
+  ASSERT_EQ(runner.PopulateGraphData(), 0);
+
+  Enumerator enumerator(g);
+  ASSERT_TRUE(enumerator.List(3, 0.4, 1000));
+  std::map<std::string, double> target, estimate;
+  double total = 0, distance = 0;
+  for (uint64_t plan = 0; plan < enumerator.GetNumListed(); plan++) {
+    const uint32_t *labels = enumerator.GetPlan(plan);
+    double trees = 1, orders = 0;
+    for (uint32_t d = 0; d < 3; d++) {
+      trees *= SpanningTrees(labels, d, 3, 3);
+      orders += 2 * IsConnected(labels, (d + 1) % 3, (d + 2) % 3, 3, 3);
+    }
+    target[Key(labels, 9)] = trees * orders;
+    total += trees * orders;
+  }
+
+  SMC smc(&runner, 40000, 2);
+  smc.SetSeed(11);
+  smc.SetResampleThreshold(0);
+  ASSERT_EQ(smc.Run(), SUCCESS);
+  for (uint32_t i = 0; i < smc.GetNumParticles(); i++) {
+    if (smc.GetWeight(i) > 0) {
+      std::string key = Key(smc.GetParticle(i), 9);
+      ASSERT_EQ(target.count(key), 1);
+      estimate[key] += smc.GetWeight(i);
+    }
+  }
+
+  for (auto &plan : target) {
+    distance += fabs(plan.second / total - estimate[plan.first]);
+  }
+  ASSERT_LT(distance / 2, 0.03);
+
+  DeleteGrid(g);
+}
+
+}   // namespace rakan
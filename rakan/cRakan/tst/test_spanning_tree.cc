@@ -0,0 +1,115 @@
+#include <inttypes.h>
+
+#include <vector>
+
+#include "../src/Graph.h"
+#include "../src/Rng.h"
+#include "../src/Runner.h"
+#include "../src/SpanningTree.h"
+#include "./test_grid.h"
+
+#include "gtest/gtest.h"
+
+namespace rakan {
+
+// Tests that a drawn tree spans the region and that its subtrees partition
+// the region's population.
+TEST(Test_SpanningTree, TestDraw) {
+  Graph *g = MakeGrid(5, 5, 1);
+  Runner runner(g);
+  ASSERT_EQ(runner.PopulateGraphData(), 0);
+
+  // The region is the left three columns.
+  vector<uint32_t> region, subtree;
+  for (uint32_t i = 0; i < g->GetNumNodes(); i++) {
+    if (i % 5 < 3) {
+      region.push_back(i);
+    }
+  }
+
+  SpanningTree tree;
+  Rng rng(11);
+  for (int trial = 0; trial < 20; trial++) {
+    tree.Draw(g, region, &rng);
+    ASSERT_EQ(tree.GetTotalPop(), 15);
+
+    // With no bounds every tree edge is a cut, and a spanning tree of 15
+    // nodes has 14 edges.
+    ASSERT_EQ(tree.FindBalancedCuts(0, 15), 14);
+
+    uint32_t num_cuts = tree.FindBalancedCuts(7, 8);
+    for (uint32_t c = 0; c < num_cuts; c++) {
+      tree.GetSubtree(tree.GetCut(c), &subtree);
+      ASSERT_TRUE(subtree.size() == 7 || subtree.size() == 8);
+      for (auto &node : subtree) {
+        ASSERT_LT(node % 5, 3);
+      }
+    }
+  }
+
+  DeleteGrid(g);
+}
+
+// Tests that ReCom steps keep every district contiguous and balanced.
+TEST(Test_SpanningTree, TestReComWalk) {
+  Graph *g = MakeGrid(12, 12, 4);
+  Runner runner(g);
+  runner.SetWeights(1, 0, 0, 0);
+  runner.SetPopulationTolerance(0.1);
+  runner.SetEngine(kReComEngine);
+  ASSERT_EQ(runner.PopulateGraphData(), 0);
+
+  vector<uint32_t> plan(g->GetNumNodes());
+  for (uint32_t i = 0; i < g->GetNumNodes(); i++) {
+    plan[i] = g->GetDistrictOf(i);
+  }
+
+  runner.Walk(100);
+  ASSERT_TRUE(AllDistrictsContiguous(g));
+  for (uint32_t d = 0; d < g->GetNumDistricts(); d++) {
+    ASSERT_GE(g->GetDistrictPop(d), 36 * 0.9);
+    ASSERT_LE(g->GetDistrictPop(d), 36 * 1.1);
+  }
+
+  bool moved = false;
+  for (uint32_t i = 0; i < g->GetNumNodes(); i++) {
+    moved |= plan[i] != g->GetDistrictOf(i);
+  }
+  ASSERT_TRUE(moved);
+
+  BoundarySampler rebuilt;
+  rebuilt.Build(g);
+  ASSERT_NEAR(runner.GetSampler()->Total(), rebuilt.Total(), 1e-9);
+
+  DeleteGrid(g);
+}
+
+// Tests that the best plan survives ReCom steps that overflow the journal,
+// which happens partway through a step's moved nodes.
+TEST(Test_SpanningTree, TestReComRestoreBest) {
+  for (uint64_t seed = 0; seed < 20; seed++) {
+    Graph *g = MakeGrid(8, 8, 4);
+    Runner runner(g);
+    runner.SetWeights(1, 0, 0, 0);
+    runner.SetEngine(kReComEngine);
+    runner.SetSeed(seed);
+    ASSERT_EQ(runner.PopulateGraphData(), 0);
+
+    vector<uint32_t> plan(g->GetNumNodes());
+    for (uint32_t i = 0; i < g->GetNumNodes(); i++) {
+      plan[i] = g->GetDistrictOf(i);
+    }
+
+    runner.TrackBest();
+    runner.Walk(50);
+    runner.RestoreBest();
+    for (uint32_t i = 0; i < g->GetNumNodes(); i++) {
+      ASSERT_EQ(g->GetDistrictOf(i), plan[i]);
+    }
+    ASSERT_TRUE(AllDistrictsContiguous(g));
+
+    DeleteGrid(g);
+  }
+}
+
+}   // namespace rakan